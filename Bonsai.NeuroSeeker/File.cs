@@ -1,105 +1,265 @@
-﻿using System;
-using System.Collections.Generic;
-using System.Linq;
-using System.Text;
-using System.Threading;
-using System.Reactive.Linq;
-using System.ComponentModel;
-using System.Drawing.Design;
-using System.Reactive.Disposables;
-using System.Threading.Tasks;
-using System.Runtime.InteropServices;
-using OpenCV.Net;
-
-// TODO: replace this with the source output type.
-using TSource = Bonsai.NeuroSeeker.NskDataFrame;
-
-namespace Bonsai.NeuroSeeker
-{
-    public class File : Source<TSource>
-    {
-        // Class variables
-        IObservable<NskDataFrame> source;
-        private int n_channels = 1440;
-
-        // Properties
-        [Category("Acquisition")]
-        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
-        [Description("NeuroSeeker Data File")]
-        public string DataFile { get; set; }
-
-        [Category("Acquisition")]
-        [Description("Sample Buffer Size")]
-        public int BufferSize { get; set; }
-
-        [Category("Acquisition")]
-        [Description("Sample Time (ms)")]
-        public int Interval { get; set; }
-
-        // Import relevant functions from Nsk C DLL
-        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
-        public static extern void NSK_Open_File(string DataFile);
-
-        // Import relevant functions from Nsk C DLL
-        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
-        private static extern int NSK_Read_File(IntPtr buffer, IntPtr sync, int buffer_size);
-        public static NskDataFrame NSK_Read_File(int n_channels, int buffer_size)
-        {
-            var result = new OpenCV.Net.Mat(n_channels, buffer_size, OpenCV.Net.Depth.F32, 1);
-            var sync = new OpenCV.Net.Mat(1, buffer_size, OpenCV.Net.Depth.U16, 1);
-            var samplesRead = NSK_Read_File(result.Data, sync.Data, buffer_size);
-            if (samplesRead == 0) return null;
-            return new NskDataFrame(result, sync);
-        }
-
-        // Import relevant functions from Nsk C DLL
-        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
-        public static extern void NSK_Close_File();
-
-        // Constructor for File Class 
-        public File()
-        {
-            // Set Default values
-            BufferSize = 500;
-
-            // Create a source of CvMats
-            source = Observable.Create<NskDataFrame>((observer, cancellationToken) =>
-            {
-                return Task.Factory.StartNew(() =>
-                {
-                    // Open and Initialize
-                    NSK_Open_File(DataFile);
-
-                    var bufferSize = BufferSize;
-                    using (var close = Disposable.Create(NSK_Close_File))
-                    using (var sampleSignal = new ManualResetEvent(false))
-                    {
-                        while (!cancellationToken.IsCancellationRequested)
-                        {
-                            var result = NSK_Read_File(n_channels, BufferSize);
-                            if (result == null) break;
-                            observer.OnNext(result);
-
-                            var interval = Interval;
-                            if (interval > 0)
-                            {
-                                sampleSignal.WaitOne(interval);
-                            }
-                        }
-
-                        observer.OnCompleted();
-                    }
-                },
-                cancellationToken,
-                TaskCreationOptions.LongRunning,
-                TaskScheduler.Default);
-            });
-        }
-
-        // Generate source (whatever)
-        public override IObservable<TSource> Generate()
-        {
-            return source;
-        }
-    }
-}
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading;
+using System.Reactive.Linq;
+using System.ComponentModel;
+using System.Drawing.Design;
+using System.Reactive.Disposables;
+using System.Threading.Tasks;
+using System.Runtime.InteropServices;
+using OpenCV.Net;
+
+// TODO: replace this with the source output type.
+using TSource = Bonsai.NeuroSeeker.NskDataFrame;
+
+namespace Bonsai.NeuroSeeker
+{
+    public class File : Source<TSource>
+    {
+        // Class variables
+        IObservable<NskDataFrame> source;
+        private int n_channels = 1440;
+
+        // Properties
+        [Category("Acquisition")]
+        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
+        [Description("NeuroSeeker Data File")]
+        public string DataFile { get; set; }
+
+        [Category("Acquisition")]
+        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
+        [Description("Packet layout file for the native packet decoder (empty: vendor decoder)")]
+        public string PacketLayout { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Sample at which playback starts")]
+        public long StartSample { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Data read ahead of playback in the background (MB, 0: off)")]
+        public int Readahead { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Sample Buffer Size")]
+        public int BufferSize { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Output raw ADC codes (S16) instead of float values")]
+        public bool RawData { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Data matrix layout (ChannelMajor: one row per channel, SampleMajor: one row per sample)")]
+        public NskLayout Layout { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Lease DLL-owned block buffers instead of allocating Mats per block (data is only valid until the block is processed)")]
+        public bool ZeroCopy { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Playback speed against the host clock (1: real time, 4: four times real time, 0: as fast as possible)")]
+        public double Speed { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Read one sample every Stride samples, skipping the rest without decoding them (fast-forward and quick looks; 1: every sample)")]
+        public int Stride { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Sample Time (ms), an extra wait after each block (prefer Speed for realistic timing)")]
+        public int Interval { get; set; }
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr NSK_CreateSession();
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_DestroySession(IntPtr session);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool NSK_Open_File(IntPtr session, string DataFile);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool NSK_SetPacketDecoder(IntPtr session, string layout_file);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_SetFileReadahead(IntPtr session, int megabytes);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_SetPlaybackSpeed(IntPtr session, double speed, double sample_rate);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern ulong NSK_Get_File_Samples(IntPtr session);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool NSK_Seek_File(IntPtr session, ulong sample);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool NSK_Skip_File(IntPtr session, ulong count);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int NSK_Read_File(IntPtr session, IntPtr buffer, IntPtr sync, int buffer_size);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int NSK_Read_File_Strided(IntPtr session, IntPtr buffer, IntPtr sync, int buffer_size, int stride);
+        public static NskDataFrame NSK_Read_File(IntPtr session, int n_channels, int buffer_size, NskLayout layout = NskLayout.ChannelMajor, int stride = 1)
+        {
+            var result = layout == NskLayout.SampleMajor
+                ? new OpenCV.Net.Mat(buffer_size, n_channels, OpenCV.Net.Depth.F32, 1)
+                : new OpenCV.Net.Mat(n_channels, buffer_size, OpenCV.Net.Depth.F32, 1);
+            var sync = new OpenCV.Net.Mat(1, buffer_size, OpenCV.Net.Depth.U16, 1);
+            var samplesRead = stride > 1
+                ? NSK_Read_File_Strided(session, result.Data, sync.Data, buffer_size, stride)
+                : NSK_Read_File(session, result.Data, sync.Data, buffer_size);
+            if (samplesRead == 0) return null;
+            return new NskDataFrame(result, sync, NskSyncEvent.GetBlockEvents(session));
+        }
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int NSK_Read_File_Raw(IntPtr session, IntPtr buffer, IntPtr sync, int buffer_size);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int NSK_Read_File_Raw_Strided(IntPtr session, IntPtr buffer, IntPtr sync, int buffer_size, int stride);
+        public static NskDataFrame NSK_Read_File_Raw(IntPtr session, int n_channels, int buffer_size, NskLayout layout = NskLayout.ChannelMajor, int stride = 1)
+        {
+            var result = layout == NskLayout.SampleMajor
+                ? new OpenCV.Net.Mat(buffer_size, n_channels, OpenCV.Net.Depth.S16, 1)
+                : new OpenCV.Net.Mat(n_channels, buffer_size, OpenCV.Net.Depth.S16, 1);
+            var sync = new OpenCV.Net.Mat(1, buffer_size, OpenCV.Net.Depth.U16, 1);
+            var samplesRead = stride > 1
+                ? NSK_Read_File_Raw_Strided(session, result.Data, sync.Data, buffer_size, stride)
+                : NSK_Read_File_Raw(session, result.Data, sync.Data, buffer_size);
+            if (samplesRead == 0) return null;
+            return new NskDataFrame(result, sync, NskSyncEvent.GetBlockEvents(session));
+        }
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_SetLayout(IntPtr session, NskLayout layout);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool NSK_SetBlockPool(IntPtr session, int n_blocks, int block_size, bool raw);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int NSK_AcquireFileBlock(IntPtr session, out NskBlock block);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool NSK_ReleaseBlock(IntPtr session, ulong sequence);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_Close_File(IntPtr session);
+
+        // Constructor for File Class 
+        public File()
+        {
+            // Set Default values
+            BufferSize = 500;
+            Readahead = 64;
+            Stride = 1;
+
+            // Create a source of CvMats
+            source = Observable.Create<NskDataFrame>((observer, cancellationToken) =>
+            {
+                return Task.Factory.StartNew(() =>
+                {
+                    // Open and Initialize (each file gets its own session, so several files can play back in parallel)
+                    var session = NSK_CreateSession();
+                    NSK_SetFileReadahead(session, Readahead);
+                    if (!NSK_Open_File(session, DataFile))
+                    {
+                        NSK_DestroySession(session);
+                        throw new InvalidOperationException(string.Format("The data file '{0}' cannot be played back.", DataFile));
+                    }
+                    if (!NSK_SetPacketDecoder(session, PacketLayout))
+                    {
+                        NSK_DestroySession(session);
+                        throw new InvalidOperationException(string.Format("The packet layout '{0}' cannot be loaded.", PacketLayout));
+                    }
+                    NSK_SetPlaybackSpeed(session, Speed, 0);
+
+                    var bufferSize = BufferSize;
+                    var stride = Math.Max(Stride, 1);
+                    var zeroCopy = ZeroCopy && stride == 1; // leased blocks are filled with every sample
+                    var layout = Layout;
+                    NSK_SetLayout(session, layout);
+                    if (zeroCopy) NSK_SetBlockPool(session, 2, bufferSize, RawData);
+                    using (var destroy = Disposable.Create(() => NSK_DestroySession(session)))
+                    using (var close = Disposable.Create(() => NSK_Close_File(session)))
+                    using (var sampleSignal = new ManualResetEvent(false))
+                    {
+                        var startSample = StartSample;
+                        // Files that cannot be seeked (stream reader) skip to the start sample without decoding
+                        var seekable = NSK_Get_File_Samples(session) > 0;
+                        if (startSample > 0 && !(seekable ? NSK_Seek_File(session, (ulong)startSample) : NSK_Skip_File(session, (ulong)startSample)))
+                        {
+                            throw new ArgumentOutOfRangeException("StartSample", string.Format("The data file has {0} samples.", NSK_Get_File_Samples(session)));
+                        }
+
+                        while (!cancellationToken.IsCancellationRequested)
+                        {
+                            if (zeroCopy)
+                            {
+                                // Wrap the leased block and hand it back once downstream processing returns
+                                NskBlock block;
+                                if (NSK_AcquireFileBlock(session, out block) <= 0) break;
+                                var depth = block.Raw != 0 ? OpenCV.Net.Depth.S16 : OpenCV.Net.Depth.F32;
+                                var elementSize = block.Raw != 0 ? sizeof(short) : sizeof(float);
+                                var amplifier = block.Layout == NskLayout.SampleMajor
+                                    ? new OpenCV.Net.Mat(block.Samples, block.Channels, depth, 1, block.Data, block.Step * elementSize)
+                                    : new OpenCV.Net.Mat(block.Channels, block.Samples, depth, 1, block.Data, block.Step * elementSize);
+                                var sync = new OpenCV.Net.Mat(1, block.Samples, OpenCV.Net.Depth.U16, 1, block.Sync);
+                                observer.OnNext(new NskDataFrame(amplifier, sync, NskSyncEvent.GetBlockEvents(session)));
+                                NSK_ReleaseBlock(session, block.Sequence);
+                            }
+                            else
+                            {
+                                var result = RawData ? NSK_Read_File_Raw(session, n_channels, bufferSize, layout, stride) : NSK_Read_File(session, n_channels, bufferSize, layout, stride);
+                                if (result == null) break;
+                                observer.OnNext(result);
+                            }
+
+                            var interval = Interval;
+                            if (interval > 0)
+                            {
+                                sampleSignal.WaitOne(interval);
+                            }
+                        }
+
+                        observer.OnCompleted();
+                    }
+                },
+                cancellationToken,
+                TaskCreationOptions.LongRunning,
+                TaskScheduler.Default);
+            });
+        }
+
+        // Generate source (whatever)
+        public override IObservable<TSource> Generate()
+        {
+            return source;
+        }
+    }
+}
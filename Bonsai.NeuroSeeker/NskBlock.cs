@@ -0,0 +1,23 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Bonsai.NeuroSeeker
+{
+    // Block descriptor leased from the Nsk C DLL (matches NskBlock in BlockPool.h)
+    [StructLayout(LayoutKind.Sequential)]
+    public struct NskBlock
+    {
+        public ulong Sequence;
+        public IntPtr Data;
+        public IntPtr Sync;
+        public int Samples;
+        public int Channels;
+        public int Step;
+        public int Raw;
+        public NskLayout Layout;
+    }
+}
@@ -1,21 +1,28 @@
-﻿using OpenCV.Net;
-using System;
-using System.Collections.Generic;
-using System.Linq;
-using System.Text;
-using System.Threading.Tasks;
-
-namespace Bonsai.NeuroSeeker
-{
-    public class NskDataFrame
-    {
-        public Mat AmplifierData { get; private set; }
-        public Mat SyncData { get; private set; }
-
-        public NskDataFrame(Mat amplifier_data, Mat sync_data)
-        {
-            AmplifierData = amplifier_data;
-            SyncData = sync_data;
-        }
-    }
-}
+﻿using OpenCV.Net;
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Bonsai.NeuroSeeker
+{
+    public class NskDataFrame
+    {
+        public Mat AmplifierData { get; private set; }
+        public Mat SyncData { get; private set; }
+        public NskSyncEvent[] SyncEvents { get; private set; }
+
+        public NskDataFrame(Mat amplifier_data, Mat sync_data)
+            : this(amplifier_data, sync_data, new NskSyncEvent[0])
+        {
+        }
+
+        public NskDataFrame(Mat amplifier_data, Mat sync_data, NskSyncEvent[] sync_events)
+        {
+            AmplifierData = amplifier_data;
+            SyncData = sync_data;
+            SyncEvents = sync_events;
+        }
+    }
+}
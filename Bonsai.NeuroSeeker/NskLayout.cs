@@ -0,0 +1,15 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Bonsai.NeuroSeeker
+{
+    // Sample layout of the data matrices produced by the Nsk C DLL (matches SampleLayout in PacketBlock.h)
+    public enum NskLayout
+    {
+        ChannelMajor = 0,
+        SampleMajor = 1
+    }
+}
@@ -0,0 +1,36 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Bonsai.NeuroSeeker
+{
+    // Paced playback telemetry of the Nsk C DLL (matches NskPlaybackPacing in PlaybackPacer.h)
+    [StructLayout(LayoutKind.Sequential)]
+    public struct NskPlaybackPacing
+    {
+        public double Speed;
+        public double SampleRate;
+        public ulong Samples;
+        public ulong Blocks;
+        public ulong LateBlocks;
+        public long LagNs;
+        public long MaxLagNs;
+        public ulong WaitNs;
+        public uint Resyncs;
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void NSK_GetPlaybackPacing(IntPtr session, out NskPlaybackPacing pacing);
+
+        // Pacing of the session's file playback so far
+        public static NskPlaybackPacing Get(IntPtr session)
+        {
+            NskPlaybackPacing pacing;
+            NSK_GetPlaybackPacing(session, out pacing);
+            return pacing;
+        }
+    }
+}
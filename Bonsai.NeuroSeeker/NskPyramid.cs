@@ -0,0 +1,42 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Bonsai.NeuroSeeker
+{
+    // Min/max/mean ADC codes of one channel over a span of samples (matches NskPyramidBin in RecordingPyramid.h)
+    [StructLayout(LayoutKind.Sequential)]
+    public struct NskPyramidBin
+    {
+        public short Min;
+        public short Max;
+        public float Mean;
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        private static extern bool NSK_BuildPyramid(string recording_file, string layout_file, int threads, [Out] ulong[] result);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int NSK_QueryPyramid(IntPtr session, ulong start, ulong end, int columns, [Out] NskPyramidBin[] bins);
+
+        // Build the overview pyramid (<recording>.nskv) of a recording or manifest on all cores
+        public static bool Build(string recordingFile, string layoutFile = null)
+        {
+            var result = new ulong[3];
+            return NSK_BuildPyramid(recordingFile, layoutFile, 0, result);
+        }
+
+        // Summary of samples [start, end) of the session's playback file in columns pixel columns, column-major
+        // (bins[column * 1440 + channel], all probe channels); null if the file has no overview pyramid
+        public static NskPyramidBin[] Query(IntPtr session, ulong start, ulong end, int columns)
+        {
+            var bins = new NskPyramidBin[columns * 1440];
+            return NSK_QueryPyramid(session, start, end, columns, bins) < 0 ? null : bins;
+        }
+    }
+}
@@ -0,0 +1,16 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Bonsai.NeuroSeeker
+{
+    // Stream recording format of the Nsk C DLL (matches RecordingFormat in RecordingFile.h)
+    public enum NskRecordingFormat
+    {
+        Raw = 0,
+        Compressed = 1,
+        Packed = 2
+    }
+}
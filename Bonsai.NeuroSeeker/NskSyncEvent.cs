@@ -0,0 +1,31 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace Bonsai.NeuroSeeker
+{
+    // Sync-line edge found by the Nsk C DLL (matches NskSyncEvent in SyncEdges.h)
+    [StructLayout(LayoutKind.Sequential)]
+    public struct NskSyncEvent
+    {
+        public int Sample;
+        public short Line;
+        public short Rising;
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int NSK_GetSyncEvents(IntPtr session, [Out] NskSyncEvent[] events, int max_events);
+
+        // Edges found in the last block read by the session
+        public static NskSyncEvent[] GetBlockEvents(IntPtr session)
+        {
+            var count = NSK_GetSyncEvents(session, null, 0);
+            var events = new NskSyncEvent[count];
+            if (count > 0) NSK_GetSyncEvents(session, events, count);
+            return events;
+        }
+    }
+}
@@ -1,187 +1,378 @@
-﻿using System;
-using System.Collections.Generic;
-using System.Linq;
-using System.Text;
-using System.Threading;
-using System.Reactive.Linq;
-using System.ComponentModel;
-using System.Drawing.Design;
-using System.Reactive.Disposables;
-using System.Threading.Tasks;
-using System.Runtime.InteropServices;
-using OpenCV.Net;
-
-// TODO: replace this with the source output type.
-using TSource = OpenCV.Net.Mat;
-using Bonsai.IO;
-
-namespace Bonsai.NeuroSeeker
-{
-    public class Probe : Source<TSource>
-    {
-        // Class variables
-        IObservable<OpenCV.Net.Mat> source;
-        private int n_channels = 1440;
-
-        // Properties
-        [Category("Acquisition")]
-        [Description("Sample Buffer Size")]
-        public int BufferSize { get; set; }
-
-        [Description("Headstage LEDs")]
-        public bool LEDs { get; set; }
-
-        [Category("Testing")]
-        [Description("Enable TEST mode (generate sinewave on specified channel)")]
-        public bool TestMode { get; set; }
-
-        [Category("Acquisition")]
-        [Description("Stream Recording Switch")]
-        public bool Stream { get; set; }
-
-        [Category("Acquisition")]
-        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
-        [Description("Stream Recording File")]
-        public string StreamFile { get; set; }
-
-        [Category("Acquisition")]
-        [Description("The optional suffix used to generate file names.")]
-        public PathSuffix Suffix { get; set; }
-
-        [Category("Configuration")]
-        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
-        [Description("ADC Offset Calibration CSV")]
-        public string OffsetCSV { get; set; }
-
-        [Category("Configuration")]
-        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
-        [Description("ADC Slope Calibration CSV")]
-        public string SlopeCSV { get; set; }
-
-        [Category("Configuration")]
-        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
-        [Description("Comparator Calibration CSV")]
-        public string CompCSV { get; set; }
-
-        [Category("Configuration")]
-        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
-        [Description("Channels Calibration CSV")]
-        public string ChannelsCSV { get; set; }
-
-        [Category("Configuration")]
-        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
-        [Description("Bias Volatge (0 - 2.5V)")]
-        public float BiasVoltage { get; set; }
-
-        [Category("Configuration")]
-        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
-        [Description("Update Bias Volatge")]
-        public bool UpdateBias { get; set; }
-
-        [Category("Configuration")]
-        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
-        [Description("Active Regions")]
-        public bool[] ActiveRegions { get; set; }
-
-        // Import relevant functions from Nsk C DLL
-        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
-        public static extern void NSK_Open(bool LEDs);
-
-        // Import relevant functions from Nsk C DLL
-        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
-        public static extern void NSK_Configure(int[] ActiveRegions, bool TestMode, float BiasVoltage, string OffsetCSV, string SlopeCSV, string CompCSV, string ChannelsCSV);
-
-
-        // Import relevant functions from Nsk C DLL
-        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
-        public static extern void NSK_Start(bool Stream, string StreamFile);
-
-        // Import relevant functions from Nsk C DLL
-        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
-        private static extern int NSK_Read(IntPtr buffer, int buffer_size);
-        public static OpenCV.Net.Mat NSK_Read(int n_channels, int buffer_size)
-        {
-            var result = new OpenCV.Net.Mat(n_channels, buffer_size, OpenCV.Net.Depth.F32, 1);
-            var samplesRead = NSK_Read(result.Data, buffer_size);
-            if (samplesRead == 0) return null;
-            return result;
-        }
-
-
-        // Import relevant functions from Nsk C DLL
-        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
-        public static extern void NSK_SetBiasVoltage(float BiasVoltage);
-
-        // Import relevant functions from Nsk C DLL
-        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
-        public static extern void NSK_Close();
-
-        // Constructor for Probe Class 
-        public Probe()
-        {
-            // Set Default values
-            BufferSize = 500;
-
-            ActiveRegions = new bool[12];
-            int[] ActiveRegionsMarshal = new int[12];
-            // Create a source of CvMats
-            source = Observable.Create<Mat>((observer, cancellationToken) =>
-            {
-                return Task.Factory.StartNew(() =>
-                {
-                    // Open and Initialize
-                    NSK_Open(LEDs);
-
-                    // Configure ADCs and Channels
-                    for (int i = 0; i < ActiveRegions.Length; ++i)
-                        ActiveRegionsMarshal[i] = Convert.ToByte(ActiveRegions[i]);
-                    NSK_Configure(ActiveRegionsMarshal, TestMode, BiasVoltage, OffsetCSV, SlopeCSV, CompCSV, ChannelsCSV);
-
-                    // Start Probe thread
-                    string streamFile = StreamFile;
-                    if (!string.IsNullOrEmpty(streamFile))
-                    {
-                        PathHelper.EnsureDirectory(streamFile);
-                    }
-                    else
-                    {
-                        streamFile = System.IO.Path.Combine(System.IO.Directory.GetParent(ChannelsCSV).ToString(), "datalog.nsk");
-                        PathHelper.EnsureDirectory(streamFile);
-                    }
-                    streamFile = PathHelper.AppendSuffix(streamFile, Suffix);
-                    NSK_Start(Stream, streamFile);
-
-                    var bufferSize = BufferSize;
-                    using (var close = Disposable.Create(NSK_Close))
-                    using (var sampleSignal = new ManualResetEvent(false))
-                    {
-                        while (!cancellationToken.IsCancellationRequested)
-                        {
-                            var result = NSK_Read(n_channels, BufferSize);
-                            if (result == null) break;
-                            observer.OnNext(result);
-
-                            // Adjust Bias Voltage (online)
-                            if (UpdateBias)
-                            {
-                                NSK_SetBiasVoltage(BiasVoltage);
-                                UpdateBias = false;
-                            }
-                        }
-
-                        observer.OnCompleted();
-                    }
-                },
-                cancellationToken,
-                TaskCreationOptions.LongRunning,
-                TaskScheduler.Default);
-            });
-        }
-
-        // Generate source (whatever)
-        public override IObservable<TSource> Generate()
-        {
-            return source;
-        }
-    }
-}
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Threading;
+using System.Reactive.Linq;
+using System.ComponentModel;
+using System.Drawing.Design;
+using System.Reactive.Disposables;
+using System.Threading.Tasks;
+using System.Runtime.InteropServices;
+using OpenCV.Net;
+
+// TODO: replace this with the source output type.
+using TSource = Bonsai.NeuroSeeker.NskDataFrame;
+using Bonsai.IO;
+
+namespace Bonsai.NeuroSeeker
+{
+    public class Probe : Source<TSource>
+    {
+        // Class variables
+        IObservable<NskDataFrame> source;
+        private int n_channels = 1440;
+
+        // Properties
+        [Category("Acquisition")]
+        [Description("Sample Buffer Size")]
+        public int BufferSize { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Adapt the buffer size to the acquisition backlog, between BufferSize and MaxBufferSize samples")]
+        public bool AdaptiveBufferSize { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Largest buffer size (samples) used when AdaptiveBufferSize is enabled")]
+        public int MaxBufferSize { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Acquisition ring capacity (packets buffered between the reader thread and the workflow)")]
+        public int RingCapacity { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Output raw ADC codes (S16) instead of float values")]
+        public bool RawData { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Data matrix layout (ChannelMajor: one row per channel, SampleMajor: one row per sample)")]
+        public NskLayout Layout { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Lease DLL-owned block buffers instead of allocating a Mat per block (data is only valid until the block is processed)")]
+        public bool ZeroCopy { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Output only the live recording channels (enabled regions, without reference channels)")]
+        public bool CompactChannels { get; set; }
+
+        [Description("Headstage LEDs")]
+        public bool LEDs { get; set; }
+
+        [Category("Testing")]
+        [Description("Enable TEST mode (generate sinewave on specified channel)")]
+        public bool TestMode { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Stream Recording Switch")]
+        public bool Stream { get; set; }
+
+        [Category("Acquisition")]
+        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
+        [Description("Stream Recording File")]
+        public string StreamFile { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Stream recording format (Raw: vendor .nsk packet chains, Compressed: lossless .nskz, Packed: 10-bit codes .nskp)")]
+        public NskRecordingFormat RecordingFormat { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Start a new recording segment every this many seconds (0: no time limit); segments are listed in a .nskm manifest")]
+        public int SegmentDuration { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Start a new recording segment when the current one reaches this size in MB (0: no size limit)")]
+        public int SegmentSize { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Build the min/max/mean overview pyramid (.nskv) of the recording in the background when the probe closes")]
+        public bool BuildPyramid { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Number of 4 MB buffers queued between acquisition and the recording disk")]
+        public int WriteQueueBuffers { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Write the recording with unbuffered (direct) I/O, bypassing the OS file cache")]
+        public bool DirectIO { get; set; }
+
+        [Category("Acquisition")]
+        [Description("Interval (ms) at which the recording is flushed to disk (0: only when recording stops)")]
+        public int SyncInterval { get; set; }
+
+        [Category("Acquisition")]
+        [Description("The optional suffix used to generate file names.")]
+        public PathSuffix Suffix { get; set; }
+
+        [Category("Configuration")]
+        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
+        [Description("ADC Offset Calibration CSV")]
+        public string OffsetCSV { get; set; }
+
+        [Category("Configuration")]
+        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
+        [Description("ADC Slope Calibration CSV")]
+        public string SlopeCSV { get; set; }
+
+        [Category("Configuration")]
+        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
+        [Description("Comparator Calibration CSV")]
+        public string CompCSV { get; set; }
+
+        [Category("Configuration")]
+        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
+        [Description("Channels Calibration CSV")]
+        public string ChannelsCSV { get; set; }
+
+        [Category("Configuration")]
+        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
+        [Description("Bias Volatge (0 - 2.5V)")]
+        public float BiasVoltage { get; set; }
+
+        [Category("Configuration")]
+        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
+        [Description("Update Bias Volatge")]
+        public bool UpdateBias { get; set; }
+
+        [Category("Configuration")]
+        [Editor("Bonsai.Design.OpenFileNameEditor, Bonsai.Design", typeof(UITypeEditor))]
+        [Description("Active Regions")]
+        public bool[] ActiveRegions { get; set; }
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr NSK_CreateSession();
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_DestroySession(IntPtr session);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+        public static extern void NSK_Open(IntPtr session, bool LEDs);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+        public static extern void NSK_Configure(IntPtr session, int[] ActiveRegions, bool TestMode, float BiasVoltage, string OffsetCSV, string SlopeCSV, string CompCSV, string ChannelsCSV);
+
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_Start(IntPtr session, bool Stream, string StreamFile);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_SetRecordingFormat(IntPtr session, NskRecordingFormat format);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_SetWriteBehind(IntPtr session, int queue_buffers, int buffer_kb, bool direct_io, int sync_ms);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_SetSegmentation(IntPtr session, int seconds, int megabytes);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_SetPyramidOnClose(IntPtr session, bool enable);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_SetRingCapacity(IntPtr session, int capacity);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int NSK_Read(IntPtr session, IntPtr buffer, int buffer_size);
+        public static OpenCV.Net.Mat NSK_Read(IntPtr session, int n_channels, int buffer_size, NskLayout layout = NskLayout.ChannelMajor)
+        {
+            var result = layout == NskLayout.SampleMajor
+                ? new OpenCV.Net.Mat(buffer_size, n_channels, OpenCV.Net.Depth.F32, 1)
+                : new OpenCV.Net.Mat(n_channels, buffer_size, OpenCV.Net.Depth.F32, 1);
+            var samplesRead = NSK_Read(session, result.Data, buffer_size);
+            if (samplesRead == 0) return null;
+            return result;
+        }
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int NSK_Read_Raw(IntPtr session, IntPtr buffer, int buffer_size);
+        public static OpenCV.Net.Mat NSK_Read_Raw(IntPtr session, int n_channels, int buffer_size, NskLayout layout = NskLayout.ChannelMajor)
+        {
+            var result = layout == NskLayout.SampleMajor
+                ? new OpenCV.Net.Mat(buffer_size, n_channels, OpenCV.Net.Depth.S16, 1)
+                : new OpenCV.Net.Mat(n_channels, buffer_size, OpenCV.Net.Depth.S16, 1);
+            var samplesRead = NSK_Read_Raw(session, result.Data, buffer_size);
+            if (samplesRead == 0) return null;
+            return result;
+        }
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int NSK_Read_Sync(IntPtr session, IntPtr buffer, IntPtr sync, int buffer_size);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int NSK_Read_Raw_Sync(IntPtr session, IntPtr buffer, IntPtr sync, int buffer_size);
+        public static NskDataFrame NSK_Read_Sync(IntPtr session, int n_channels, int buffer_size, bool raw, NskLayout layout = NskLayout.ChannelMajor)
+        {
+            var depth = raw ? OpenCV.Net.Depth.S16 : OpenCV.Net.Depth.F32;
+            var result = layout == NskLayout.SampleMajor
+                ? new OpenCV.Net.Mat(buffer_size, n_channels, depth, 1)
+                : new OpenCV.Net.Mat(n_channels, buffer_size, depth, 1);
+            var sync = new OpenCV.Net.Mat(1, buffer_size, OpenCV.Net.Depth.U16, 1);
+            var samplesRead = raw ? NSK_Read_Raw_Sync(session, result.Data, sync.Data, buffer_size) : NSK_Read_Sync(session, result.Data, sync.Data, buffer_size);
+            if (samplesRead == 0) return null;
+            return new NskDataFrame(result, sync, NskSyncEvent.GetBlockEvents(session));
+        }
+
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_SetAdaptiveBlockSize(IntPtr session, int min_size, int max_size);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int NSK_NextBlockSize(IntPtr session);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_SetLayout(IntPtr session, NskLayout layout);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_SetCompaction(IntPtr session, bool compact);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int NSK_GetChannelCount(IntPtr session);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool NSK_SetBlockPool(IntPtr session, int n_blocks, int block_size, bool raw);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int NSK_AcquireBlock(IntPtr session, out NskBlock block);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        [return: MarshalAs(UnmanagedType.I1)]
+        public static extern bool NSK_ReleaseBlock(IntPtr session, ulong sequence);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_SetBiasVoltage(IntPtr session, float BiasVoltage);
+
+        // Import relevant functions from Nsk C DLL
+        [DllImport("NeuroSeeker_C_DLL", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void NSK_Close(IntPtr session);
+
+        // Constructor for Probe Class 
+        public Probe()
+        {
+            // Set Default values
+            BufferSize = 500;
+            MaxBufferSize = 4000;
+            RingCapacity = 4096;
+            WriteQueueBuffers = 32;
+
+            ActiveRegions = new bool[12];
+            int[] ActiveRegionsMarshal = new int[12];
+            // Create a source of CvMats
+            source = Observable.Create<NskDataFrame>((observer, cancellationToken) =>
+            {
+                return Task.Factory.StartNew(() =>
+                {
+                    // Open and Initialize (each probe gets its own session, so several probes can run in parallel)
+                    var session = NSK_CreateSession();
+                    NSK_Open(session, LEDs);
+
+                    // Configure ADCs and Channels
+                    for (int i = 0; i < ActiveRegions.Length; ++i)
+                        ActiveRegionsMarshal[i] = Convert.ToByte(ActiveRegions[i]);
+                    NSK_Configure(session, ActiveRegionsMarshal, TestMode, BiasVoltage, OffsetCSV, SlopeCSV, CompCSV, ChannelsCSV);
+
+                    // Start Probe thread
+                    string streamFile = StreamFile;
+                    if (!string.IsNullOrEmpty(streamFile))
+                    {
+                        PathHelper.EnsureDirectory(streamFile);
+                    }
+                    else
+                    {
+                        var defaultName = RecordingFormat == NskRecordingFormat.Compressed ? "datalog.nskz" :
+                                          RecordingFormat == NskRecordingFormat.Packed ? "datalog.nskp" : "datalog.nsk";
+                        streamFile = System.IO.Path.Combine(System.IO.Directory.GetParent(ChannelsCSV).ToString(), defaultName);
+                        PathHelper.EnsureDirectory(streamFile);
+                    }
+                    streamFile = PathHelper.AppendSuffix(streamFile, Suffix);
+                    var bufferSize = BufferSize;
+                    var adaptive = AdaptiveBufferSize;
+                    var maxBufferSize = adaptive ? Math.Max(bufferSize, MaxBufferSize) : bufferSize;
+                    NSK_SetRingCapacity(session, RingCapacity);
+                    NSK_SetAdaptiveBlockSize(session, adaptive ? bufferSize : 0, maxBufferSize);
+                    NSK_SetRecordingFormat(session, RecordingFormat);
+                    NSK_SetWriteBehind(session, WriteQueueBuffers, 0, DirectIO, SyncInterval);
+                    NSK_SetSegmentation(session, SegmentDuration, SegmentSize);
+                    NSK_SetPyramidOnClose(session, BuildPyramid);
+                    NSK_Start(session, Stream, streamFile);
+
+                    var zeroCopy = ZeroCopy;
+                    var layout = Layout;
+                    NSK_SetLayout(session, layout);
+                    NSK_SetCompaction(session, CompactChannels);
+                    var channels = NSK_GetChannelCount(session);
+                    if (zeroCopy) NSK_SetBlockPool(session, 2, maxBufferSize, RawData);
+                    using (var destroy = Disposable.Create(() => NSK_DestroySession(session)))
+                    using (var close = Disposable.Create(() => NSK_Close(session)))
+                    using (var sampleSignal = new ManualResetEvent(false))
+                    {
+                        while (!cancellationToken.IsCancellationRequested)
+                        {
+                            if (zeroCopy)
+                            {
+                                // Wrap the leased block and hand it back once downstream processing returns
+                                NskBlock block;
+                                if (NSK_AcquireBlock(session, out block) <= 0) break;
+                                var depth = block.Raw != 0 ? OpenCV.Net.Depth.S16 : OpenCV.Net.Depth.F32;
+                                var elementSize = block.Raw != 0 ? sizeof(short) : sizeof(float);
+                                var amplifier = block.Layout == NskLayout.SampleMajor
+                                    ? new OpenCV.Net.Mat(block.Samples, block.Channels, depth, 1, block.Data, block.Step * elementSize)
+                                    : new OpenCV.Net.Mat(block.Channels, block.Samples, depth, 1, block.Data, block.Step * elementSize);
+                                var sync = new OpenCV.Net.Mat(1, block.Samples, OpenCV.Net.Depth.U16, 1, block.Sync);
+                                observer.OnNext(new NskDataFrame(amplifier, sync, NskSyncEvent.GetBlockEvents(session)));
+                                NSK_ReleaseBlock(session, block.Sequence);
+                            }
+                            else
+                            {
+                                var readSize = adaptive ? NSK_NextBlockSize(session) : bufferSize;
+                                var result = NSK_Read_Sync(session, channels, readSize, RawData, layout);
+                                if (result == null) break;
+                                observer.OnNext(result);
+                            }
+
+                            // Adjust Bias Voltage (online)
+                            if (UpdateBias)
+                            {
+                                NSK_SetBiasVoltage(session, BiasVoltage);
+                                UpdateBias = false;
+                            }
+                        }
+
+                        observer.OnCompleted();
+                    }
+                },
+                cancellationToken,
+                TaskCreationOptions.LongRunning,
+                TaskScheduler.Default);
+            });
+        }
+
+        // Generate source (whatever)
+        public override IObservable<TSource> Generate()
+        {
+            return source;
+        }
+    }
+}
@@ -0,0 +1,126 @@
+// AcquisitionThread.cpp : Background reader thread between the probe and NSK_Read
+
+#include <iostream>
+
+#include "AcquisitionThread.h"
+#include "ClockModel.h"
+
+AcquisitionThread::AcquisitionThread()
+	: api(NULL), config_mutex(NULL), ring(NULL), stats(NULL), recorder(NULL), fifo(NULL), running(false), stop_requested(false),
+	last_error(READ_SUCCESS), pending_bias(-1.0f)
+{
+}
+
+AcquisitionThread::~AcquisitionThread()
+{
+	Stop();
+}
+
+void AcquisitionThread::Start(NeuroseekerAPI* _api, std::mutex* _config_mutex, PacketRing* _ring, PacketStats* _stats, RecordingWriter* _recorder,
+	FifoMonitor* _fifo)
+{
+	Stop();
+	api = _api;
+	config_mutex = _config_mutex;
+	ring = _ring;
+	stats = _stats;
+	recorder = _recorder;
+	fifo = _fifo;
+	stop_requested = false;
+	last_error = READ_SUCCESS;
+	pending_bias = -1.0f;
+	running = true;
+	thread = std::thread(&AcquisitionThread::Run, this);
+}
+
+void AcquisitionThread::Stop()
+{
+	stop_requested = true;
+	if (thread.joinable())
+		thread.join();
+	running = false;
+}
+
+bool AcquisitionThread::IsRunning() const
+{
+	return running;
+}
+
+ReadErrorCode AcquisitionThread::LastError() const
+{
+	return (ReadErrorCode)last_error.load();
+}
+
+bool AcquisitionThread::QueueBias(float volts)
+{
+	pending_bias = volts;
+	if (running) return true;
+	// The thread has ended: take the request back, unless the thread applied it on its way out
+	return pending_bias.exchange(-1.0f) < 0.0f;
+}
+
+void AcquisitionThread::ApplyBias()
+{
+	float volts = pending_bias.exchange(-1.0f);
+	if (volts < 0.0f) return;
+	DacControlErrorCode dcec;
+	{
+		std::lock_guard<std::mutex> config_lock(*config_mutex);
+		dcec = api->generateDC(DAC_C, volts);
+	}
+	std::cout << "Bias voltage applied: " << volts << "V " << dcec << "\n";
+}
+
+void AcquisitionThread::Run()
+{
+	ReadErrorCode rec;
+	int consecutive_errors = 0;
+	while (!stop_requested)
+	{
+		if (pending_bias.load(std::memory_order_relaxed) >= 0.0f) ApplyBias();
+
+		// Read next packet (sample) from FIFO, even when the ring is full, so the basestation keeps draining
+		rec = api->readElectrodeData(ep, NULL);
+		long long arrival = HostTimeNs();
+		if (fifo) fifo->Poll(arrival);
+		if (rec == DATA_ERROR && ++consecutive_errors < MAX_CONSECUTIVE_DATA_ERRORS)
+		{
+			// Drop the corrupted packet, it shows up as a counter gap downstream
+			stats->RecordDataError();
+			continue;
+		}
+		if (rec == READ_LINK_ERROR)
+		{
+			// The data link read timed out (no packet yet): keep waiting until stopped
+			stats->RecordLinkTimeout();
+			continue;
+		}
+		if (rec != READ_SUCCESS)
+		{
+			last_error = rec;
+			break;
+		}
+		consecutive_errors = 0;
+
+		PacketRecord* record = ring->BeginWrite();
+		if (record == NULL)
+		{
+			ring->RecordOverrun();
+			if (recorder)
+			{
+				copier.Copy(ep, &overrun_record);
+				recorder->Append(&overrun_record, 1);
+			}
+			continue;
+		}
+		copier.Copy(ep, record);
+		record->host_time = arrival;
+		if (recorder) recorder->Append(record, 1);
+		ring->CommitWrite();
+	}
+
+	// A bias change queued while the thread was ending (see QueueBias)
+	running = false;
+	ApplyBias();
+	ring->NotifyConsumer();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "NeuroseekerAPI.h"
+#include "ElectrodePacket.h"
+#include "FifoMonitor.h"
+#include "PacketCopier.h"
+#include "PacketRing.h"
+#include "PacketStats.h"
+#include "RecordingFile.h"
+
+// Dedicated reader thread draining the basestation FIFO into a PacketRing
+class AcquisitionThread
+{
+public:
+	AcquisitionThread();
+	~AcquisitionThread();
+
+	// Start reading electrode packets from the probe data link into the ring (DATA_ERROR packets and link timeouts are
+	// counted in stats, other read errors end acquisition),
+	// appending every packet read to the recorder if one is given (also when the ring overruns)
+	// and polling the FIFO fill level between reads if a monitor is given (config link access is serialized with
+	// config_mutex)
+	void Start(NeuroseekerAPI* api, std::mutex* config_mutex, PacketRing* ring, PacketStats* stats, RecordingWriter* recorder = NULL,
+		FifoMonitor* fifo = NULL);
+	// Request the thread to stop and wait for it to finish
+	void Stop();
+
+	// Have the thread set the probe bias voltage (DAC_C) between two reads, as the Nsk API must not be called while
+	// readElectrodeData is in progress; false if the thread is not running (the caller sets it directly then)
+	bool QueueBias(float volts);
+
+	bool IsRunning() const;
+	// Error code of the read that ended acquisition (READ_SUCCESS while running)
+	ReadErrorCode LastError() const;
+
+private:
+	void Run();
+	void ApplyBias();
+
+	NeuroseekerAPI* api;
+	std::mutex* config_mutex;
+	PacketRing* ring;
+	PacketStats* stats;
+	RecordingWriter* recorder;
+	FifoMonitor* fifo;
+	ElectrodePacket ep;
+	PacketCopier copier;
+	PacketRecord overrun_record;  // recorded packets that do not fit in the ring
+	std::thread thread;
+	std::atomic<bool> running;
+	std::atomic<bool> stop_requested;
+	std::atomic<int> last_error;
+	std::atomic<float> pending_bias;  // volts, negative when none is queued
+};
@@ -0,0 +1,127 @@
+// BlockPool.cpp : Pool of aligned block buffers for the zero-copy lease API
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#include "BlockPool.h"
+
+static void *AlignedAlloc(size_t size)
+{
+#ifdef _WIN32
+	return _aligned_malloc(size, BLOCK_ALIGNMENT);
+#else
+	void *p = NULL;
+	if (posix_memalign(&p, BLOCK_ALIGNMENT, size) != 0) return NULL;
+	return p;
+#endif
+}
+
+static void AlignedFree(void *p)
+{
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+BlockPool::BlockPool(int n_blocks, int _block_size, int n_channels, bool _raw)
+	: blocks(std::max(n_blocks, 0)), block_size(std::max(_block_size, 0)), raw(_raw), next_sequence(1)
+{
+	size_t data_bytes = (size_t)n_channels * block_size * (raw ? sizeof(short) : sizeof(float));
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		// Touch every page now so steady-state acquisition never faults on a fresh block
+		blocks[i].data = AlignedAlloc(data_bytes);
+		blocks[i].sync = (unsigned short *)AlignedAlloc(block_size * sizeof(unsigned short));
+		if (blocks[i].data) memset(blocks[i].data, 0, data_bytes);
+		if (blocks[i].sync) memset(blocks[i].sync, 0, block_size * sizeof(unsigned short));
+		blocks[i].sequence = 0;
+		blocks[i].leased = false;
+	}
+}
+
+BlockPool::~BlockPool()
+{
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		AlignedFree(blocks[i].data);
+		AlignedFree(blocks[i].sync);
+	}
+}
+
+int BlockPool::Acquire()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		if (!blocks[i].leased && blocks[i].data && blocks[i].sync)
+		{
+			blocks[i].leased = true;
+			blocks[i].sequence = next_sequence++;
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+bool BlockPool::Release(unsigned long long sequence)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		if (blocks[i].leased && blocks[i].sequence == sequence)
+		{
+			blocks[i].leased = false;
+			return true;
+		}
+	}
+	return false;
+}
+
+void BlockPool::Cancel(int index)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	blocks[index].leased = false;
+}
+
+void *BlockPool::Data(int index) const
+{
+	return blocks[index].data;
+}
+
+unsigned short *BlockPool::Sync(int index) const
+{
+	return blocks[index].sync;
+}
+
+unsigned long long BlockPool::Sequence(int index) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return blocks[index].sequence;
+}
+
+int BlockPool::BlockSize() const
+{
+	return block_size;
+}
+
+bool BlockPool::IsRaw() const
+{
+	return raw;
+}
+
+int BlockPool::Leased() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	int n = 0;
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		if (blocks[i].leased) n++;
+	}
+	return n;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+// Alignment of leased block buffers (cache line, and enough for any SIMD load)
+const int BLOCK_ALIGNMENT = 64;
+
+// Block descriptor handed to the consumer by NSK_AcquireBlock/NSK_AcquireFileBlock
+struct NskBlock
+{
+	unsigned long long sequence;  // lease id, pass to NSK_ReleaseBlock
+	void *data;                   // channel data (float or short), rows step elements apart
+	unsigned short *sync;         // sync words (NULL when the source has none)
+	int samples;                  // number of valid samples
+	int channels;                 // number of channels
+	int step;                     // distance between rows, in elements
+	int raw;                      // 1 if data holds raw ADC codes (short), 0 for float
+	int layout;                   // SampleLayout of data (channel-major: channels rows of samples,
+	                              // sample-major: samples rows of channels)
+};
+
+// Fixed pool of aligned block buffers leased to the consumer without copying or allocating
+class BlockPool
+{
+public:
+	// Negative sizes are taken as 0 (a pool with no block to lease)
+	BlockPool(int n_blocks, int block_size, int n_channels, bool raw);
+	~BlockPool();
+
+	// Lease a free block (returns its index), or -1 if every block is leased
+	int Acquire();
+	// Return the block with the given lease sequence to the pool
+	bool Release(unsigned long long sequence);
+	// Return a block that was acquired but not handed out (e.g. no data was read into it)
+	void Cancel(int index);
+
+	void *Data(int index) const;
+	unsigned short *Sync(int index) const;
+	unsigned long long Sequence(int index) const;
+
+	int BlockSize() const;
+	bool IsRaw() const;
+	int Leased() const;
+
+private:
+	struct Block
+	{
+		void *data;
+		unsigned short *sync;
+		unsigned long long sequence;
+		bool leased;
+	};
+
+	std::vector<Block> blocks;
+	int block_size;
+	bool raw;
+	unsigned long long next_sequence;
+	mutable std::mutex mutex;
+};
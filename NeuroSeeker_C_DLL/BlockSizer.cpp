@@ -0,0 +1,58 @@
+// BlockSizer.cpp : Adaptive block sizing from the probe data backlog
+
+#include <string.h>
+#include <algorithm>
+
+#include "BlockSizer.h"
+
+BlockSizer::BlockSizer()
+{
+	memset(&sizing, 0, sizeof(sizing));
+	sizing.fifo_filling = -1.0f;
+}
+
+BlockSizer::~BlockSizer()
+{
+}
+
+void BlockSizer::SetRange(int min_size, int max_size)
+{
+	memset(&sizing, 0, sizeof(sizing));
+	sizing.fifo_filling = -1.0f;
+	if (min_size <= 0) return;
+	sizing.min_size = min_size;
+	sizing.max_size = std::max(min_size, max_size);
+	sizing.block_size = min_size;
+}
+
+bool BlockSizer::IsEnabled() const
+{
+	return sizing.min_size > 0;
+}
+
+int BlockSizer::Next(float fifo_filling, float fifo_peak, float ring_filling)
+{
+	sizing.fifo_filling = fifo_filling;
+	sizing.fifo_peak = fifo_peak;
+	sizing.ring_filling = ring_filling;
+	if (!IsEnabled()) return 0;
+
+	// The reader thread keeps the FIFO drained while the ring has room, so the backlog can show up in either
+	float backlog = std::max(fifo_filling, ring_filling) / 100.0f;
+	if (backlog > BLOCK_GROW_FILLING && sizing.block_size < sizing.max_size)
+	{
+		sizing.block_size = std::min(sizing.block_size * 2, sizing.max_size);
+		sizing.grows++;
+	}
+	else if (backlog < BLOCK_SHRINK_FILLING && sizing.block_size > sizing.min_size)
+	{
+		sizing.block_size = std::max(sizing.block_size / 2, sizing.min_size);
+		sizing.shrinks++;
+	}
+	return sizing.block_size;
+}
+
+NskBlockSizing BlockSizer::Telemetry() const
+{
+	return sizing;
+}
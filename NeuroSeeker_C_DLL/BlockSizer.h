@@ -0,0 +1,40 @@
+#pragma once
+
+// Backlog (fraction of FIFO or ring capacity) above which the block size is doubled
+const float BLOCK_GROW_FILLING = 0.25f;
+// Backlog below which the block size is halved
+const float BLOCK_SHRINK_FILLING = 0.05f;
+
+// Adaptive block sizing telemetry
+struct NskBlockSizing
+{
+	int block_size;        // samples per block chosen for the next read
+	int min_size;          // lower bound (0 when adaptive sizing is off)
+	int max_size;          // upper bound
+	float fifo_filling;    // last basestation FIFO fill level (%), -1 if unknown
+	float fifo_peak;       // highest basestation FIFO fill level since start (%)
+	float ring_filling;    // acquisition ring fill level when the size was chosen (%)
+	unsigned int grows;    // number of times the block size was increased
+	unsigned int shrinks;  // number of times the block size was decreased
+};
+
+// Block size policy: grow reads while the probe data backlog builds up (catch up with fewer, larger
+// blocks), shrink them while it is near empty (lower latency)
+class BlockSizer
+{
+public:
+	BlockSizer();
+	~BlockSizer();
+
+	// Adapt between min_size and max_size samples (starting at min_size), min_size <= 0 disables
+	void SetRange(int min_size, int max_size);
+	bool IsEnabled() const;
+
+	// Choose the next block size from the FIFO and ring fill levels (%, FIFO < 0 when unknown)
+	int Next(float fifo_filling, float fifo_peak, float ring_filling);
+
+	NskBlockSizing Telemetry() const;
+
+private:
+	NskBlockSizing sizing;
+};
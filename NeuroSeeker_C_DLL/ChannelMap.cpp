@@ -0,0 +1,64 @@
+// ChannelMap.cpp : Output channel selection (active-region compaction)
+
+#include "ChannelMap.h"
+
+int ChannelRow(int channel)
+{
+	return (channel / (2 * CHANNELS_PER_ROW)) * 2 + (channel & 1);
+}
+
+std::vector<int> ChannelsInRows(int first_row, int last_row)
+{
+	std::vector<int> channels;
+	for (int c = 0; c < PROBE_ROWS * CHANNELS_PER_ROW; c++)
+	{
+		int row = ChannelRow(c);
+		if (row >= first_row && row <= last_row) channels.push_back(c);
+	}
+	return channels;
+}
+
+ChannelMap::ChannelMap(int n_channels)
+{
+	Build(std::vector<bool>(n_channels, true));
+}
+
+ChannelMap::~ChannelMap()
+{
+}
+
+void ChannelMap::Build(const std::vector<bool>& live)
+{
+	indices.clear();
+	runs.clear();
+	for (int c = 0; c < (int)live.size(); c++)
+	{
+		if (!live[c]) continue;
+
+		// Extend the current run while source channels stay consecutive
+		if (!runs.empty() && runs.back().source + runs.back().count == c)
+		{
+			runs.back().count++;
+		}
+		else {
+			ChannelRun run = { c, (int)indices.size(), 1 };
+			runs.push_back(run);
+		}
+		indices.push_back(c);
+	}
+}
+
+int ChannelMap::Count() const
+{
+	return (int)indices.size();
+}
+
+const std::vector<int>& ChannelMap::Indices() const
+{
+	return indices;
+}
+
+const std::vector<ChannelRun>& ChannelMap::Runs() const
+{
+	return runs;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+// Number of channels per probe region (12 regions of 120 channels)
+const int CHANNELS_PER_REGION = 120;
+
+// Reference channels (0-based): the 8 channels from 56 of every region, the rows ApplyProbeMap blanks
+inline constexpr bool IsReferenceChannel(int channel)
+{
+	return (channel % CHANNELS_PER_REGION) / 8 == 7;
+}
+
+// Electrode rows along the shank: 360 rows of 4 electrodes. Each block of 8 channels holds two rows, the even
+// channels in the first (the ApplyProbeMap order)
+const int CHANNELS_PER_ROW = 4;
+const int PROBE_ROWS = 360;
+
+// Electrode row of a probe channel
+int ChannelRow(int channel);
+// Probe channels of electrode rows [first_row, last_row], ascending
+std::vector<int> ChannelsInRows(int first_row, int last_row);
+
+// Contiguous run of channels copied as one piece (source probe channel -> target output row)
+struct ChannelRun
+{
+	int source;
+	int target;
+	int count;
+};
+
+// Output channel selection, stored both as an index table and as contiguous runs for the copy kernels
+class ChannelMap
+{
+public:
+	// Identity map over n_channels
+	ChannelMap(int n_channels);
+	~ChannelMap();
+
+	// Keep only the channels flagged as live (computed once, at configure time)
+	void Build(const std::vector<bool>& live);
+
+	int Count() const;
+	const std::vector<int>& Indices() const;
+	const std::vector<ChannelRun>& Runs() const;
+
+private:
+	std::vector<int> indices;
+	std::vector<ChannelRun> runs;
+};
@@ -0,0 +1,371 @@
+// ChunkCodec.cpp : Lossless linear prediction + Rice coding of recording chunks
+
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "ChunkCodec.h"
+
+// Unary quotients from this length on are escaped: the zigzag residual follows as RICE_ESCAPE_BITS raw bits
+const int RICE_ESCAPE = 24;
+const int RICE_ESCAPE_BITS = 24;
+const int RICE_MAX_K = 15;
+
+static inline int LeadingZeros(unsigned long long x)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	if (_BitScanReverse(&index, (unsigned long)(x >> 32))) return 31 - (int)index;
+	if (_BitScanReverse(&index, (unsigned long)x)) return 63 - (int)index;
+	return 64;
+#else
+	return x ? __builtin_clzll(x) : 64;
+#endif
+}
+
+static inline unsigned int ZigZag(int value)
+{
+	return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+}
+
+static inline int UnZigZag(unsigned int value)
+{
+	return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+// MSB-first bit stream appended to a byte vector
+class BitWriter
+{
+public:
+	BitWriter(std::vector<unsigned char>& _out) : out(_out), acc(0), bits(0) {}
+
+	// Append the low n bits of value (n <= 32)
+	inline void Put(unsigned int value, int n)
+	{
+		acc = (acc << n) | (value & (unsigned int)((1ULL << n) - 1));
+		bits += n;
+		while (bits >= 8)
+		{
+			bits -= 8;
+			out.push_back((unsigned char)(acc >> bits));
+		}
+	}
+
+	inline void PutRice(unsigned int value, int k)
+	{
+		unsigned int q = value >> k;
+		if (q >= (unsigned int)RICE_ESCAPE)
+		{
+			Put(1, RICE_ESCAPE + 1);
+			Put(value, RICE_ESCAPE_BITS);
+			return;
+		}
+		// q zeros and a one, then the k low bits
+		Put(1, q + 1);
+		if (k) Put(value, k);
+	}
+
+	// Pad to a byte boundary
+	void Flush()
+	{
+		if (bits > 0) Put(0, 8 - bits);
+	}
+
+private:
+	std::vector<unsigned char>& out;
+	unsigned long long acc;
+	int bits;
+};
+
+// MSB-first bit stream reader (reads zeros past the end, the caller checks Overrun)
+class BitReader
+{
+public:
+	BitReader(const unsigned char* data, size_t size) : start(data), p(data), end(data + size), buf(0), bits(0) {}
+
+	inline void Refill()
+	{
+		if (bits <= 32 && end - p >= 4)
+		{
+			unsigned int word = ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+			buf |= (unsigned long long)word << (32 - bits);
+			bits += 32;
+			p += 4;
+		}
+		while (bits <= 56)
+		{
+			buf |= (unsigned long long)(p < end ? *p : 0) << (56 - bits);
+			p++;
+			bits += 8;
+		}
+	}
+
+	inline unsigned int Get(int n)
+	{
+		if (n == 0) return 0;
+		if (bits < n) Refill();
+		unsigned int value = (unsigned int)(buf >> (64 - n));
+		buf <<= n;
+		bits -= n;
+		return value;
+	}
+
+	inline unsigned int GetRice(int k)
+	{
+		if (bits < RICE_ESCAPE + 1 + RICE_MAX_K) Refill();
+		int q = LeadingZeros(buf);
+		if (q >= RICE_ESCAPE)
+		{
+			buf <<= RICE_ESCAPE + 1;
+			bits -= RICE_ESCAPE + 1;
+			return Get(RICE_ESCAPE_BITS);
+		}
+		buf <<= q + 1;
+		bits -= q + 1;
+		if (k == 0) return (unsigned int)q;
+		unsigned int low = (unsigned int)(buf >> (64 - k));
+		buf <<= k;
+		bits -= k;
+		return ((unsigned int)q << k) | low;
+	}
+
+	// True if more bits were consumed than available
+	bool Overrun() const
+	{
+		return (unsigned long long)(p - start) * 8 - bits > (unsigned long long)(end - start) * 8;
+	}
+
+private:
+	const unsigned char* start;
+	const unsigned char* p;
+	const unsigned char* end;
+	unsigned long long buf;
+	int bits;
+};
+
+static void PutVarint(std::vector<unsigned char>& out, unsigned int value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char)value);
+}
+
+static bool GetVarint(const unsigned char*& p, const unsigned char* end, unsigned int& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 35 && p < end; shift += 7)
+	{
+		unsigned char byte = *p++;
+		value |= (unsigned int)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+// Run-length coding of a value sequence: (value, run length) varint pairs
+static void PutRuns(std::vector<unsigned char>& out, const unsigned int* values, int n)
+{
+	int i = 0;
+	while (i < n)
+	{
+		int run = 1;
+		while (i + run < n && values[i + run] == values[i]) run++;
+		PutVarint(out, values[i]);
+		PutVarint(out, (unsigned int)run);
+		i += run;
+	}
+}
+
+static bool GetRuns(const unsigned char*& p, const unsigned char* end, unsigned int* values, int n)
+{
+	int i = 0;
+	while (i < n)
+	{
+		unsigned int value, run;
+		if (!GetVarint(p, end, value) || !GetVarint(p, end, run) || run == 0 || run > (unsigned int)(n - i)) return false;
+		std::fill(values + i, values + i + run, value);
+		i += run;
+	}
+	return true;
+}
+
+RecordChunk::RecordChunk()
+	: samples(0), first_sample(0)
+{
+}
+
+void RecordChunk::Resize(int _samples)
+{
+	samples = _samples;
+	codes.resize((size_t)samples * NUMBER_OF_CHANNELS);
+	sync.resize(samples);
+	counters.resize((size_t)samples * NSKZ_COUNTERS);
+}
+
+void RecordChunk::Append(const PacketRecord& record)
+{
+	int i = samples;
+	Resize(samples + 1);
+	CopyBlockRows(record.channelData, PACKET_RECORD_STRIDE, 1, NUMBER_OF_CHANNELS, &codes[(size_t)i * NUMBER_OF_CHANNELS], NUMBER_OF_CHANNELS);
+	sync[i] = record.synchronization;
+	memcpy(&counters[(size_t)i * NSKZ_COUNTERS], record.counters, sizeof(record.counters));
+}
+
+void RecordChunk::Extract(int i, PacketRecord* record) const
+{
+	const short* src = &codes[(size_t)i * NUMBER_OF_CHANNELS];
+	for (int c = 0; c < (int)NUMBER_OF_CHANNELS; c++) record->channelData[c] = (float)src[c];
+	record->synchronization = sync[i];
+	memcpy(record->counters, &counters[(size_t)i * NSKZ_COUNTERS], sizeof(record->counters));
+}
+
+void EncodeChunkMeta(const RecordChunk& chunk, std::vector<unsigned char>& out)
+{
+	int n = chunk.samples;
+	std::vector<unsigned int> values(n);
+	for (int i = 0; i < n; i++) values[i] = chunk.sync[i];
+	PutRuns(out, &values[0], n);
+
+	// Counters: first value, then runs of (zigzag) increments
+	for (int s = 0; s < NSKZ_COUNTERS; s++)
+	{
+		unsigned int previous = 0;
+		for (int i = 0; i < n; i++)
+		{
+			unsigned int counter = chunk.counters[(size_t)i * NSKZ_COUNTERS + s];
+			values[i] = i == 0 ? counter : ZigZag((int)(counter - previous));
+			previous = counter;
+		}
+		PutRuns(out, &values[0], n);
+	}
+}
+
+bool DecodeChunkMeta(const unsigned char* data, size_t size, RecordChunk& chunk)
+{
+	int n = chunk.samples;
+	const unsigned char* p = data;
+	const unsigned char* end = data + size;
+	std::vector<unsigned int> values(n);
+	if (!GetRuns(p, end, &values[0], n)) return false;
+	for (int i = 0; i < n; i++) chunk.sync[i] = (unsigned short)values[i];
+
+	for (int s = 0; s < NSKZ_COUNTERS; s++)
+	{
+		if (!GetRuns(p, end, &values[0], n)) return false;
+		unsigned int counter = 0;
+		for (int i = 0; i < n; i++)
+		{
+			counter = i == 0 ? values[0] : counter + (unsigned int)UnZigZag(values[i]);
+			chunk.counters[(size_t)i * NSKZ_COUNTERS + s] = counter;
+		}
+	}
+	return true;
+}
+
+// Prediction residual of sample i for a predictor order (samples before the chunk count as 0)
+static inline int Residual(const int* x, int i, int order)
+{
+	int x1 = i >= 1 ? x[i - 1] : 0;
+	int x2 = i >= 2 ? x[i - 2] : 0;
+	switch (order)
+	{
+	case 0: return x[i];
+	case 1: return x[i] - x1;
+	default: return x[i] - 2 * x1 + x2;
+	}
+}
+
+// Bits taken by Rice coding the values with parameter k
+static unsigned long long RiceBits(const unsigned int* values, int n, int k)
+{
+	unsigned long long total = (unsigned long long)n * (k + 1);
+	for (int i = 0; i < n; i++)
+	{
+		unsigned int q = values[i] >> k;
+		total += q < (unsigned int)RICE_ESCAPE ? q : RICE_ESCAPE + RICE_ESCAPE_BITS - k;
+	}
+	return total;
+}
+
+void EncodeChannelGroup(const RecordChunk& chunk, int group, std::vector<unsigned char>& out)
+{
+	int n = chunk.samples;
+	std::vector<int> x(n);
+	std::vector<unsigned int> residuals(n);
+	BitWriter writer(out);
+	for (int c = group * NSKZ_GROUP_CHANNELS; c < (group + 1) * NSKZ_GROUP_CHANNELS; c++)
+	{
+		for (int i = 0; i < n; i++) x[i] = chunk.codes[(size_t)i * NUMBER_OF_CHANNELS + c];
+
+		// Predictor with the smallest absolute residual sum
+		int order = 0;
+		unsigned long long best = ~0ULL;
+		for (int o = 0; o <= NSKZ_MAX_ORDER; o++)
+		{
+			unsigned long long sum = 0;
+			for (int i = 0; i < n; i++) sum += (unsigned int)abs(Residual(&x[0], i, o));
+			if (sum < best)
+			{
+				best = sum;
+				order = o;
+			}
+		}
+		unsigned long long zigzag_sum = 0;
+		for (int i = 0; i < n; i++)
+		{
+			residuals[i] = ZigZag(Residual(&x[0], i, order));
+			zigzag_sum += residuals[i];
+		}
+
+		// Rice parameter near log2 of the mean residual, refined by exact cost
+		int estimate = 0;
+		while (estimate < RICE_MAX_K && ((unsigned long long)n << (estimate + 1)) <= zigzag_sum) estimate++;
+		int k = estimate;
+		unsigned long long bits = RiceBits(&residuals[0], n, k);
+		for (int candidate = std::max(estimate - 1, 0); candidate <= std::min(estimate + 1, RICE_MAX_K); candidate++)
+		{
+			unsigned long long candidate_bits = RiceBits(&residuals[0], n, candidate);
+			if (candidate_bits < bits)
+			{
+				bits = candidate_bits;
+				k = candidate;
+			}
+		}
+
+		writer.Put((unsigned int)((order << 4) | k), 8);
+		for (int i = 0; i < n; i++) writer.PutRice(residuals[i], k);
+	}
+	writer.Flush();
+}
+
+bool DecodeChannelGroup(const unsigned char* data, size_t size, int group, RecordChunk& chunk)
+{
+	int n = chunk.samples;
+	BitReader reader(data, size);
+	for (int c = group * NSKZ_GROUP_CHANNELS; c < (group + 1) * NSKZ_GROUP_CHANNELS; c++)
+	{
+		unsigned int header = reader.Get(8);
+		int order = (int)(header >> 4);
+		int k = (int)(header & 15);
+		if (order > NSKZ_MAX_ORDER) return false;
+
+		short* dst = &chunk.codes[c];
+		int x1 = 0, x2 = 0;
+		for (int i = 0; i < n; i++)
+		{
+			int prediction = order == 0 ? 0 : order == 1 ? x1 : 2 * x1 - x2;
+			int value = prediction + UnZigZag(reader.GetRice(k));
+			dst[(size_t)i * NUMBER_OF_CHANNELS] = (short)value;
+			x2 = x1;
+			x1 = value;
+		}
+	}
+	return !reader.Overrun();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include "PacketBlock.h"
+#include "ChannelMap.h"
+
+// Samples per compressed chunk (the unit of random access, ~0.2 s at full rate)
+const int NSKZ_CHUNK_SAMPLES = 4096;
+
+// Channels coded together (one probe region): groups are encoded in parallel and decoded independently
+const int NSKZ_GROUP_CHANNELS = CHANNELS_PER_REGION;
+const int NSKZ_GROUPS = NUMBER_OF_CHANNELS / NSKZ_GROUP_CHANNELS;
+
+// Packet counters per electrode packet
+const int NSKZ_COUNTERS = 20;
+
+// Highest linear predictor order (0: none, 1: delta, 2: linear extrapolation)
+const int NSKZ_MAX_ORDER = 2;
+
+// Uncompressed contents of one chunk, sample-major: channel values as ADC codes, sync words and packet counters
+struct RecordChunk
+{
+	RecordChunk();
+
+	void Resize(int samples);
+	// Append a packet record (values rounded to ADC codes, as the raw read path does)
+	void Append(const PacketRecord& record);
+	// Expand sample i into a packet record (host_time is left to the caller)
+	void Extract(int i, PacketRecord* record) const;
+
+	int samples;
+	unsigned long long first_sample;       // index of sample 0 in the recording
+	std::vector<short> codes;              // samples x NUMBER_OF_CHANNELS
+	std::vector<unsigned short> sync;      // samples
+	std::vector<unsigned int> counters;    // samples x NSKZ_COUNTERS
+};
+
+// Encode the sync words and counters of a chunk (run-length coded deltas), appending to out
+void EncodeChunkMeta(const RecordChunk& chunk, std::vector<unsigned char>& out);
+bool DecodeChunkMeta(const unsigned char* data, size_t size, RecordChunk& chunk);
+
+// Encode the channels of one group: per channel, the best of the NSKZ_MAX_ORDER + 1 linear predictors and
+// Rice coding of its residuals with a per-channel parameter, appending to out
+void EncodeChannelGroup(const RecordChunk& chunk, int group, std::vector<unsigned char>& out);
+// Decode one group into the chunk codes (chunk.samples must be set)
+bool DecodeChannelGroup(const unsigned char* data, size_t size, int group, RecordChunk& chunk);
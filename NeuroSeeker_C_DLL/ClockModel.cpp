@@ -0,0 +1,155 @@
+// ClockModel.cpp : Host timestamping and counter-to-wallclock drift model
+
+#include <math.h>
+#include <string.h>
+#include <chrono>
+
+#include "ClockModel.h"
+
+long long HostTimeNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ClockModel::ClockModel()
+{
+	SetWindow(DEFAULT_CLOCK_WINDOW);
+	Reset();
+}
+
+ClockModel::~ClockModel()
+{
+}
+
+void ClockModel::Reset()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	has_last = false;
+	last_counter = 0;
+	unwrapped = 0;
+	base_counter = 0;
+	base_time = 0;
+	sw = sx = sy = sxx = sxy = syy = 0.0;
+	memset(&timing, 0, sizeof(timing));
+}
+
+void ClockModel::SetWindow(double packets)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	lambda = packets > 1.0 ? exp(-1.0 / packets) : 0.0;
+}
+
+void ClockModel::BeginBlock()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	timing.samples = 0;
+}
+
+// Shift the origin of the weighted sums by (x0, y0)
+void ClockModel::Rebase(double x0, double y0)
+{
+	sxx -= 2.0 * x0 * sx - x0 * x0 * sw;
+	syy -= 2.0 * y0 * sy - y0 * y0 * sw;
+	sxy -= x0 * sy + y0 * sx - x0 * y0 * sw;
+	sx -= x0 * sw;
+	sy -= y0 * sw;
+}
+
+void ClockModel::Update(const PacketRecord* records, int n)
+{
+	if (n <= 0) return;
+	std::lock_guard<std::mutex> lock(mutex);
+	for (int i = 0; i < n; i++)
+	{
+		// Signed difference unwraps the counter across 32-bit wrap-around (and tolerates small backwards jumps)
+		unsigned int counter = records[i].counters[0];
+		if (!has_last)
+		{
+			unwrapped = counter;
+			base_counter = unwrapped;
+			base_time = records[i].host_time;
+			has_last = true;
+		}
+		else {
+			unwrapped += (long long)(int)(counter - last_counter);
+		}
+		last_counter = counter;
+
+		if (i == 0)
+		{
+			// Move the fit origin to the start of this update so the sums stay small
+			Rebase((double)(long long)(unwrapped - base_counter), (double)(records[0].host_time - base_time));
+			base_counter = unwrapped;
+			base_time = records[0].host_time;
+
+			if (timing.samples == 0)
+			{
+				timing.first_counter = unwrapped;
+				timing.first_arrival = records[0].host_time;
+			}
+		}
+
+		double x = (double)(long long)(unwrapped - base_counter);
+		double y = (double)(records[i].host_time - base_time);
+		sw = lambda * sw + 1.0;
+		sx = lambda * sx + x;
+		sy = lambda * sy + y;
+		sxx = lambda * sxx + x * x;
+		sxy = lambda * sxy + x * y;
+		syy = lambda * syy + y * y;
+	}
+	timing.samples += n;
+	timing.last_arrival = records[n - 1].host_time;
+}
+
+void ClockModel::EndBlock()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	timing.delivered = HostTimeNs();
+	NskClockModel model = Solve();
+	timing.model_first = model.reference_time + model.period * (double)(long long)(timing.first_counter - model.reference_counter);
+}
+
+NskClockModel ClockModel::Solve() const
+{
+	NskClockModel model;
+	model.reference_counter = base_counter;
+	model.weight = sw;
+	model.period = 0.0;
+	model.reference_time = (double)base_time;
+	model.jitter = 0.0;
+	if (sw <= 0.0) return model;
+
+	double mx = sx / sw;
+	double my = sy / sw;
+	double vxx = sxx / sw - mx * mx;
+	double vxy = sxy / sw - mx * my;
+	double vyy = syy / sw - my * my;
+	if (vxx > 0.0)
+	{
+		model.period = vxy / vxx;
+		double residual = vyy - model.period * vxy;
+		model.jitter = residual > 0.0 ? sqrt(residual) : 0.0;
+	}
+	model.reference_time = (double)base_time + my - model.period * mx;
+	return model;
+}
+
+NskClockModel ClockModel::Model() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return Solve();
+}
+
+NskBlockTiming ClockModel::BlockTiming() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return timing;
+}
+
+double ClockModel::CounterToHostTime(unsigned long long counter) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	NskClockModel model = Solve();
+	return model.reference_time + model.period * (double)(long long)(counter - model.reference_counter);
+}
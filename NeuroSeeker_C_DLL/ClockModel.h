@@ -0,0 +1,74 @@
+#pragma once
+
+#include <mutex>
+
+#include "PacketBlock.h"
+
+// Default fit window of the clock model, in packets (exponential forgetting time constant)
+const double DEFAULT_CLOCK_WINDOW = 200000.0;
+
+// Monotonic host time in nanoseconds
+long long HostTimeNs();
+
+// Online linear fit host_time = reference_time + period * (counter - reference_counter)
+struct NskClockModel
+{
+	unsigned long long reference_counter;  // unwrapped packet counter at the reference point
+	double reference_time;                 // fitted host time (ns) at the reference counter
+	double period;                         // fitted host ns per counter step
+	double jitter;                         // residual standard deviation (ns)
+	double weight;                         // effective number of packets in the fit
+};
+
+// Timing of the last block read
+struct NskBlockTiming
+{
+	unsigned long long first_counter;  // unwrapped packet counter of the first sample
+	int samples;                       // samples in the block
+	long long first_arrival;           // host time (ns) the first packet was read from the data link
+	long long last_arrival;            // host time (ns) the last packet was read from the data link
+	long long delivered;               // host time (ns) the block was handed to the consumer
+	double model_first;                // clock model host time (ns) of the first sample
+};
+
+// Counter-to-host-time drift model, refreshed with every block delivered to the consumer
+class ClockModel
+{
+public:
+	ClockModel();
+	~ClockModel();
+
+	// Forget the fit and the counter unwrapping (new stream)
+	void Reset();
+	// Fit window (exponential forgetting time constant), in packets
+	void SetWindow(double packets);
+
+	// Consumer: start/finish a block, and add n delivered records to the fit and to the block timing
+	void BeginBlock();
+	void Update(const PacketRecord* records, int n);
+	void EndBlock();
+
+	NskClockModel Model() const;
+	NskBlockTiming BlockTiming() const;
+	// Fitted host time (ns) of an unwrapped packet counter
+	double CounterToHostTime(unsigned long long counter) const;
+
+private:
+	void Rebase(double x0, double y0);
+	NskClockModel Solve() const;
+
+	mutable std::mutex mutex;
+	double lambda;
+
+	// Counter unwrapping (32-bit hardware counter to 64-bit)
+	bool has_last;
+	unsigned int last_counter;
+	unsigned long long unwrapped;
+
+	// Exponentially weighted sums, relative to (base_counter, base_time) to keep precision
+	unsigned long long base_counter;
+	long long base_time;
+	double sw, sx, sy, sxx, sxy, syy;
+
+	NskBlockTiming timing;
+};
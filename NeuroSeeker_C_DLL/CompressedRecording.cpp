@@ -0,0 +1,375 @@
+// CompressedRecording.cpp : Lossless .nskz recording writer and random access reader
+
+#include <string.h>
+#include <algorithm>
+
+#include "CompressedRecording.h"
+#include "PacketDecoder.h"
+
+static_assert(sizeof(NskzFileHeader) == 32 && sizeof(NskzChunkHeader) == 24 + 4 * NSKZ_GROUPS, "Unexpected .nskz header packing");
+static_assert(sizeof(NskzIndexEntry) == 16 && sizeof(NskzFooter) == 16, "Unexpected .nskz index packing");
+
+CompressedWriter::CompressedWriter(int _threads)
+	: threads(_threads), open(false), current(NULL), next_sample(0), stop_requested(false),
+	file_offset(0), samples(0), bytes_out(0), stalls(0)
+{
+}
+
+CompressedWriter::~CompressedWriter()
+{
+	Close();
+}
+
+bool CompressedWriter::Open(const std::string& filename, const NskWriteBehindOptions& options)
+{
+	Close();
+	if (!file.Open(filename, options)) return false;
+	NskzFileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = NSKZ_FILE_MAGIC;
+	header.version = NSKZ_VERSION;
+	header.channels = NUMBER_OF_CHANNELS;
+	header.chunk_samples = NSKZ_CHUNK_SAMPLES;
+	header.group_channels = NSKZ_GROUP_CHANNELS;
+	file.Write(&header, sizeof(header));
+	file_offset = sizeof(header);
+
+	// Chunk buffers are allocated once, the producer only fills them
+	pending.clear();
+	pending.resize(NSKZ_PENDING_CHUNKS);
+	free_chunks.clear();
+	for (size_t i = 1; i < pending.size(); i++) free_chunks.push_back(&pending[i]);
+	current = &pending[0];
+	current->chunk.Resize(0);
+	current->chunk.first_sample = 0;
+	next_sample = 0;
+	index.clear();
+	samples = 0;
+	bytes_out = 0;
+	stalls = 0;
+	stop_requested = false;
+
+	int n_threads = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+	n_threads = std::max(1, std::min(n_threads, NSKZ_GROUPS));
+	for (int t = 0; t < n_threads; t++) encoders.push_back(std::thread(&CompressedWriter::EncodeRun, this));
+	writer = std::thread(&CompressedWriter::WriteRun, this);
+	open = true;
+	return true;
+}
+
+bool CompressedWriter::Close()
+{
+	if (!open) return true;
+	if (current->chunk.samples > 0) Submit();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop_requested = true;
+	}
+	task_signal.notify_all();
+	done_signal.notify_all();
+	for (size_t t = 0; t < encoders.size(); t++) encoders[t].join();
+	encoders.clear();
+	writer.join();
+
+	// Index and footer make the chunks reachable without walking the file
+	NskzFooter footer;
+	footer.index_offset = file_offset;
+	footer.chunks = (unsigned int)index.size();
+	footer.magic = NSKZ_INDEX_MAGIC;
+	if (!index.empty()) file.Write(&index[0], index.size() * sizeof(NskzIndexEntry));
+	file.Write(&footer, sizeof(footer));
+	bool ok = file.Close();
+	open = false;
+	return ok;
+}
+
+bool CompressedWriter::IsOpen() const
+{
+	return open;
+}
+
+void CompressedWriter::Append(const PacketRecord* records, int n)
+{
+	for (int i = 0; i < n; i++)
+	{
+		current->chunk.Append(records[i]);
+		if (current->chunk.samples == NSKZ_CHUNK_SAMPLES) Submit();
+	}
+	samples += n;
+}
+
+NskRecordingStats CompressedWriter::Stats() const
+{
+	NskRecordingStats stats;
+	stats.samples = samples;
+	stats.bytes_in = stats.samples * PACKET_CHAIN_BYTES;
+	stats.bytes_out = bytes_out;
+	stats.stalls = stalls + file.Telemetry().stalls;
+	stats.clipped = 0;
+	return stats;
+}
+
+NskWriteBehind CompressedWriter::WriteTelemetry() const
+{
+	return file.Telemetry();
+}
+
+void CompressedWriter::Submit()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	current->remaining = NSKZ_GROUPS + 1;
+	submitted.push_back(current);
+	tasks.push_back(std::make_pair(current, -1));
+	for (int g = 0; g < NSKZ_GROUPS; g++) tasks.push_back(std::make_pair(current, g));
+	task_signal.notify_all();
+	next_sample += current->chunk.samples;
+
+	// Take the next buffer, waiting for the writer if the encoders fall behind
+	if (free_chunks.empty())
+	{
+		stalls++;
+		free_signal.wait(lock, [this] { return !free_chunks.empty(); });
+	}
+	current = free_chunks.back();
+	free_chunks.pop_back();
+	current->chunk.Resize(0);
+	current->chunk.first_sample = next_sample;
+}
+
+void CompressedWriter::EncodeRun()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		task_signal.wait(lock, [this] { return stop_requested || !tasks.empty(); });
+		if (tasks.empty()) break;
+		PendingChunk* chunk = tasks.front().first;
+		int group = tasks.front().second;
+		tasks.pop_front();
+		lock.unlock();
+
+		if (group < 0)
+		{
+			chunk->meta.clear();
+			EncodeChunkMeta(chunk->chunk, chunk->meta);
+		}
+		else
+		{
+			chunk->groups[group].clear();
+			EncodeChannelGroup(chunk->chunk, group, chunk->groups[group]);
+		}
+
+		lock.lock();
+		if (--chunk->remaining == 0) done_signal.notify_all();
+	}
+}
+
+void CompressedWriter::WriteRun()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		done_signal.wait(lock, [this] { return (!submitted.empty() && submitted.front()->remaining == 0) || (stop_requested && submitted.empty()); });
+		if (submitted.empty()) break;
+		PendingChunk* chunk = submitted.front();
+		submitted.pop_front();
+		lock.unlock();
+
+		NskzChunkHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = NSKZ_CHUNK_MAGIC;
+		header.samples = chunk->chunk.samples;
+		header.first_sample = chunk->chunk.first_sample;
+		header.meta_bytes = (unsigned int)chunk->meta.size();
+		unsigned long long size = sizeof(header) + chunk->meta.size();
+		for (int g = 0; g < NSKZ_GROUPS; g++)
+		{
+			header.group_bytes[g] = (unsigned int)chunk->groups[g].size();
+			size += chunk->groups[g].size();
+		}
+		file.Write(&header, sizeof(header));
+		file.Write(&chunk->meta[0], chunk->meta.size());
+		for (int g = 0; g < NSKZ_GROUPS; g++) file.Write(&chunk->groups[g][0], chunk->groups[g].size());
+		NskzIndexEntry entry;
+		entry.offset = file_offset;
+		entry.first_sample = header.first_sample;
+		index.push_back(entry);
+		file_offset += size;
+		bytes_out += size;
+
+		lock.lock();
+		free_chunks.push_back(chunk);
+		free_signal.notify_one();
+	}
+}
+
+CompressedReader::CompressedReader()
+	: samples(0), position(0), chunk_index(0)
+{
+}
+
+CompressedReader::~CompressedReader()
+{
+	Close();
+}
+
+bool CompressedReader::Open(const std::string& filename)
+{
+	Close();
+	file.open(filename.c_str(), std::ios::binary);
+	if (!file) return false;
+	NskzFileHeader header;
+	if (!file.read((char*)&header, sizeof(header)) || header.magic != NSKZ_FILE_MAGIC || header.version != NSKZ_VERSION ||
+		header.channels != NUMBER_OF_CHANNELS || header.group_channels != NSKZ_GROUP_CHANNELS)
+	{
+		Close();
+		return false;
+	}
+	file.seekg(0, std::ios::end);
+	unsigned long long file_size = (unsigned long long)file.tellg();
+
+	// Index from the footer, or from the chunk headers if the recording was not closed
+	bool indexed = false;
+	if (file_size >= sizeof(header) + sizeof(NskzFooter))
+	{
+		NskzFooter footer;
+		file.seekg(file_size - sizeof(footer));
+		if (file.read((char*)&footer, sizeof(footer)) && footer.magic == NSKZ_INDEX_MAGIC &&
+			footer.index_offset + (unsigned long long)footer.chunks * sizeof(NskzIndexEntry) + sizeof(footer) == file_size)
+		{
+			index.resize(footer.chunks);
+			file.seekg(footer.index_offset);
+			indexed = footer.chunks == 0 || file.read((char*)&index[0], index.size() * sizeof(NskzIndexEntry));
+		}
+	}
+	file.clear();
+	if (!indexed && !RebuildIndex(file_size))
+	{
+		Close();
+		return false;
+	}
+
+	// Total samples from the last chunk header
+	samples = 0;
+	if (!index.empty())
+	{
+		NskzChunkHeader last;
+		file.seekg(index.back().offset);
+		if (!file.read((char*)&last, sizeof(last)) || last.magic != NSKZ_CHUNK_MAGIC)
+		{
+			Close();
+			return false;
+		}
+		samples = last.first_sample + last.samples;
+	}
+	position = 0;
+	chunk_index = index.size();
+	return true;
+}
+
+void CompressedReader::Close()
+{
+	if (file.is_open()) file.close();
+	file.clear();
+	index.clear();
+	samples = 0;
+	position = 0;
+	chunk_index = 0;
+}
+
+bool CompressedReader::IsOpen() const
+{
+	return file.is_open();
+}
+
+unsigned long long CompressedReader::Samples() const
+{
+	return samples;
+}
+
+unsigned long long CompressedReader::Position() const
+{
+	return position;
+}
+
+bool CompressedReader::Seek(unsigned long long sample)
+{
+	if (sample > samples) return false;
+	position = sample;
+	return true;
+}
+
+bool CompressedReader::ReadNext(PacketRecord* record)
+{
+	const RecordChunk* current = ChunkAt(position);
+	if (current == NULL) return false;
+	current->Extract((int)(position - current->first_sample), record);
+	position++;
+	return true;
+}
+
+const RecordChunk* CompressedReader::ChunkAt(unsigned long long sample)
+{
+	if (sample >= samples) return NULL;
+	if (chunk_index < index.size() && sample >= chunk.first_sample && sample < chunk.first_sample + chunk.samples) return &chunk;
+
+	// Last chunk starting at or before the sample
+	size_t i = 0, j = index.size();
+	while (j - i > 1)
+	{
+		size_t mid = (i + j) / 2;
+		if (index[mid].first_sample <= sample) i = mid;
+		else j = mid;
+	}
+	if (!LoadChunk(i)) return NULL;
+	return sample < chunk.first_sample + chunk.samples ? &chunk : NULL;
+}
+
+bool CompressedReader::LoadChunk(size_t i)
+{
+	chunk_index = index.size();
+	NskzChunkHeader header;
+	file.clear();
+	file.seekg(index[i].offset);
+	if (!file.read((char*)&header, sizeof(header)) || header.magic != NSKZ_CHUNK_MAGIC || header.samples == 0) return false;
+	size_t size = header.meta_bytes;
+	for (int g = 0; g < NSKZ_GROUPS; g++) size += header.group_bytes[g];
+	buffer.resize(size);
+	if (!file.read((char*)&buffer[0], size)) return false;
+
+	chunk.Resize(header.samples);
+	chunk.first_sample = header.first_sample;
+	const unsigned char* p = &buffer[0];
+	if (!DecodeChunkMeta(p, header.meta_bytes, chunk)) return false;
+	p += header.meta_bytes;
+	for (int g = 0; g < NSKZ_GROUPS; g++)
+	{
+		if (!DecodeChannelGroup(p, header.group_bytes[g], g, chunk)) return false;
+		p += header.group_bytes[g];
+	}
+	chunk_index = i;
+	return true;
+}
+
+bool CompressedReader::RebuildIndex(unsigned long long file_size)
+{
+	index.clear();
+	unsigned long long offset = sizeof(NskzFileHeader);
+	while (offset + sizeof(NskzChunkHeader) <= file_size)
+	{
+		NskzChunkHeader header;
+		file.seekg(offset);
+		if (!file.read((char*)&header, sizeof(header)) || header.magic != NSKZ_CHUNK_MAGIC) break;
+		unsigned long long size = sizeof(header) + header.meta_bytes;
+		for (int g = 0; g < NSKZ_GROUPS; g++) size += header.group_bytes[g];
+		// A chunk cut short by the end of the file is dropped
+		if (offset + size > file_size) break;
+		NskzIndexEntry entry;
+		entry.offset = offset;
+		entry.first_sample = header.first_sample;
+		index.push_back(entry);
+		offset += size;
+	}
+	file.clear();
+	return true;
+}
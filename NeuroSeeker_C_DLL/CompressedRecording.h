@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ChunkCodec.h"
+#include "RecordingFile.h"
+
+// Compressed recording (.nskz) layout, all fields little-endian:
+//   file header   NskzFileHeader
+//   chunks        NskzChunkHeader, meta block, NSKZ_GROUPS channel group blocks
+//   index         NskzIndexEntry per chunk
+//   footer        NskzFooter
+// A file without footer (recording interrupted) is indexed by walking the chunk headers.
+const unsigned int NSKZ_FILE_MAGIC = 0x5A4B534E;   // "NSKZ"
+const unsigned int NSKZ_CHUNK_MAGIC = 0x4B435A4E;  // "NZCK"
+const unsigned int NSKZ_INDEX_MAGIC = 0x58495A4E;  // "NZIX"
+const unsigned int NSKZ_VERSION = 1;
+
+// Chunks buffered between the producer and the file (the producer waits when all are in flight)
+const int NSKZ_PENDING_CHUNKS = 4;
+
+struct NskzFileHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int channels;
+	unsigned int chunk_samples;
+	unsigned int group_channels;
+	unsigned int reserved[3];
+};
+
+struct NskzChunkHeader
+{
+	unsigned int magic;
+	unsigned int samples;
+	unsigned long long first_sample;
+	unsigned int meta_bytes;
+	unsigned int reserved;
+	unsigned int group_bytes[NSKZ_GROUPS];
+};
+
+struct NskzIndexEntry
+{
+	unsigned long long offset;        // file offset of the chunk header
+	unsigned long long first_sample;
+};
+
+struct NskzFooter
+{
+	unsigned long long index_offset;
+	unsigned int chunks;
+	unsigned int magic;
+};
+
+// Streaming .nskz writer: the producer appends packet records; full chunks are encoded by a pool of threads
+// (one channel group per task) and handed in order to a write-behind file by a writer thread
+class CompressedWriter : public RecordingWriter
+{
+public:
+	// Encode on threads threads (threads <= 0: all cores)
+	explicit CompressedWriter(int threads = 0);
+	~CompressedWriter();
+
+	// Create the file and start the encoder
+	bool Open(const std::string& filename, const NskWriteBehindOptions& options);
+	// Flush the last partial chunk, write the index and close the file
+	bool Close();
+	bool IsOpen() const;
+
+	// Producer: append n packet records (values are stored as ADC codes)
+	void Append(const PacketRecord* records, int n);
+
+	NskRecordingStats Stats() const;
+	NskWriteBehind WriteTelemetry() const;
+
+private:
+	struct PendingChunk
+	{
+		RecordChunk chunk;
+		std::vector<unsigned char> meta;
+		std::vector<unsigned char> groups[NSKZ_GROUPS];
+		int remaining;  // encoding tasks left
+	};
+
+	void Submit();
+	void EncodeRun();
+	void WriteRun();
+
+	WriteBehindFile file;
+	int threads;
+	bool open;
+	std::vector<PendingChunk> pending;
+	PendingChunk* current;
+	unsigned long long next_sample;
+
+	std::mutex mutex;
+	std::condition_variable task_signal;   // encoders: new tasks (or stop)
+	std::condition_variable done_signal;   // writer: chunk encoded (or stop)
+	std::condition_variable free_signal;   // producer: chunk buffer free
+	std::deque<std::pair<PendingChunk*, int> > tasks;  // chunk, group (-1: meta)
+	std::deque<PendingChunk*> submitted;               // in file order
+	std::vector<PendingChunk*> free_chunks;
+	bool stop_requested;
+	std::vector<std::thread> encoders;
+	std::thread writer;
+
+	std::vector<NskzIndexEntry> index;
+	unsigned long long file_offset;
+	std::atomic<unsigned long long> samples;
+	std::atomic<unsigned long long> bytes_out;
+	std::atomic<unsigned long long> stalls;
+};
+
+// Random access .nskz reader, decoding one chunk at a time (the last decoded chunk is cached)
+class CompressedReader : public RecordingReader
+{
+public:
+	CompressedReader();
+	~CompressedReader();
+
+	bool Open(const std::string& filename);
+	void Close();
+	bool IsOpen() const;
+
+	unsigned long long Samples() const;
+	// Sample index of the next ReadNext
+	unsigned long long Position() const;
+	bool Seek(unsigned long long sample);
+	// Decode the next sample into a packet record (false at the end of the recording or on a corrupt chunk)
+	bool ReadNext(PacketRecord* record);
+
+	// Decoded chunk holding a sample (NULL past the end or on a corrupt chunk)
+	const RecordChunk* ChunkAt(unsigned long long sample);
+
+private:
+	bool LoadChunk(size_t index);
+	bool RebuildIndex(unsigned long long file_size);
+
+	std::ifstream file;
+	std::vector<NskzIndexEntry> index;
+	unsigned long long samples;
+	unsigned long long position;
+	RecordChunk chunk;
+	size_t chunk_index;  // index of the cached chunk (index.size() if none)
+	std::vector<unsigned char> buffer;
+};
+
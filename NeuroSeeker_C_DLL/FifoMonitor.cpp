@@ -0,0 +1,62 @@
+// FifoMonitor.cpp : Basestation FIFO fill level polling
+
+#include "FifoMonitor.h"
+
+FifoMonitor::FifoMonitor()
+	: api(NULL), config_mutex(NULL), interval_ns(DEFAULT_FIFO_POLL_MS * 1000000LL), next_poll(0), running(false), filling(-1.0f), peak_filling(0.0f)
+{
+}
+
+FifoMonitor::~FifoMonitor()
+{
+	Stop();
+}
+
+void FifoMonitor::Start(NeuroseekerAPI* _api, std::mutex* _config_mutex, int _interval_ms)
+{
+	api = _api;
+	config_mutex = _config_mutex;
+	interval_ns = (_interval_ms > 0 ? _interval_ms : DEFAULT_FIFO_POLL_MS) * 1000000LL;
+	next_poll = 0;
+	filling = -1.0f;
+	peak_filling = 0.0f;
+	running = true;
+}
+
+void FifoMonitor::Stop()
+{
+	running = false;
+}
+
+bool FifoMonitor::IsRunning() const
+{
+	return running;
+}
+
+void FifoMonitor::Poll(long long now_ns)
+{
+	if (!running || now_ns < next_poll) return;
+	next_poll = now_ns + interval_ns;
+
+	float level;
+	ConfigAccessErrorCode cec;
+	{
+		std::lock_guard<std::mutex> config_lock(*config_mutex);
+		cec = api->getFifoFilling(level);
+	}
+	if (cec == CONFIG_SUCCESS)
+	{
+		filling = level;
+		if (level > peak_filling) peak_filling = level;
+	}
+}
+
+float FifoMonitor::Filling() const
+{
+	return filling.load();
+}
+
+float FifoMonitor::PeakFilling() const
+{
+	return peak_filling.load();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include "NeuroseekerAPI.h"
+
+// Default interval between basestation FIFO fill level polls
+const int DEFAULT_FIFO_POLL_MS = 20;
+
+// Basestation FIFO fill level, polled over the config link by the acquisition thread between packet reads
+// (the Nsk API must not be called from a second thread while readElectrodeData is in progress)
+class FifoMonitor
+{
+public:
+	FifoMonitor();
+	~FifoMonitor();
+
+	// Enable polling api->getFifoFilling every interval_ms (config link access is serialized with config_mutex),
+	// call before starting the thread that calls Poll
+	void Start(NeuroseekerAPI* api, std::mutex* config_mutex, int interval_ms);
+	// Disable polling, the last levels stay readable
+	void Stop();
+
+	bool IsRunning() const;
+	// Poll the fill level if interval_ms has passed since the last poll (called from the acquisition thread only)
+	void Poll(long long now_ns);
+	// Last fill level read (%), or -1 if no successful poll yet
+	float Filling() const;
+	// Highest fill level read since Start (%)
+	float PeakFilling() const;
+
+private:
+	NeuroseekerAPI* api;
+	std::mutex* config_mutex;
+	long long interval_ns;
+	long long next_poll;
+	std::atomic<bool> running;
+	std::atomic<float> filling;
+	std::atomic<float> peak_filling;
+};
@@ -0,0 +1,490 @@
+// FileExport.cpp : Parallel whole-file decoding of .nsk recordings into flat binaries
+
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "FileExport.h"
+#include "MappedFile.h"
+#include "ChannelMap.h"
+#include "PacketStats.h"
+#include "RecordingFile.h"
+
+ChainDecoder::ChainDecoder(const PacketDecoder* _decoder)
+	: decoder(_decoder), chain_copy(PACKET_CHAIN_BYTES)
+{
+}
+
+ChainDecoder::~ChainDecoder()
+{
+}
+
+ReadErrorCode ChainDecoder::Decode(const char* chain, PacketRecord* record)
+{
+	if (decoder) return decoder->Decode(chain, record);
+
+	// The vendor decoder takes a writable chain
+	memcpy(&chain_copy[0], chain, PACKET_CHAIN_BYTES);
+	ReadErrorCode rec = ep.getElectrodePacketFromChain(&chain_copy[0]);
+	if (rec == READ_SUCCESS) copier.Copy(ep, record);
+	return rec;
+}
+
+ReadErrorCode ChainDecoder::DecodeHeader(const char* chain, PacketRecord* record)
+{
+	if (decoder) return decoder->DecodeHeader(chain, record);
+	return Decode(chain, record);
+}
+
+ExportFile::ExportFile()
+	: file(NULL)
+{
+}
+
+ExportFile::~ExportFile()
+{
+	Close();
+}
+
+bool ExportFile::Create(const std::string& filename, unsigned long long size)
+{
+	Close();
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+	// Allocate the whole file up front, so the workers only overwrite
+	LARGE_INTEGER end;
+	end.QuadPart = (LONGLONG)size;
+	if (!SetFilePointerEx(handle, end, NULL, FILE_BEGIN) || !SetEndOfFile(handle))
+	{
+		CloseHandle(handle);
+		return false;
+	}
+	file = handle;
+#else
+	int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) return false;
+	if (ftruncate(fd, (off_t)size) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	file = (void*)(intptr_t)(fd + 1);
+#endif
+	return true;
+}
+
+void ExportFile::Close()
+{
+	if (file == NULL) return;
+#ifdef _WIN32
+	CloseHandle((HANDLE)file);
+#else
+	close((int)(intptr_t)file - 1);
+#endif
+	file = NULL;
+}
+
+bool ExportFile::Write(unsigned long long offset, const void* data, size_t size)
+{
+	const char* p = (const char*)data;
+	while (size > 0)
+	{
+#ifdef _WIN32
+		// Positioned write: the offset travels with the call, so threads do not share a file pointer
+		OVERLAPPED overlapped;
+		memset(&overlapped, 0, sizeof(overlapped));
+		overlapped.Offset = (DWORD)(offset & 0xFFFFFFFF);
+		overlapped.OffsetHigh = (DWORD)(offset >> 32);
+		DWORD n = 0;
+		if (!WriteFile((HANDLE)file, p, (DWORD)std::min<size_t>(size, 1 << 30), &n, &overlapped) || n == 0) return false;
+#else
+		ssize_t n = pwrite((int)(intptr_t)file - 1, p, size, (off_t)offset);
+		if (n <= 0) return false;
+#endif
+		p += n;
+		offset += n;
+		size -= n;
+	}
+	return true;
+}
+
+// Shared state of the export workers
+struct ExportJob
+{
+	ExportJob() : map(NUMBER_OF_CHANNELS), use_subset(false), next_chunk(0), data_errors(0), failed(false) {}
+
+	std::string nsk_file;
+	const PacketDecoder* decoder;
+	ChannelMap map;
+	bool use_subset;                   // extract only the codes of the selected channels (native decoder)
+	PacketDecoder::Subset subset;
+	NskExportOptions options;
+	unsigned long long packets;
+	unsigned long long chunks;
+	ExportFile out;
+	ExportFile sync;
+	bool has_sync;
+
+	std::atomic<unsigned long long> next_chunk;
+	std::atomic<unsigned long long> data_errors;
+	std::atomic<bool> failed;
+	std::mutex error_mutex;
+	std::string error;
+
+	void Fail(const std::string& message)
+	{
+		std::lock_guard<std::mutex> lock(error_mutex);
+		if (!failed) error = message;
+		failed = true;
+	}
+};
+
+// Write n packet records at sample offset of a chunk buffer (chunk_size samples, in the output layout)
+template<typename T>
+static void EmitChunk(const ExportJob& job, const PacketRecord* records, int n, T* buffer, int offset, int chunk_size)
+{
+	const std::vector<ChannelRun>& runs = job.map.Runs();
+	int n_out = job.map.Count();
+	for (size_t r = 0; r < runs.size(); r++)
+	{
+		const float* src = records[0].channelData + runs[r].source;
+		if (job.options.layout == LAYOUT_SAMPLE_MAJOR)
+			CopyBlockRows(src, PACKET_RECORD_STRIDE, n, runs[r].count, buffer + (offset * n_out) + runs[r].target, n_out);
+		else
+			TransposeBlock(src, PACKET_RECORD_STRIDE, n, runs[r].count, buffer + (runs[r].target * chunk_size) + offset, chunk_size);
+	}
+}
+
+// Find the last valid packet before a chunk, to stand in for DATA_ERROR packets at the chunk start
+static bool FindPrevious(MappedFile& file, ChainDecoder& decoder, unsigned long long start, PacketRecord* record)
+{
+	for (int i = 1; i <= MAX_CONSECUTIVE_DATA_ERRORS && (unsigned long long)i <= start; i++)
+	{
+		const char* chain = file.View((start - i) * PACKET_CHAIN_BYTES, PACKET_CHAIN_BYTES);
+		if (chain && decoder.Decode(chain, record) == READ_SUCCESS) return true;
+	}
+	return false;
+}
+
+// Write a decoded chunk of n samples starting at sample start (chunk_size samples per channel row of the buffer)
+template<typename T>
+static bool WriteChunk(ExportJob* job, unsigned long long start, int n, const T* buffer, const unsigned short* sync, int chunk_size)
+{
+	// Sample-major chunks are one contiguous range of the output, channel-major chunks one range per channel row
+	int n_out = job->map.Count();
+	bool written = true;
+	if (job->options.layout == LAYOUT_SAMPLE_MAJOR)
+	{
+		written = job->out.Write(start * n_out * sizeof(T), buffer, (size_t)n * n_out * sizeof(T));
+	}
+	else
+	{
+		for (int c = 0; c < n_out && written; c++)
+			written = job->out.Write((c * job->packets + start) * sizeof(T), buffer + ((size_t)c * chunk_size), n * sizeof(T));
+	}
+	if (written && job->has_sync) written = job->sync.Write(start * sizeof(unsigned short), sync, n * sizeof(unsigned short));
+	return written;
+}
+
+// Subset export: check each chain, extract only the codes of the selected channels and convert them through a code table
+template<typename T>
+static void ExtractWorker(ExportJob* job)
+{
+	MappedFile file;
+	if (!file.Open(job->nsk_file))
+	{
+		job->Fail("cannot map " + job->nsk_file);
+		return;
+	}
+	const PacketDecoder::Subset& subset = job->subset;
+	int n_out = (int)subset.channels.size();
+
+	// Output value of every ADC code, converted as the full export converts it
+	std::vector<float> values(job->decoder->Layout().code_values);
+	for (int code = 0; code < CHANNEL_CODES; code++) values[code] *= job->options.scale;
+	std::vector<T> table(CHANNEL_CODES);
+	CopyBlockRows(&values[0], CHANNEL_CODES, 1, CHANNEL_CODES, &table[0], CHANNEL_CODES);
+
+	std::vector<unsigned short> codes(n_out);
+	std::vector<T> previous(n_out);
+	std::vector<T> buffer((size_t)EXPORT_CHUNK_SAMPLES * n_out);
+	std::vector<unsigned short> sync(EXPORT_CHUNK_SAMPLES);
+	bool sample_major = job->options.layout == LAYOUT_SAMPLE_MAJOR;
+
+	while (!job->failed)
+	{
+		unsigned long long chunk = job->next_chunk++;
+		if (chunk >= job->chunks) break;
+		unsigned long long start = chunk * EXPORT_CHUNK_SAMPLES;
+		int n = (int)std::min<unsigned long long>(EXPORT_CHUNK_SAMPLES, job->packets - start);
+
+		// DATA_ERROR packets repeat the previous valid packet, found before the chunk for its first packets
+		unsigned short previous_sync = 0;
+		std::fill(previous.begin(), previous.end(), T());
+		for (int i = 1; i <= MAX_CONSECUTIVE_DATA_ERRORS && (unsigned long long)i <= start; i++)
+		{
+			const char* chain = file.View((start - i) * PACKET_CHAIN_BYTES, PACKET_CHAIN_BYTES);
+			if (chain == NULL || job->decoder->DecodeSubset(chain, subset, &codes[0], &previous_sync) != READ_SUCCESS) continue;
+			for (int k = 0; k < n_out; k++) previous[k] = table[codes[k]];
+			break;
+		}
+		const char* chains = file.View(start * PACKET_CHAIN_BYTES, (size_t)n * PACKET_CHAIN_BYTES);
+		if (chains == NULL)
+		{
+			job->Fail("cannot read " + job->nsk_file);
+			return;
+		}
+
+		for (int i = 0; i < n; i++)
+		{
+			if (job->decoder->DecodeSubset(chains + (size_t)i * PACKET_CHAIN_BYTES, subset, &codes[0], &sync[i]) == READ_SUCCESS)
+			{
+				for (int k = 0; k < n_out; k++) previous[k] = table[codes[k]];
+				previous_sync = sync[i];
+			}
+			else
+			{
+				job->data_errors++;
+				sync[i] = previous_sync;
+			}
+			if (sample_major)
+				std::copy(previous.begin(), previous.end(), buffer.begin() + ((size_t)i * n_out));
+			else
+				for (int k = 0; k < n_out; k++) buffer[(size_t)k * EXPORT_CHUNK_SAMPLES + i] = previous[k];
+		}
+		if (!WriteChunk(job, start, n, &buffer[0], &sync[0], EXPORT_CHUNK_SAMPLES))
+		{
+			job->Fail("write error");
+			return;
+		}
+	}
+}
+
+template<typename T>
+static void ExportWorker(ExportJob* job)
+{
+	MappedFile file;
+	if (!file.Open(job->nsk_file))
+	{
+		job->Fail("cannot map " + job->nsk_file);
+		return;
+	}
+	ChainDecoder decoder(job->decoder);
+	std::vector<PacketRecord> records(PACKET_BLOCK_SIZE);
+	PacketRecord previous;
+	int n_out = job->map.Count();
+	std::vector<T> buffer((size_t)EXPORT_CHUNK_SAMPLES * n_out);
+	std::vector<unsigned short> sync(EXPORT_CHUNK_SAMPLES);
+
+	while (!job->failed)
+	{
+		unsigned long long chunk = job->next_chunk++;
+		if (chunk >= job->chunks) break;
+		unsigned long long start = chunk * EXPORT_CHUNK_SAMPLES;
+		int n = (int)std::min<unsigned long long>(EXPORT_CHUNK_SAMPLES, job->packets - start);
+
+		// Decode in L2-sized packet blocks, then copy (and transpose) each block into the chunk buffer
+		bool has_previous = false;
+		for (int offset = 0; offset < n; offset += PACKET_BLOCK_SIZE)
+		{
+			int m = std::min(PACKET_BLOCK_SIZE, n - offset);
+			const char* chains = file.View((start + offset) * PACKET_CHAIN_BYTES, (size_t)m * PACKET_CHAIN_BYTES);
+			if (chains == NULL)
+			{
+				job->Fail("cannot read " + job->nsk_file);
+				return;
+			}
+			for (int i = 0; i < m; i++)
+			{
+				if (decoder.Decode(chains + (size_t)i * PACKET_CHAIN_BYTES, &records[i]) == READ_SUCCESS) continue;
+
+				// Keep the sample count (and time base) intact: repeat the previous valid packet
+				job->data_errors++;
+				if (i > 0)
+				{
+					records[i] = records[i - 1];
+					continue;
+				}
+				if (offset == 0) has_previous = FindPrevious(file, decoder, start, &previous);
+				if (has_previous)
+					records[i] = previous;
+				else
+					memset(&records[i], 0, sizeof(PacketRecord));
+			}
+			previous = records[m - 1];
+			has_previous = true;
+			if (job->options.scale != 1.0f)
+			{
+				for (int i = 0; i < m; i++)
+				{
+					float* values = records[i].channelData;
+					for (int c = 0; c < (int)NUMBER_OF_CHANNELS; c++) values[c] *= job->options.scale;
+				}
+			}
+			EmitChunk(*job, &records[0], m, &buffer[0], offset, EXPORT_CHUNK_SAMPLES);
+			for (int i = 0; i < m; i++) sync[offset + i] = records[i].synchronization;
+		}
+
+		if (!WriteChunk(job, start, n, &buffer[0], &sync[0], EXPORT_CHUNK_SAMPLES))
+		{
+			job->Fail("write error");
+			return;
+		}
+	}
+}
+
+bool ExportRecording(const std::string& nsk_file, const std::string& out_file, const std::string& sync_file, const PacketDecoder* decoder,
+	const std::vector<int>& channels, const NskExportOptions& options, NskExportResult& result, std::string& error)
+{
+	memset(&result, 0, sizeof(result));
+	ExportJob job;
+	job.nsk_file = nsk_file;
+	job.decoder = decoder;
+	job.options = options;
+
+	// Channel subset (kept in probe order)
+	if (!channels.empty())
+	{
+		std::vector<bool> selected(NUMBER_OF_CHANNELS, false);
+		for (size_t i = 0; i < channels.size(); i++)
+		{
+			if (channels[i] < 0 || channels[i] >= (int)NUMBER_OF_CHANNELS)
+			{
+				error = "channel out of range";
+				return false;
+			}
+			selected[channels[i]] = true;
+		}
+		job.map.Build(selected);
+
+		// Few channels: the native decoder reads only the chain words that carry them
+		if (decoder != NULL && job.map.Count() <= EXPORT_SUBSET_MAX_CHANNELS)
+			job.use_subset = decoder->PlanSubset(job.map.Indices(), job.subset);
+	}
+
+	MappedFile file;
+	if (!file.Open(nsk_file))
+	{
+		error = "cannot open " + nsk_file;
+		return false;
+	}
+	job.packets = file.Size() / PACKET_CHAIN_BYTES;
+	job.chunks = (job.packets + EXPORT_CHUNK_SAMPLES - 1) / EXPORT_CHUNK_SAMPLES;
+	file.Close();
+
+	size_t sample_size = options.format == EXPORT_FLOAT32 ? sizeof(float) : sizeof(short);
+	if (!job.out.Create(out_file, job.packets * job.map.Count() * sample_size))
+	{
+		error = "cannot create " + out_file;
+		return false;
+	}
+	job.has_sync = !sync_file.empty();
+	if (job.has_sync && !job.sync.Create(sync_file, job.packets * sizeof(unsigned short)))
+	{
+		error = "cannot create " + sync_file;
+		return false;
+	}
+
+	int n_threads = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+	if (n_threads < 1) n_threads = 1;
+	if ((unsigned long long)n_threads > job.chunks) n_threads = (int)std::max<unsigned long long>(job.chunks, 1);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < n_threads; t++)
+	{
+		if (job.use_subset)
+			workers.push_back(std::thread(options.format == EXPORT_FLOAT32 ? ExtractWorker<float> : ExtractWorker<short>, &job));
+		else if (options.format == EXPORT_FLOAT32)
+			workers.push_back(std::thread(ExportWorker<float>, &job));
+		else
+			workers.push_back(std::thread(ExportWorker<short>, &job));
+	}
+	for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+	job.out.Close();
+	job.sync.Close();
+
+	if (job.failed)
+	{
+		error = job.error;
+		return false;
+	}
+	result.samples = job.packets;
+	result.data_errors = job.data_errors;
+	return true;
+}
+
+bool ConvertRecording(const std::string& nsk_file, const std::string& out_file, const PacketDecoder* decoder, int format, int threads,
+	NskExportResult& result, std::string& error)
+{
+	memset(&result, 0, sizeof(result));
+	error.clear();
+	MappedFile file;
+	if (!file.Open(nsk_file))
+	{
+		error = "cannot open " + nsk_file;
+		return false;
+	}
+	if (format == RECORDING_PACKED && decoder && !decoder->IsIdentityMap())
+	{
+		error = "the layout's channel values are not the ADC codes, they cannot be packed";
+		return false;
+	}
+	RecordingWriter* writer = CreateRecordingWriter(format, threads);
+	if (writer == NULL)
+	{
+		error = "unsupported recording format";
+		return false;
+	}
+	if (!writer->Open(out_file, DefaultWriteBehindOptions()))
+	{
+		delete writer;
+		error = "cannot create " + out_file;
+		return false;
+	}
+
+	// Decode on this thread (the compressed writer encodes on its own pool)
+	ChainDecoder chain_decoder(decoder);
+	std::vector<PacketRecord> records(PACKET_BLOCK_SIZE);
+	unsigned long long packets = file.Size() / PACKET_CHAIN_BYTES;
+	bool has_previous = false;
+	for (unsigned long long start = 0; start < packets && error.empty(); start += PACKET_BLOCK_SIZE)
+	{
+		int m = (int)std::min<unsigned long long>(PACKET_BLOCK_SIZE, packets - start);
+		const char* chains = file.View(start * PACKET_CHAIN_BYTES, (size_t)m * PACKET_CHAIN_BYTES);
+		if (chains == NULL)
+		{
+			error = "cannot read " + nsk_file;
+			break;
+		}
+		for (int i = 0; i < m; i++)
+		{
+			if (chain_decoder.Decode(chains + (size_t)i * PACKET_CHAIN_BYTES, &records[i]) == READ_SUCCESS) continue;
+			result.data_errors++;
+			if (i > 0)
+				records[i] = records[i - 1];
+			else if (has_previous)
+				records[i] = records[PACKET_BLOCK_SIZE - 1];  // still the last packet of the previous (full) block
+			else
+				memset(&records[i], 0, sizeof(PacketRecord));
+		}
+		writer->Append(&records[0], m);
+		has_previous = true;
+	}
+	if (!writer->Close() && error.empty()) error = "write error";
+	result.clipped = writer->Stats().clipped;
+	delete writer;
+	if (!error.empty()) return false;
+	result.samples = packets;
+	return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "PacketCopier.h"
+#include "PacketDecoder.h"
+
+// Samples decoded per work item (1440 float channels x 4096 samples = 23.6 MB per worker)
+const int EXPORT_CHUNK_SAMPLES = 4096;
+// Largest channel subset exported by extracting only its codes from each chain (native decoder only), larger
+// subsets are cheaper to decode in full with the grouped channel kernels
+const int EXPORT_SUBSET_MAX_CHANNELS = 360;
+
+// Sample types of exported binaries
+enum ExportFormat
+{
+	EXPORT_INT16   = 0, // rounded (saturated) values, e.g. raw ADC codes
+	EXPORT_FLOAT32 = 1
+};
+
+// Export settings, passed as is from C# and the command line tools
+struct NskExportOptions
+{
+	int format;         // ExportFormat
+	int layout;         // SampleLayout of the output file
+	float scale;        // applied to channel values (ADC codes) before conversion, 1 keeps ADC codes
+	int threads;        // decoding threads, 0 for all cores
+};
+
+struct NskExportResult
+{
+	unsigned long long samples;      // samples (packets) written per channel
+	unsigned long long data_errors;  // packets rejected by the decoder, written as a copy of the previous packet
+	unsigned long long clipped;      // channel values rounded or saturated by the output format (ConvertRecording)
+};
+
+// Chain decoding for one worker thread: the native decoder when one is given (shared, read-only), or the
+// worker's own vendor ElectrodePacket
+class ChainDecoder
+{
+public:
+	ChainDecoder(const PacketDecoder* decoder);
+	~ChainDecoder();
+
+	// Decode one chain into a record (host_time is left to the caller)
+	ReadErrorCode Decode(const char* chain, PacketRecord* record);
+	// Decode only the status, sync word and counters where the decoder allows it (the vendor decoder decodes all)
+	ReadErrorCode DecodeHeader(const char* chain, PacketRecord* record);
+
+private:
+	const PacketDecoder* decoder;
+	ElectrodePacket ep;
+	PacketCopier copier;
+	std::vector<char> chain_copy;
+};
+
+// File written at arbitrary offsets by several threads at once
+class ExportFile
+{
+public:
+	ExportFile();
+	~ExportFile();
+
+	// Create (or truncate) the file and extend it to size bytes
+	bool Create(const std::string& filename, unsigned long long size);
+	void Close();
+
+	bool Write(unsigned long long offset, const void* data, size_t size);
+
+private:
+	void* file;
+};
+
+// Decode a whole .nsk recording on several threads into a flat binary of the given channels (ascending
+// probe channels, empty for all) and, if sync_file is not empty, a flat binary of the sync words.
+// Uses the native decoder when one is given, the vendor decoder otherwise; with the native decoder, subsets of up
+// to EXPORT_SUBSET_MAX_CHANNELS channels extract only their own codes from each chain.
+bool ExportRecording(const std::string& nsk_file, const std::string& out_file, const std::string& sync_file, const PacketDecoder* decoder,
+	const std::vector<int>& channels, const NskExportOptions& options, NskExportResult& result, std::string& error);
+
+// Convert a whole .nsk recording into one of the DLL's own recording formats (RecordingFile.h), encoding on threads
+// threads (0 for all cores) where the format supports it. DATA_ERROR packets are stored as a copy of the previous
+// packet, as in ExportRecording. The packed format is refused for a decoder whose values are not the ADC codes.
+bool ConvertRecording(const std::string& nsk_file, const std::string& out_file, const PacketDecoder* decoder, int format, int threads,
+	NskExportResult& result, std::string& error);
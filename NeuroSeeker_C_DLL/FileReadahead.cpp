@@ -0,0 +1,244 @@
+// FileReadahead.cpp : Background page cache warming ahead of file playback
+
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "FileReadahead.h"
+
+FileReadahead::FileReadahead()
+	: file(NULL), file_size(0), window(0), running(false), stop_requested(false),
+	consumer(0), prefetch_start(0), prefetch_end(0), wake_offset(0), stride(0), record(0), bytes_read(0), stalls(0)
+{
+}
+
+FileReadahead::~FileReadahead()
+{
+	Stop();
+}
+
+bool FileReadahead::Start(const std::string& filename, unsigned long long _window)
+{
+	Stop();
+#ifdef _WIN32
+	// Sequential scan: the cache manager reads further ahead and recycles pages behind the reader
+	HANDLE handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(handle, &size))
+	{
+		CloseHandle(handle);
+		return false;
+	}
+	file = handle;
+	file_size = (unsigned long long)size.QuadPart;
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+	file = (void*)(intptr_t)(fd + 1);
+	file_size = (unsigned long long)st.st_size;
+#endif
+	window = std::max<unsigned long long>(_window, READAHEAD_BLOCK_BYTES);
+	block.resize(READAHEAD_BLOCK_BYTES);
+	consumer = 0;
+	prefetch_start = 0;
+	prefetch_end = 0;
+	wake_offset = 0;
+	bytes_read = 0;
+	stalls = 0;
+	stop_requested = false;
+	running = true;
+	thread = std::thread(&FileReadahead::Run, this);
+	return true;
+}
+
+void FileReadahead::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop_requested = true;
+	}
+	signal.notify_all();
+	if (thread.joinable())
+		thread.join();
+	running = false;
+	if (file)
+	{
+#ifdef _WIN32
+		CloseHandle((HANDLE)file);
+#else
+		close((int)(intptr_t)file - 1);
+#endif
+		file = NULL;
+	}
+	window = 0;
+}
+
+bool FileReadahead::IsRunning() const
+{
+	return running;
+}
+
+void FileReadahead::Advance(unsigned long long offset, size_t size)
+{
+	if (!running) return;
+	consumer = offset;
+	if (size > 0 && offset + size > prefetch_end) stalls++;
+	// Only wake the thread once per half window (or on a jump), not on every packet
+	if (offset >= wake_offset || offset < prefetch_start || offset > prefetch_end)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		signal.notify_one();
+	}
+}
+
+void FileReadahead::SetStride(unsigned long long _stride, size_t _record)
+{
+	if (_stride == stride && _record == record) return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stride = _stride;
+		record = _record;
+	}
+	signal.notify_one();
+}
+
+NskReadahead FileReadahead::Telemetry() const
+{
+	NskReadahead telemetry;
+	unsigned long long offset = consumer;
+	unsigned long long end = prefetch_end;
+	telemetry.window = running ? window : 0;
+	telemetry.ahead = end > offset ? end - offset : 0;
+	telemetry.bytes_read = bytes_read;
+	telemetry.stalls = stalls;
+	return telemetry;
+}
+
+bool FileReadahead::IsStrided() const
+{
+	return stride > READAHEAD_BLOCK_BYTES && record > 0;
+}
+
+unsigned long long FileReadahead::Distance() const
+{
+	return IsStrided() ? std::max<unsigned long long>(window / record, 1) * stride : window;
+}
+
+unsigned long long FileReadahead::NextRecord() const
+{
+	// Records sit at the consumer offset plus multiples of the stride
+	unsigned long long offset = consumer;
+	unsigned long long end = prefetch_end;
+	if (end <= offset) return offset;
+	return offset + (end - offset + stride - 1) / stride * stride;
+}
+
+bool FileReadahead::NeedsWork() const
+{
+	unsigned long long offset = consumer;
+	if (offset < prefetch_start || offset > prefetch_end) return true;
+	if (IsStrided())
+	{
+		unsigned long long next = NextRecord();
+		return next < offset + Distance() && next < file_size;
+	}
+	return prefetch_end < offset + window && prefetch_end < file_size;
+}
+
+void FileReadahead::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!stop_requested)
+	{
+		if (!NeedsWork())
+		{
+			// Sleep until the consumer has used up half of the window
+			wake_offset = consumer + Distance() / 2;
+			signal.wait(lock, [this] { return stop_requested || NeedsWork(); });
+			continue;
+		}
+
+		// Strided reads: prefetch only the records the consumer will read
+		if (IsStrided())
+		{
+			unsigned long long offset = consumer;
+			if (offset < prefetch_start || offset > prefetch_end) prefetch_end = offset;
+			prefetch_start = offset;
+			unsigned long long next = NextRecord(), step = stride, end = prefetch_end;
+			size_t size = (size_t)std::min<unsigned long long>(record, READAHEAD_BLOCK_BYTES);
+			lock.unlock();
+			bool read = true;
+			for (int i = 0; i < READAHEAD_STRIDE_RECORDS && read && next < file_size; i++, next += step)
+			{
+				size_t n = (size_t)std::min<unsigned long long>(size, file_size - next);
+				read = ReadBlock(next, n);
+				if (read)
+				{
+					end = next + n;
+					bytes_read += n;
+				}
+			}
+			lock.lock();
+			if (!read) break;
+			prefetch_end = end;
+			continue;
+		}
+
+		// Restart at the consumer after a seek outside the prefetched range
+		unsigned long long offset = consumer;
+		unsigned long long aligned = offset - offset % READAHEAD_BLOCK_BYTES;
+		if (offset < prefetch_start || offset > prefetch_end)
+		{
+			prefetch_start = aligned;
+			prefetch_end = aligned;
+		}
+		else
+		{
+			// Pages behind the consumer may be evicted, a seek back there restarts the readahead
+			prefetch_start = aligned;
+		}
+		unsigned long long start = prefetch_end;
+		size_t size = (size_t)std::min<unsigned long long>(READAHEAD_BLOCK_BYTES, file_size - start);
+
+		lock.unlock();
+		bool read = ReadBlock(start, size);
+		lock.lock();
+		if (!read) break;
+		prefetch_end = start + size;
+		bytes_read += size;
+	}
+	running = false;
+}
+
+bool FileReadahead::ReadBlock(unsigned long long offset, size_t size)
+{
+#ifdef _WIN32
+	OVERLAPPED overlapped;
+	memset(&overlapped, 0, sizeof(overlapped));
+	overlapped.Offset = (DWORD)(offset & 0xFFFFFFFF);
+	overlapped.OffsetHigh = (DWORD)(offset >> 32);
+	DWORD n = 0;
+	return ReadFile((HANDLE)file, &block[0], (DWORD)size, &n, &overlapped) && n == size;
+#else
+	return pread((int)(intptr_t)file - 1, &block[0], size, (off_t)offset) == (ssize_t)size;
+#endif
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Default distance the playback readahead keeps ahead of the read position
+const int DEFAULT_READAHEAD_MB = 64;
+
+// Size (and alignment) of the readahead reads
+const unsigned int READAHEAD_BLOCK_BYTES = 1 << 20;
+// Records read per wake-up of the readahead thread in strided mode
+const int READAHEAD_STRIDE_RECORDS = 64;
+
+// Readahead telemetry, as returned by NSK_GetFileReadahead
+struct NskReadahead
+{
+	unsigned long long window;      // bytes kept ahead of the read position (0: readahead off)
+	unsigned long long ahead;       // bytes prefetched ahead of the read position
+	unsigned long long bytes_read;  // bytes read by the readahead thread
+	unsigned long long stalls;      // consumer reads of data that was not prefetched yet
+};
+
+// Side thread reading a playback file ahead of the consumer in large aligned blocks, so that the consumer's
+// reads (through the memory mapping) are served from the OS page cache instead of waiting on the disk
+class FileReadahead
+{
+public:
+	FileReadahead();
+	~FileReadahead();
+
+	// Start reading up to window bytes ahead of the consumer (the file is opened with sequential access hints)
+	bool Start(const std::string& filename, unsigned long long window);
+	// Request the thread to stop and wait for it to finish
+	void Stop();
+
+	bool IsRunning() const;
+	// Consumer: the next read covers [offset, offset + size) (a jump outside the prefetched range restarts there)
+	void Advance(unsigned long long offset, size_t size);
+	// Consumer reads records of record bytes every stride bytes (stride <= record: contiguous). Strides longer than a
+	// readahead block prefetch only the records, keeping window bytes of records ahead instead of window bytes of file.
+	void SetStride(unsigned long long stride, size_t record);
+
+	NskReadahead Telemetry() const;
+
+private:
+	void Run();
+	bool ReadBlock(unsigned long long offset, size_t size);
+	bool IsStrided() const;
+	// File distance covered by the window
+	unsigned long long Distance() const;
+	// Start of the next record to prefetch in strided mode
+	unsigned long long NextRecord() const;
+	bool NeedsWork() const;
+
+	void* file;                                     // file handle (Win32) or descriptor (POSIX)
+	unsigned long long file_size;
+	unsigned long long window;
+	std::vector<char> block;
+	std::thread thread;
+	std::atomic<bool> running;
+	bool stop_requested;
+	std::mutex mutex;
+	std::condition_variable signal;
+	std::atomic<unsigned long long> consumer;       // read offset of the consumer
+	std::atomic<unsigned long long> prefetch_start; // prefetched range [prefetch_start, prefetch_end)
+	std::atomic<unsigned long long> prefetch_end;
+	std::atomic<unsigned long long> wake_offset;    // consumer offset at which the idle thread is woken
+	std::atomic<unsigned long long> stride;         // consumer read pattern (SetStride)
+	std::atomic<unsigned long long> record;
+	std::atomic<unsigned long long> bytes_read;
+	std::atomic<unsigned long long> stalls;
+};
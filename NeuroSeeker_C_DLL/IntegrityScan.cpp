@@ -0,0 +1,400 @@
+// IntegrityScan.cpp : Parallel integrity check of .nsk recordings (status bits, counter continuity, sync sanity)
+
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "IntegrityScan.h"
+#include "FileExport.h"
+#include "MappedFile.h"
+#include "SegmentedRecording.h"
+#include "SyncEdges.h"
+
+NskScanOptions DefaultScanOptions()
+{
+	NskScanOptions options;
+	options.counter_step = 1;
+	options.sync_mask = 0xFFFF;
+	options.min_sync_pulse = 2;
+	options.threads = 0;
+	return options;
+}
+
+const char* ScanIssueName(int issue)
+{
+	static const char* const names[SCAN_ISSUES] = { "data_error", "counter_gap", "counter_duplicate", "counter_reset",
+		"counter_mismatch", "sync_glitch", "sync_stray", "truncated", "missing_segment" };
+	return issue >= 0 && issue < SCAN_ISSUES ? names[issue] : "unknown";
+}
+
+// Issues whose ranges grow over consecutive packets (the others are single events)
+static bool IsRunIssue(int issue)
+{
+	return issue == SCAN_DATA_ERROR || issue == SCAN_COUNTER_MISMATCH || issue == SCAN_SYNC_STRAY;
+}
+
+// Findings of one work item
+struct ChunkScan
+{
+	ChunkScan() { memset(&result, 0, sizeof(result)); }
+
+	NskScanResult result;
+	std::vector<NskBadRange> ranges;
+
+	void Add(unsigned long long first, unsigned long long count, int issue, unsigned int detail)
+	{
+		if (IsRunIssue(issue))
+		{
+			// Extend the last range of the issue when this one follows on
+			for (size_t r = ranges.size(); r-- > 0;)
+			{
+				if (ranges[r].issue != issue) continue;
+				if (ranges[r].first + ranges[r].count == first)
+				{
+					ranges[r].count += count;
+					return;
+				}
+				break;
+			}
+		}
+		if (ranges.size() >= (size_t)SCAN_MAX_CHUNK_RANGES)
+		{
+			result.ranges_dropped++;
+			return;
+		}
+		NskBadRange range = { first, count, issue, detail };
+		ranges.push_back(range);
+	}
+};
+
+// Counter and sync state carried from packet to packet
+struct ScanTracker
+{
+	ScanTracker() : has_last(false), has_reference(false), has_pending(false)
+	{
+		for (int l = 0; l < SYNC_LINES; l++) last_edge[l] = -1;
+	}
+
+	bool has_last;
+	unsigned long long last_index;
+	unsigned int last_counter;
+	unsigned short last_sync;
+	bool has_reference;
+	unsigned int reference[20];   // counters[k] - counters[0] of the consistent packets
+	bool has_pending;
+	unsigned int pending[20];     // offsets of the last packet that disagreed with the reference
+	long long last_edge[SYNC_LINES];
+};
+
+// Shared state of the scan workers
+struct ScanJob
+{
+	ScanJob() : next_chunk(0), failed(false) {}
+
+	std::vector<std::string> files;
+	const PacketDecoder* decoder;
+	NskScanOptions options;
+	unsigned long long packets;
+	unsigned long long chunks;
+	std::vector<ChunkScan> chunk_scans;
+
+	std::atomic<unsigned long long> next_chunk;
+	std::atomic<bool> failed;
+	std::mutex error_mutex;
+	std::string error;
+
+	void Fail(const std::string& message)
+	{
+		std::lock_guard<std::mutex> lock(error_mutex);
+		if (!failed) error = message;
+		failed = true;
+	}
+};
+
+// Check one decoded packet against the packets before it (findings only reported when report is set)
+static void CheckPacket(const ScanJob& job, ScanTracker& tracker, const PacketRecord& record, unsigned long long index, bool report, ChunkScan& scan)
+{
+	const NskScanOptions& options = job.options;
+	if (tracker.has_last)
+	{
+		// Counter 0 continuity (DATA_ERROR packets in between still count as present)
+		unsigned long long distance = index - tracker.last_index;
+		unsigned int expected = (unsigned int)(options.counter_step * distance);
+		unsigned int delta = record.counters[0] - tracker.last_counter;
+		if (delta != expected && report)
+		{
+			if (delta == 0)
+			{
+				scan.result.duplicates++;
+				scan.Add(index, 1, SCAN_COUNTER_DUPLICATE, 0);
+			}
+			else if ((int)delta < 0 || delta < expected || delta % options.counter_step != 0)
+			{
+				scan.result.resets++;
+				scan.Add(index, 1, SCAN_COUNTER_RESET, delta);
+			}
+			else
+			{
+				unsigned int lost = delta / options.counter_step - (unsigned int)distance;
+				scan.result.gaps++;
+				scan.result.lost += lost;
+				scan.Add(index, 1, SCAN_COUNTER_GAP, lost);
+			}
+		}
+	}
+
+	// Counters 1-19 keep a fixed offset to counter 0; a new offset pattern is adopted once two packets agree on it
+	unsigned int offsets[20];
+	for (int k = 0; k < 20; k++) offsets[k] = record.counters[k] - record.counters[0];
+	if (!tracker.has_reference)
+	{
+		memcpy(tracker.reference, offsets, sizeof(offsets));
+		tracker.has_reference = true;
+	}
+	else if (memcmp(tracker.reference, offsets, sizeof(offsets)) != 0)
+	{
+		if (tracker.has_pending && memcmp(tracker.pending, offsets, sizeof(offsets)) == 0)
+		{
+			memcpy(tracker.reference, offsets, sizeof(offsets));
+			tracker.has_pending = false;
+		}
+		else
+		{
+			int k = 1;
+			while (k < 19 && offsets[k] == tracker.reference[k]) k++;
+			if (report)
+			{
+				scan.result.counter_mismatches++;
+				scan.Add(index, 1, SCAN_COUNTER_MISMATCH, k);
+			}
+			memcpy(tracker.pending, offsets, sizeof(offsets));
+			tracker.has_pending = true;
+		}
+	}
+	else
+	{
+		tracker.has_pending = false;
+	}
+
+	// Sync word: bits outside the line mask, and pulses shorter than the minimum
+	unsigned short sync = record.synchronization;
+	unsigned short stray = (unsigned short)(sync & ~options.sync_mask);
+	if (stray && report)
+	{
+		scan.result.sync_stray++;
+		scan.Add(index, 1, SCAN_SYNC_STRAY, stray);
+	}
+	if (tracker.has_last && options.min_sync_pulse > 0)
+	{
+		unsigned short changed = (unsigned short)((sync ^ tracker.last_sync) & options.sync_mask);
+		for (int l = 0; changed; l++, changed >>= 1)
+		{
+			if ((changed & 1) == 0) continue;
+			long long edge = tracker.last_edge[l];
+			if (edge >= 0 && (long long)index - edge < options.min_sync_pulse && report)
+			{
+				scan.result.sync_glitches++;
+				scan.Add((unsigned long long)edge, index - edge, SCAN_SYNC_GLITCH, l);
+			}
+			tracker.last_edge[l] = (long long)index;
+		}
+	}
+
+	tracker.has_last = true;
+	tracker.last_index = index;
+	tracker.last_counter = record.counters[0];
+	tracker.last_sync = sync;
+}
+
+static void ScanWorker(ScanJob* job)
+{
+	// Segments back-to-back, as packets are indexed when the files are listed (a hole shows up as a counter gap)
+	NeuroseekerDataLinkMapped link(job->files, std::vector<unsigned long long>());
+	if (!link.IsOpen())
+	{
+		job->Fail("cannot map " + job->files[0]);
+		return;
+	}
+	ChainDecoder decoder(job->decoder);
+	PacketRecord record;
+
+	while (!job->failed)
+	{
+		unsigned long long chunk = job->next_chunk++;
+		if (chunk >= job->chunks) break;
+		unsigned long long start = chunk * SCAN_CHUNK_SAMPLES;
+		unsigned long long end = std::min(start + SCAN_CHUNK_SAMPLES, job->packets);
+		unsigned long long lookback = std::max(SCAN_LOOKBACK_SAMPLES, job->options.min_sync_pulse);
+		unsigned long long seed = start - std::min(start, lookback);
+		ChunkScan& scan = job->chunk_scans[(size_t)chunk];
+		ScanTracker tracker;
+		if (!link.Seek(seed))
+		{
+			job->Fail("cannot seek " + job->files[0]);
+			return;
+		}
+		for (unsigned long long index = seed; index < end; index++)
+		{
+			const char* chain = link.NextChain();
+			if (chain == NULL)
+			{
+				job->Fail("cannot read " + job->files[0]);
+				return;
+			}
+			bool report = index >= start;
+			if (decoder.DecodeHeader(chain, &record) != READ_SUCCESS)
+			{
+				if (report)
+				{
+					scan.result.data_errors++;
+					scan.Add(index, 1, SCAN_DATA_ERROR, 0);
+				}
+				continue;
+			}
+			CheckPacket(*job, tracker, record, index, report, scan);
+		}
+		scan.result.packets = end - start;
+	}
+}
+
+static void Accumulate(NskScanResult& total, const NskScanResult& part)
+{
+	total.packets += part.packets;
+	total.data_errors += part.data_errors;
+	total.gaps += part.gaps;
+	total.lost += part.lost;
+	total.duplicates += part.duplicates;
+	total.resets += part.resets;
+	total.counter_mismatches += part.counter_mismatches;
+	total.sync_glitches += part.sync_glitches;
+	total.sync_stray += part.sync_stray;
+	total.truncated_bytes += part.truncated_bytes;
+	total.missing_segments += part.missing_segments;
+	total.ranges_dropped += part.ranges_dropped;
+}
+
+static bool RangeBefore(const NskBadRange& a, const NskBadRange& b)
+{
+	return a.first != b.first ? a.first < b.first : a.issue < b.issue;
+}
+
+bool ScanRecording(const std::string& nsk_file, const PacketDecoder* decoder, const NskScanOptions& options, NskScanResult& result,
+	std::vector<NskBadRange>& ranges, std::string& error)
+{
+	memset(&result, 0, sizeof(result));
+	ranges.clear();
+	error.clear();
+	ScanJob job;
+	job.decoder = decoder;
+	job.options = options;
+	if (job.options.counter_step == 0) job.options.counter_step = 1;
+
+	// Segment files, checked here for the ones the mapped data link leaves out or cuts short
+	if (IsManifestFile(nsk_file))
+	{
+		RecordingManifest manifest;
+		if (!ReadManifest(nsk_file, manifest) || manifest.format != RECORDING_RAW)
+		{
+			error = "not a raw recording manifest";
+			return false;
+		}
+		for (size_t i = 0; i < manifest.segments.size(); i++)
+			job.files.push_back(ManifestSegmentPath(nsk_file, manifest.segments[i].file));
+	}
+	else
+	{
+		job.files.push_back(nsk_file);
+	}
+	ChunkScan files;
+	unsigned long long packets = 0;
+	for (size_t i = 0; i < job.files.size(); i++)
+	{
+		MappedFile file;
+		if (!file.Open(job.files[i]) || file.Size() < PACKET_CHAIN_BYTES)
+		{
+			files.result.missing_segments++;
+			files.Add(packets, 0, SCAN_MISSING_SEGMENT, (unsigned int)i);
+			continue;
+		}
+		packets += file.Size() / PACKET_CHAIN_BYTES;
+		unsigned int partial = (unsigned int)(file.Size() % PACKET_CHAIN_BYTES);
+		if (partial)
+		{
+			files.result.truncated_bytes += partial;
+			files.Add(packets, 0, SCAN_TRUNCATED, partial);
+		}
+	}
+	if (files.result.missing_segments == job.files.size())
+	{
+		error = "cannot open " + nsk_file;
+		return false;
+	}
+	job.packets = packets;
+	job.chunks = (job.packets + SCAN_CHUNK_SAMPLES - 1) / SCAN_CHUNK_SAMPLES;
+	job.chunk_scans.resize((size_t)job.chunks);
+
+	int n_threads = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+	if (n_threads < 1) n_threads = 1;
+	if ((unsigned long long)n_threads > job.chunks) n_threads = (int)std::max<unsigned long long>(job.chunks, 1);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < n_threads; t++) workers.push_back(std::thread(ScanWorker, &job));
+	for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+	if (job.failed)
+	{
+		error = job.error;
+		return false;
+	}
+
+	// Gather in packet order, joining runs that cross work item boundaries
+	std::vector<NskBadRange> all(files.ranges);
+	Accumulate(result, files.result);
+	for (size_t c = 0; c < job.chunk_scans.size(); c++)
+	{
+		Accumulate(result, job.chunk_scans[c].result);
+		all.insert(all.end(), job.chunk_scans[c].ranges.begin(), job.chunk_scans[c].ranges.end());
+	}
+	std::stable_sort(all.begin(), all.end(), RangeBefore);
+	std::vector<long long> last_of_issue(SCAN_ISSUES, -1);
+	for (size_t r = 0; r < all.size(); r++)
+	{
+		long long last = last_of_issue[all[r].issue];
+		if (IsRunIssue(all[r].issue) && last >= 0 && ranges[(size_t)last].first + ranges[(size_t)last].count == all[r].first)
+		{
+			ranges[(size_t)last].count += all[r].count;
+			continue;
+		}
+		last_of_issue[all[r].issue] = (long long)ranges.size();
+		ranges.push_back(all[r]);
+	}
+	result.ranges = ranges.size();
+	return true;
+}
+
+bool WriteScanReport(const std::string& report_file, const std::string& nsk_file, const NskScanResult& result,
+	const std::vector<NskBadRange>& ranges)
+{
+	std::ofstream out(report_file.c_str(), std::ios::trunc);
+	out << SCAN_REPORT_TAG << " " << SCAN_REPORT_VERSION << " " << nsk_file << "\n";
+	out << "packets " << result.packets << "\n";
+	out << "data_errors " << result.data_errors << "\n";
+	out << "gaps " << result.gaps << "\n";
+	out << "lost " << result.lost << "\n";
+	out << "duplicates " << result.duplicates << "\n";
+	out << "resets " << result.resets << "\n";
+	out << "counter_mismatches " << result.counter_mismatches << "\n";
+	out << "sync_glitches " << result.sync_glitches << "\n";
+	out << "sync_stray " << result.sync_stray << "\n";
+	out << "truncated_bytes " << result.truncated_bytes << "\n";
+	out << "missing_segments " << result.missing_segments << "\n";
+	out << "ranges " << result.ranges << "\n";
+	out << "ranges_dropped " << result.ranges_dropped << "\n";
+	for (size_t r = 0; r < ranges.size(); r++)
+	{
+		const NskBadRange& range = ranges[r];
+		out << ScanIssueName(range.issue) << " " << range.first << " " << range.count << " " << range.detail << "\n";
+	}
+	return (bool)out;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "PacketDecoder.h"
+
+// Packets checked per work item (16 MB of chains)
+const int SCAN_CHUNK_SAMPLES = 8192;
+// Packets before a work item replayed (without reporting) to seed the counter and sync checks
+const int SCAN_LOOKBACK_SAMPLES = 64;
+// Bad ranges kept per work item, the rest are only counted
+const int SCAN_MAX_CHUNK_RANGES = 256;
+
+// Scan report tag and version
+const char* const SCAN_REPORT_TAG = "NSK_SCAN_REPORT";
+const int SCAN_REPORT_VERSION = 1;
+
+// What is wrong with a range of packets
+enum ScanIssue
+{
+	SCAN_DATA_ERROR        = 0, // packets rejected by the decoder with DATA_ERROR (bad status bits)
+	SCAN_COUNTER_GAP       = 1, // counter 0 jumps ahead at the packet (detail: packets lost before it)
+	SCAN_COUNTER_DUPLICATE = 2, // counter 0 repeats the previous packet's
+	SCAN_COUNTER_RESET     = 3, // counter 0 jumps backwards or off the step (detail: counter increment)
+	SCAN_COUNTER_MISMATCH  = 4, // counters 1-19 lose their offset to counter 0 (detail: first such counter)
+	SCAN_SYNC_GLITCH       = 5, // sync line level held for less than the minimum pulse (detail: line)
+	SCAN_SYNC_STRAY        = 6, // sync bits set outside the line mask (detail: stray bits of the first packet)
+	SCAN_TRUNCATED         = 7, // partial chain after the packet before first (detail: bytes), count 0
+	SCAN_MISSING_SEGMENT   = 8, // manifest segment unreadable or empty, before first (detail: segment), count 0
+	SCAN_ISSUES            = 9
+};
+
+// Scan settings, passed as is from C# and the command line tools
+struct NskScanOptions
+{
+	unsigned int counter_step;    // expected counter 0 increment between consecutive packets
+	unsigned int sync_mask;       // sync lines in use (bits outside are stray)
+	int min_sync_pulse;           // shortest valid sync pulse in samples (0: no glitch check)
+	int threads;                  // scanning threads, 0 for all cores
+};
+
+struct NskScanResult
+{
+	unsigned long long packets;          // complete chains scanned
+	unsigned long long data_errors;      // packets rejected with DATA_ERROR
+	unsigned long long gaps;             // counter 0 jumps ahead
+	unsigned long long lost;             // packets missing inside those gaps
+	unsigned long long duplicates;
+	unsigned long long resets;
+	unsigned long long counter_mismatches;
+	unsigned long long sync_glitches;
+	unsigned long long sync_stray;       // packets with stray sync bits
+	unsigned long long truncated_bytes;  // bytes of partial chains
+	unsigned long long missing_segments;
+	unsigned long long ranges;           // bad ranges reported
+	unsigned long long ranges_dropped;   // bad ranges over the per-work-item limit (counted above, not listed)
+};
+
+// One bad range of packets (global packet indices over all segments of a manifest)
+struct NskBadRange
+{
+	unsigned long long first;
+	unsigned long long count;
+	int issue;                   // ScanIssue
+	unsigned int detail;
+};
+
+NskScanOptions DefaultScanOptions();
+const char* ScanIssueName(int issue);
+
+// Check every packet of a raw .nsk recording (or the segments of a raw manifest) on several threads: status bits,
+// continuity of the 20 counters and sync word sanity. Uses the native decoder when one is given (only the status
+// bits, sync word and counters are decoded), the vendor decoder otherwise. Ranges are sorted by first packet.
+bool ScanRecording(const std::string& nsk_file, const PacketDecoder* decoder, const NskScanOptions& options, NskScanResult& result,
+	std::vector<NskBadRange>& ranges, std::string& error);
+
+// Report: tag line, "<counter> <value>" totals, then one "<issue> <first> <count> <detail>" line per range
+bool WriteScanReport(const std::string& report_file, const std::string& nsk_file, const NskScanResult& result,
+	const std::vector<NskBadRange>& ranges);
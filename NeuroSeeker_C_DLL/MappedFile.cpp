@@ -0,0 +1,297 @@
+// MappedFile.cpp : Memory-mapped, randomly accessible .nsk playback
+
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+MappedFile::MappedFile()
+	: file(NULL), mapping(NULL), view(NULL), view_offset(0), view_size(0), size(0), granularity(1)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+#ifdef _WIN32
+	// Shared for writing too, so a recording can be browsed while it is still being written
+	HANDLE handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(handle, &file_size))
+	{
+		CloseHandle(handle);
+		return false;
+	}
+	file = handle;
+	size = (unsigned long long)file_size.QuadPart;
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	granularity = info.dwAllocationGranularity;
+	// An empty file cannot be mapped (and has nothing to view)
+	if (size > 0)
+	{
+		mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL)
+		{
+			Close();
+			return false;
+		}
+	}
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	file = (void*)(intptr_t)(fd + 1);
+	size = (unsigned long long)st.st_size;
+	granularity = (unsigned int)sysconf(_SC_PAGESIZE);
+#endif
+	return true;
+}
+
+void MappedFile::Close()
+{
+	Unmap();
+#ifdef _WIN32
+	if (mapping) CloseHandle((HANDLE)mapping);
+	if (file) CloseHandle((HANDLE)file);
+#else
+	if (file) close((int)(intptr_t)file - 1);
+#endif
+	mapping = NULL;
+	file = NULL;
+	size = 0;
+}
+
+bool MappedFile::IsOpen() const
+{
+	return file != NULL;
+}
+
+unsigned long long MappedFile::Size() const
+{
+	return size;
+}
+
+const char* MappedFile::View(unsigned long long offset, size_t bytes)
+{
+	if (file == NULL || offset + bytes > size || bytes > MAP_WINDOW_BYTES / 2) return NULL;
+	if (view == NULL || offset < view_offset || offset + bytes > view_offset + view_size)
+	{
+		if (!MapWindow(offset, bytes)) return NULL;
+	}
+	return view + (offset - view_offset);
+}
+
+bool MappedFile::MapWindow(unsigned long long offset, size_t bytes)
+{
+	Unmap();
+	// Views start on an allocation granularity boundary; the window extends past the request for the reads that follow
+	unsigned long long start = offset - offset % granularity;
+	size_t length = (size_t)std::min<unsigned long long>(MAP_WINDOW_BYTES, size - start);
+#ifdef _WIN32
+	view = (char*)MapViewOfFile((HANDLE)mapping, FILE_MAP_READ, (DWORD)(start >> 32), (DWORD)(start & 0xFFFFFFFF), length);
+#else
+	void* address = mmap(NULL, length, PROT_READ, MAP_SHARED, (int)(intptr_t)file - 1, (off_t)start);
+	view = address == MAP_FAILED ? NULL : (char*)address;
+#endif
+	if (view == NULL) return false;
+	view_offset = start;
+	view_size = length;
+	return offset + bytes <= view_offset + view_size;
+}
+
+void MappedFile::Unmap()
+{
+	if (view == NULL) return;
+#ifdef _WIN32
+	UnmapViewOfFile(view);
+#else
+	munmap(view, view_size);
+#endif
+	view = NULL;
+	view_offset = 0;
+	view_size = 0;
+}
+
+NeuroseekerDataLinkMapped::NeuroseekerDataLinkMapped(const std::string& playbackfilename)
+	: missing(0), missing_packets(0), segment(0), readahead_window(0), position(0)
+{
+	OpenSegments(std::vector<std::string>(1, playbackfilename), std::vector<unsigned long long>());
+}
+
+NeuroseekerDataLinkMapped::NeuroseekerDataLinkMapped(const std::vector<std::string>& segment_files, const std::vector<unsigned long long>& first_packets)
+	: missing(0), missing_packets(0), segment(0), readahead_window(0), position(0)
+{
+	OpenSegments(segment_files, first_packets);
+}
+
+NeuroseekerDataLinkMapped::~NeuroseekerDataLinkMapped()
+{
+}
+
+void NeuroseekerDataLinkMapped::OpenSegments(const std::vector<std::string>& segment_files, const std::vector<unsigned long long>& listed_packets)
+{
+	// Only the segment being read stays open, the others are opened here for their size. A segment never starts
+	// before the end of the previous one, whatever its listing says.
+	unsigned long long end = 0;
+	for (size_t i = 0; i < segment_files.size(); i++)
+	{
+		MappedFile probe;
+		if (!probe.Open(segment_files[i]) || probe.Size() < PACKET_CHAIN_BYTES)
+		{
+			missing++;
+			continue;
+		}
+		unsigned long long first = i < listed_packets.size() ? std::max(listed_packets[i], end) : end;
+		missing_packets += first - end;
+		files.push_back(segment_files[i]);
+		first_packets.push_back(first);
+		end = first + probe.Size() / PACKET_CHAIN_BYTES;
+		end_packets.push_back(end);
+	}
+	first_packets.push_back(end);
+	if (!files.empty())
+	{
+		file.Open(files[0]);
+		position = first_packets[0] * PACKET_CHAIN_BYTES;
+	}
+}
+
+unsigned long long NeuroseekerDataLinkMapped::SelectSegment()
+{
+	unsigned long long packet = position / PACKET_CHAIN_BYTES;
+	if (files.empty() || packet >= first_packets.back()) return 0;
+	size_t s = std::upper_bound(first_packets.begin(), first_packets.end() - 1, packet) - first_packets.begin();
+	// Before the first segment or in a hole (never past the last segment, which ends the recording)
+	if (s == 0 || packet >= end_packets[s - 1])
+		position = first_packets[s] * PACKET_CHAIN_BYTES;
+	else
+		s--;
+	if (s != segment || !file.IsOpen())
+	{
+		if (!file.Open(files[s])) return 0;
+		segment = s;
+		// The readahead follows the read position into the new segment
+		if (readahead_window > 0)
+		{
+			readahead.Stop();
+			readahead.Start(files[s], readahead_window);
+		}
+	}
+	return end_packets[s] * PACKET_CHAIN_BYTES - position;
+}
+
+bool NeuroseekerDataLinkMapped::readn(char* buffer, size_t size)
+{
+	if (position + size > Packets() * PACKET_CHAIN_BYTES) return false;
+	// Copy through the window in pieces it can hold, and that do not cross a segment end
+	while (size > 0)
+	{
+		unsigned long long left = SelectSegment();
+		if (left == 0) return false;
+		unsigned long long offset = position - first_packets[segment] * PACKET_CHAIN_BYTES;
+		size_t n = (size_t)std::min<unsigned long long>(std::min<unsigned long long>(size, left), MAP_WINDOW_BYTES / 2);
+		readahead.Advance(offset, n);
+		const char* src = file.View(offset, n);
+		if (src == NULL) return false;
+		memcpy(buffer, src, n);
+		buffer += n;
+		size -= n;
+		position += n;
+	}
+	return true;
+}
+
+bool NeuroseekerDataLinkMapped::IsOpen() const
+{
+	return !files.empty();
+}
+
+int NeuroseekerDataLinkMapped::Segments() const
+{
+	return (int)files.size();
+}
+
+int NeuroseekerDataLinkMapped::MissingSegments() const
+{
+	return missing;
+}
+
+unsigned long long NeuroseekerDataLinkMapped::MissingPackets() const
+{
+	return missing_packets;
+}
+
+unsigned long long NeuroseekerDataLinkMapped::Packets() const
+{
+	return first_packets.back();
+}
+
+unsigned long long NeuroseekerDataLinkMapped::Position() const
+{
+	unsigned long long packet = position / PACKET_CHAIN_BYTES;
+	if (files.empty() || packet >= first_packets.back()) return packet;
+	// In a hole the next read is the first packet of the next segment
+	size_t s = std::upper_bound(first_packets.begin(), first_packets.end() - 1, packet) - first_packets.begin();
+	return s == 0 || packet >= end_packets[s - 1] ? first_packets[s] : packet;
+}
+
+bool NeuroseekerDataLinkMapped::Seek(unsigned long long packet)
+{
+	if (packet > Packets()) return false;
+	position = packet * PACKET_CHAIN_BYTES;
+	if (SelectSegment() > 0) readahead.Advance(position - first_packets[segment] * PACKET_CHAIN_BYTES, 0);
+	return true;
+}
+
+const char* NeuroseekerDataLinkMapped::NextChain()
+{
+	if (SelectSegment() == 0) return NULL;
+	unsigned long long offset = position - first_packets[segment] * PACKET_CHAIN_BYTES;
+	readahead.Advance(offset, PACKET_CHAIN_BYTES);
+	const char* chain = file.View(offset, PACKET_CHAIN_BYTES);
+	if (chain) position += PACKET_CHAIN_BYTES;
+	return chain;
+}
+
+bool NeuroseekerDataLinkMapped::SetReadahead(unsigned long long window)
+{
+	readahead.Stop();
+	readahead_window = window;
+	if (window == 0 || !file.IsOpen()) return true;
+	if (!readahead.Start(files[segment], window)) return false;
+	readahead.Advance(position - first_packets[segment] * PACKET_CHAIN_BYTES, 0);
+	return true;
+}
+
+NskReadahead NeuroseekerDataLinkMapped::ReadaheadTelemetry() const
+{
+	return readahead.Telemetry();
+}
+
+void NeuroseekerDataLinkMapped::SetStride(unsigned int stride)
+{
+	readahead.SetStride((unsigned long long)stride * PACKET_CHAIN_BYTES, PACKET_CHAIN_BYTES);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "NeuroseekerDataLinkIntf.h"
+#include "PacketDecoder.h"
+#include "FileReadahead.h"
+
+// Size of the mapped view of a recording (a 32-bit process cannot map a multi-GB file at once)
+const unsigned int MAP_WINDOW_BYTES = 64 << 20;
+
+// Read-only memory mapping of a recording, viewed through a window that slides to the requested range
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const std::string& filename);
+	void Close();
+
+	bool IsOpen() const;
+	unsigned long long Size() const;
+
+	// Pointer to bytes [offset, offset + size) of the file (size up to MAP_WINDOW_BYTES / 2), valid until the
+	// next View call; NULL past the end of the file
+	const char* View(unsigned long long offset, size_t size);
+
+private:
+	bool MapWindow(unsigned long long offset, size_t size);
+	void Unmap();
+
+	void* file;          // file handle (Win32) or descriptor (POSIX)
+	void* mapping;       // file mapping handle (Win32)
+	char* view;
+	unsigned long long view_offset;
+	size_t view_size;
+	unsigned long long size;
+	unsigned int granularity;
+};
+
+// Playback data link on a mapped .nsk recording: packets are fixed-size chains, so any sample can be
+// reached by moving the read position, and chains can be decoded in place. The recording can be a list of
+// segment files, each starting at its listed first packet (a trailing partial chain of a segment is skipped).
+class NeuroseekerDataLinkMapped : public NeuroseekerDataLinkIntf
+{
+public:
+	NeuroseekerDataLinkMapped(const std::string& playbackfilename);
+	// Segment i starts at packet first_packets[i], or right after the previous segment if none is listed; a hole left
+	// by a missing or short segment is skipped by reads and seeks, without moving the segments after it
+	NeuroseekerDataLinkMapped(const std::vector<std::string>& segment_files, const std::vector<unsigned long long>& first_packets);
+	~NeuroseekerDataLinkMapped();
+
+	bool readn(char* buffer, size_t size);
+
+	// True if at least one segment could be opened
+	bool IsOpen() const;
+	// Segments played back, and segments left out (unreadable or empty)
+	int Segments() const;
+	int MissingSegments() const;
+	// Packets in the holes between the segments played back
+	unsigned long long MissingPackets() const;
+	// Number of complete packets in the recording (up to the end of the last segment)
+	unsigned long long Packets() const;
+	// Packet (sample) index of the next read
+	unsigned long long Position() const;
+	// Move the read position to a packet, returns false (and keeps the position) past the end
+	bool Seek(unsigned long long packet);
+
+	// Chain of the next packet, read in place (NULL at the end of the recording)
+	const char* NextChain();
+
+	// Keep window bytes ahead of the read position in the page cache (0: off)
+	bool SetReadahead(unsigned long long window);
+	NskReadahead ReadaheadTelemetry() const;
+	// Reads take one packet every stride packets (1: contiguous), the readahead only prefetches those
+	void SetStride(unsigned int stride);
+
+private:
+	void OpenSegments(const std::vector<std::string>& segment_files, const std::vector<unsigned long long>& listed_packets);
+	// Map the segment holding the read position (moved on to the next segment from a hole), returns the bytes left in
+	// that segment (0 past the end)
+	unsigned long long SelectSegment();
+
+	std::vector<std::string> files;
+	std::vector<unsigned long long> first_packets;  // first packet of each segment, then the total
+	std::vector<unsigned long long> end_packets;    // packet after the last one of each segment
+	int missing;
+	unsigned long long missing_packets;
+	MappedFile file;                                // segment being read
+	size_t segment;
+	FileReadahead readahead;
+	unsigned long long readahead_window;
+	unsigned long long position;                    // byte offset of the next read, over all segments
+};
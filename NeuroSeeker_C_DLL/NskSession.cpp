@@ -0,0 +1,52 @@
+// NskSession.cpp : Per-probe (or per-file) state behind an Nsk C DLL session handle
+
+#include "NskSession.h"
+
+NskSession::NskSession()
+	: data_link(NULL),
+	mapped_file(NULL),
+	readahead_window((unsigned long long)DEFAULT_READAHEAD_MB << 20),
+	read_stride(1),
+	recording_file(NULL),
+	pyramid(NULL),
+	ring(NULL),
+	block_pool(NULL),
+	recorder(NULL),
+	n_channels(NUMBER_OF_CHANNELS),
+	stream_recording(false),
+	recording_format(RECORDING_RAW),
+	write_behind(DefaultWriteBehindOptions()),
+	segmentation(DefaultSegmentOptions()),
+	build_pyramid(false),
+	testing(false),
+	ring_capacity(DEFAULT_RING_CAPACITY),
+	output_layout(LAYOUT_CHANNEL_MAJOR),
+	all_channels(NUMBER_OF_CHANNELS),
+	active_channels(NUMBER_OF_CHANNELS),
+	compact_channels(false),
+	channel_scale(NUMBER_OF_CHANNELS, SCALE_FACTOR_TO_VOLTAGE),
+	packet_scratch(PACKET_BLOCK_SIZE),
+	decoder(NULL),
+	chain_scratch(PACKET_CHAIN_BYTES)
+{
+}
+
+NskSession::~NskSession()
+{
+	// Threads first, they still reference the ring and the API
+	acquisition.Stop();
+	fifo_monitor.Stop();
+	if (pyramid_builder.joinable()) pyramid_builder.join();
+	delete ring;
+	delete block_pool;
+	delete recorder;
+	delete data_link;
+	delete recording_file;
+	delete pyramid;
+	delete decoder;
+}
+
+const ChannelMap &NskSession::OutputChannels() const
+{
+	return compact_channels ? active_channels : all_channels;
+}
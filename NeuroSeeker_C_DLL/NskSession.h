@@ -0,0 +1,96 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "NeuroseekerAPI.h"
+#include "ElectrodePacket.h"
+#include "NeuroseekerDataLinkIntf.h"
+#include "PacketBlock.h"
+#include "PacketCopier.h"
+#include "PacketRing.h"
+#include "AcquisitionThread.h"
+#include "BlockPool.h"
+#include "ChannelMap.h"
+#include "PacketStats.h"
+#include "ClockModel.h"
+#include "SyncEdges.h"
+#include "FifoMonitor.h"
+#include "BlockSizer.h"
+#include "PacketDecoder.h"
+#include "MappedFile.h"
+#include "RecordingFile.h"
+#include "RecordingAPI.h"
+#include "SegmentedRecording.h"
+#include "RecordingPyramid.h"
+#include "PlaybackPacer.h"
+
+// All state of one probe or playback file. Every exported function works on the session handle it is
+// given, so several sessions can be acquired in parallel (one thread per session).
+struct NskSession
+{
+	NskSession();
+	~NskSession();
+
+	// Channels written by the read functions
+	const ChannelMap &OutputChannels() const;
+
+	// Probe (or file playback) access
+	NeuroseekerRecordingAPI api;
+	ElectrodePacket ep;
+	PacketCopier packet_copier;              // vendor packet to record copies of ep
+	NeuroseekerDataLinkIntf *data_link;
+	NeuroseekerDataLinkMapped *mapped_file;  // data_link when the playback file is memory-mapped (seekable), else NULL
+	unsigned long long readahead_window;     // playback readahead (bytes, 0: off)
+	int read_stride;                         // packets per sample of the last file read (1: every packet)
+	RecordingReader *recording_file;         // playback file in one of the DLL's own formats (data_link is NULL then)
+	std::string playback_file;               // name of the open playback file (or manifest)
+	PyramidReader *pyramid;                  // overview pyramid of the playback file, opened on first query
+	PlaybackPacer pacer;                     // real-time (or scaled) release of file reads
+
+	// Live acquisition
+	PacketRing *ring;
+	AcquisitionThread acquisition;
+	FifoMonitor fifo_monitor;
+	BlockSizer block_sizer;
+	BlockPool *block_pool;
+	RecordingWriter *recorder;               // stream recording in one of the DLL's own formats (NULL: vendor API)
+	std::string recorded_file;               // stream recording (or manifest) of the last NSK_Start
+	std::thread pyramid_builder;             // overview pyramid of the last stream recording, built after NSK_Close
+
+	// Stream accounting
+	PacketStats packet_stats;
+	ClockModel clock_model;
+	SyncEdgeDetector sync_edges;
+
+	// Settings
+	unsigned int n_channels;
+	bool stream_recording;
+	int recording_format;
+	NskWriteBehindOptions write_behind;
+	NskSegmentOptions segmentation;
+	bool build_pyramid;
+	bool testing;
+	int ring_capacity;
+	SampleLayout output_layout;
+
+	// Serializes config link access between the FIFO monitor and the exported functions
+	std::mutex config_mutex;
+
+	// Output channel selection (all channels, or only live recording channels when compacting)
+	ChannelMap all_channels;
+	ChannelMap active_channels;
+	bool compact_channels;
+
+	// Per-channel scale from ADC code to volts (input referred once channel gains are configured)
+	std::vector<float> channel_scale;
+
+	// Packet-major scratch block for file reads
+	std::vector<PacketRecord> packet_scratch;
+
+	// Native chain decoder for data link reads (NULL: vendor decoder)
+	PacketDecoder *decoder;
+	std::vector<char> chain_scratch;
+};
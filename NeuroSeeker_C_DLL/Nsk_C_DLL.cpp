@@ -4,6 +4,10 @@
 #include <fstream>
 #include <iostream>
 #include <iomanip>  
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <thread>
 
 #include "NeuroseekerAPI.h"
 #include "ElectrodePacket.h"
@@ -11,25 +15,245 @@
 #include "GeneralConfiguration.h"
 #include "NeuroseekerDataLinkFile.h"
 #include "CSVParser.h"
+#include "PacketBlock.h"
+#include "PacketRing.h"
+#include "AcquisitionThread.h"
+#include "BlockPool.h"
+#include "ChannelMap.h"
+#include "PacketStats.h"
+#include "ClockModel.h"
+#include "SyncEdges.h"
+#include "FifoMonitor.h"
+#include "BlockSizer.h"
+#include "PacketDecoder.h"
+#include "PacketLayoutProbe.h"
+#include "MappedFile.h"
+#include "FileExport.h"
+#include "IntegrityScan.h"
+#include "RecordingFile.h"
+#include "SegmentedRecording.h"
+#include "RecordingPyramid.h"
+#include "PlaybackPacer.h"
+#include "NskSession.h"
 
-// Global Classes
-NeuroseekerAPI api;
-ElectrodePacket ep;
-NeuroseekerDataLinkIntf *DataLink;
-
-// Global variables
-unsigned int n_channels = 1440;
-bool stream_recording;
-bool testing;
+// Channel gain settings (CSV gain index) to amplifier gain
+const float channel_gains[8] = { 50.0f, 125.0f, 250.0f, 500.0f, 1000.0f, 1500.0f, 2000.0f, 2500.0f };
 
 // Namespace decalartion
 using namespace std;
 
+// Write n packet records into the buffer (in the selected layout) and sync buffer, starting at sample offset; channel-major
+// rows are row_step samples apart
+template<typename T>
+void EmitRecords(NskSession *session, const PacketRecord *records, int n, T *buffer, unsigned short *sync_buffer, int offset, int row_step)
+{
+	// Copy each contiguous run of output channels with the layout's native kernel
+	const ChannelMap &channels = session->OutputChannels();
+	const std::vector<ChannelRun> &runs = channels.Runs();
+	int n_out = channels.Count();
+	for (size_t r = 0; r < runs.size(); r++)
+	{
+		const float *src = records[0].channelData + runs[r].source;
+		if (session->output_layout == LAYOUT_SAMPLE_MAJOR)
+			CopyBlockRows(src, PACKET_RECORD_STRIDE, n, runs[r].count, buffer + (offset * n_out) + runs[r].target, n_out);
+		else
+			TransposeBlock(src, PACKET_RECORD_STRIDE, n, runs[r].count, buffer + (runs[r].target * row_step) + offset, row_step);
+	}
+	if (sync_buffer)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			sync_buffer[offset + i] = records[i].synchronization;
+		}
+	}
+	session->packet_stats.Track(records, n, offset);
+	session->sync_edges.Track(records, n, offset);
+	session->clock_model.Update(records, n);
+}
+
+// Read and decode the next packet of a data link, with the native decoder when one is set (host_time is left to the caller)
+ReadErrorCode ReadPacket(NskSession *session, NeuroseekerDataLinkIntf *link, PacketRecord *record)
+{
+	// Playback files in the DLL's own formats decode without a data link
+	if (link == NULL && session->recording_file != NULL)
+		return session->recording_file->ReadNext(record) ? READ_SUCCESS : READ_LINK_ERROR;
+	// A NULL link is the live probe to readElectrodeData, never read it in place of a file
+	if (link == NULL) return READ_LINK_ERROR;
+	if (session->decoder == NULL)
+	{
+		ReadErrorCode rec = session->api.readElectrodeData(session->ep, link);
+		if (rec == READ_SUCCESS) session->packet_copier.Copy(session->ep, record);
+		return rec;
+	}
+	// Decode mapped chains in place
+	if (link != NULL && link == session->mapped_file)
+	{
+		const char *chain = session->mapped_file->NextChain();
+		return chain ? session->decoder->Decode(chain, record) : READ_LINK_ERROR;
+	}
+	if (link == NULL || !link->readn(&session->chain_scratch[0], PACKET_CHAIN_BYTES)) return READ_LINK_ERROR;
+	return session->decoder->Decode(&session->chain_scratch[0], record);
+}
+
+// Move a data link past count packets without decoding them: seek on playback files, the vendor skipData on stream links
+// (stops at the end of a file)
+ReadErrorCode SkipPackets(NskSession *session, NeuroseekerDataLinkIntf *link, unsigned long long count)
+{
+	if (count == 0) return READ_SUCCESS;
+	if (link == NULL && session->recording_file != NULL)
+	{
+		RecordingReader *file = session->recording_file;
+		return file->Seek(std::min(file->Position() + count, file->Samples())) ? READ_SUCCESS : READ_LINK_ERROR;
+	}
+	if (link != NULL && link == session->mapped_file)
+	{
+		NeuroseekerDataLinkMapped *file = session->mapped_file;
+		return file->Seek(std::min(file->Position() + count, file->Packets())) ? READ_SUCCESS : READ_LINK_ERROR;
+	}
+	if (link == NULL) return READ_LINK_ERROR;
+	while (count > 0)
+	{
+		unsigned int n = (unsigned int)std::min<unsigned long long>(count, 0x7FFFFFFF);
+		ReadErrorCode rec = session->api.skipData(n, link);
+		if (rec != READ_SUCCESS) return rec;
+		count -= n;
+	}
+	return READ_SUCCESS;
+}
+
+// Read up to buffer_size packets in blocks: decode into packet-major scratch, then transpose into channel-major buffer.
+// With a stride, every stride-th packet is decoded and the packets in between are skipped.
+template<typename T>
+int ReadPacketBlocks(NskSession *session, NeuroseekerDataLinkIntf *link, T *buffer, unsigned short *sync_buffer, int buffer_size, ReadErrorCode &rec, unsigned int &pos, int stride = 1)
+{
+	rec = READ_SUCCESS;
+	int n_read = 0;
+	int consecutive_errors = 0;
+	stride = std::max(stride, 1);
+	if (stride != session->read_stride)
+	{
+		// Consecutive samples of the previous read were a different number of packets apart
+		session->packet_stats.Resync();
+		session->sync_edges.Reset();
+		session->read_stride = stride;
+	}
+	if (link != NULL && link == session->mapped_file) session->mapped_file->SetStride(stride);
+	unsigned int counter_step = session->packet_stats.CounterStep();
+	session->packet_stats.SetCounterStep(counter_step * stride);
+	session->packet_stats.BeginBlock();
+	session->sync_edges.BeginBlock();
+	session->clock_model.BeginBlock();
+	while (n_read < buffer_size)
+	{
+		int n_block = std::min(PACKET_BLOCK_SIZE, buffer_size - n_read);
+		int i = 0;
+		while (i < n_block)
+		{
+			// Read next packet (sample) from FIFO, skipping (and counting) corrupted packets
+			rec = ReadPacket(session, link, &session->packet_scratch[i]);
+			if (stride > 1 && (rec == READ_SUCCESS || rec == DATA_ERROR)) SkipPackets(session, link, stride - 1);
+			if (rec == DATA_ERROR && ++consecutive_errors < MAX_CONSECUTIVE_DATA_ERRORS)
+			{
+				session->packet_stats.RecordDataError();
+				continue;
+			}
+			if (rec != READ_SUCCESS) break;
+			consecutive_errors = 0;
+			session->packet_scratch[i++].host_time = HostTimeNs();
+		}
+		if (i == 0) break;
+		pos = session->packet_scratch[i - 1].counters[0];
+		EmitRecords(session, &session->packet_scratch[0], i, buffer, sync_buffer, n_read, buffer_size);
+		n_read += i;
+		if (rec != READ_SUCCESS) break;
+	}
+	session->clock_model.EndBlock();
+	session->packet_stats.SetCounterStep(counter_step);
+	return n_read;
+}
+
+// Copy up to buffer_size packets out of the acquisition ring, waiting for the reader thread as needed (channel-major rows
+// are row_step samples apart, at least buffer_size)
+template<typename T>
+int ReadRingBlocks(NskSession *session, T *buffer, unsigned short *sync_buffer, int buffer_size, int row_step)
+{
+	int n_read = 0;
+	session->packet_stats.BeginBlock();
+	session->sync_edges.BeginBlock();
+	session->clock_model.BeginBlock();
+	while (n_read < buffer_size)
+	{
+		const PacketRecord *records;
+		int n = session->ring->Peek(&records);
+		if (n == 0)
+		{
+			// Stop once the reader thread has ended and the ring is drained
+			if (!session->acquisition.IsRunning() && session->ring->Available() == 0) break;
+			session->ring->WaitForData(10);
+			continue;
+		}
+		n = std::min(n, buffer_size - n_read);
+		EmitRecords(session, records, n, buffer, sync_buffer, n_read, row_step);
+		session->ring->Consume(n);
+		n_read += n;
+	}
+	session->clock_model.EndBlock();
+	return n_read;
+}
+
+// Block size for the next live read under adaptive sizing (0 when adaptive sizing is off)
+int NextBlockSize(NskSession *session)
+{
+	float ring_filling = session->ring ? 100.0f * session->ring->Available() / session->ring->Capacity() : 0.0f;
+	return session->block_sizer.Next(session->fifo_monitor.Filling(), session->fifo_monitor.PeakFilling(), ring_filling);
+}
+
+// Free the session's block pool, unless blocks are still leased to the consumer (their buffers must stay valid until
+// NSK_ReleaseBlock): then the pool is kept, and freed by a later call or with the session
+bool FreeBlockPool(NskSession *session)
+{
+	if (session->block_pool && session->block_pool->Leased() > 0) return false;
+	delete session->block_pool;
+	session->block_pool = NULL;
+	return true;
+}
+
+// Describe a freshly filled pool block to the consumer (or hand it back to the pool if nothing was read)
+int LeaseBlock(NskSession *session, int index, int n_read, bool has_sync, NskBlock *block)
+{
+	if (n_read == 0)
+	{
+		session->block_pool->Cancel(index);
+		return 0;
+	}
+	block->sequence = session->block_pool->Sequence(index);
+	block->data = session->block_pool->Data(index);
+	block->sync = has_sync ? session->block_pool->Sync(index) : NULL;
+	block->samples = n_read;
+	block->channels = session->OutputChannels().Count();
+	block->step = session->output_layout == LAYOUT_SAMPLE_MAJOR ? block->channels : session->block_pool->BlockSize();
+	block->raw = session->block_pool->IsRaw() ? 1 : 0;
+	block->layout = session->output_layout;
+	return n_read;
+}
+
 // "C" style used for function declarations
 extern "C"
 {
+	// Create a session (one probe or playback file), pass it to every other call
+	__declspec(dllexport) NskSession *NSK_CreateSession()
+	{
+		return new NskSession();
+	}
+
+	// Destroy a session (stops its threads and frees its buffers, close the probe or file first)
+	__declspec(dllexport) void NSK_DestroySession(NskSession *session)
+	{
+		delete session;
+	}
+
 	// Open NeuroSeeker Probe
-	__declspec(dllexport) void NSK_Open(bool LEDs)
+	__declspec(dllexport) void NSK_Open(NskSession *session, bool LEDs)
 	{
 		// Error Code containers
 		VersionNumber vn;
@@ -39,12 +263,12 @@ extern "C"
 		// Check Nsk API version
 		std::cout << "Opening NeuroSeeker Probe: ";
 		std::cout << "(Nsk API Version Number - ";
-		vn = api.getAPIVersion();
+		vn = session->api.getAPIVersion();
 		std::cout << vn.major << "." << vn.minor << ")\n";
 
 		// Open connection to Nsk Probe
 		std::cout << "Attempting to connect with Nsk Probe: ";
-		oec = api.open();
+		oec = session->api.open();
 		if (oec == 0)
 		{
 			std::cout << "- Nsk conneciton successful: EC " << oec << "\n";
@@ -54,10 +278,10 @@ extern "C"
 		}
 
 		// Start Log
-		api.startLog();
+		session->api.startLog();
 
 		// Initialize Nsk Probe to default values
-		oec = api.init();
+		oec = session->api.init();
 		std::cout << "Initializing Nsk Probe: " << oec << "\n";
 
 		// Enable or Disbale headstage LEDs
@@ -68,12 +292,12 @@ extern "C"
 		else {
 			std::cout << "Disabling headtsage LEDs: ";
 		}
-		dec = api.ledOff(!LEDs);
+		dec = session->api.ledOff(!LEDs);
 		std::cout << dec << "\n\n";
 	}
 
 	// Configure NeuroSeeker Probe
-	__declspec(dllexport) void NSK_SetBiasVoltage(float biasVoltage)
+	__declspec(dllexport) void NSK_SetBiasVoltage(NskSession *session, float biasVoltage)
 	{
 		// Error Corde containers
 		DacControlErrorCode dcec;
@@ -82,7 +306,14 @@ extern "C"
 		if (biasVoltage < 0.0f) { biasVoltage = 0.0f; }
 		if (biasVoltage > 2.5f) { biasVoltage = 2.5f; }
 		std::cout << "Setting Bias voltage: ";
-		dcec = api.generateDC(DAC_C, biasVoltage);
+		if (session->acquisition.QueueBias(biasVoltage))
+		{
+			// Set by the acquisition thread between two packet reads
+			std::cout << biasVoltage << "V queued\n";
+			return;
+		}
+		std::lock_guard<std::mutex> lock(session->config_mutex);
+		dcec = session->api.generateDC(DAC_C, biasVoltage);
 		std::cout << biasVoltage << "V " << dcec << "\n";
 	}
 
@@ -97,8 +328,19 @@ extern "C"
 			return true;
 	}
 
+	// Helper function to build the live channel table (enabled regions, without reference channels)
+	void BuildActiveChannelMap(NskSession *session, int *activeRegions)
+	{
+		std::vector<bool> live(session->n_channels);
+		for (int c = 0; c < (int)session->n_channels; c++)
+		{
+			live[c] = activeRegions[c / CHANNELS_PER_REGION] && !IsReferenceChannel(c);
+		}
+		session->active_channels.Build(live);
+	}
+
 	// Configure NeuroSeeker Probe
-	__declspec(dllexport) void NSK_Configure(int* activeRegions, bool testMode, float biasVoltage, char *OffsetCSV, char *SlopeCSV, char *CompCSV, char * ChannelsCSV)
+	__declspec(dllexport) void NSK_Configure(NskSession *session, int* activeRegions, bool testMode, float biasVoltage, char *OffsetCSV, char *SlopeCSV, char *CompCSV, char * ChannelsCSV)
 	{
 		// Error Corde containers
 		ReadCsvErrorCode rcec;
@@ -118,37 +360,41 @@ extern "C"
 
 		// Loading calibration parameters from CSVs
 		std::cout << "Reading OFFSET calibration CSV file: ";
-		rcec = api.readADCOffsetCalibrationFromCsv(off_str);
+		rcec = session->api.readADCOffsetCalibrationFromCsv(off_str);
 		std::cout << rcec << "\n";
 		std::cout << "Reading SLOPE calibration CSV file: ";
-		rcec = api.readADCSlopeCalibrationFromCsv(slope_str);
+		rcec = session->api.readADCSlopeCalibrationFromCsv(slope_str);
 		std::cout << rcec << "\n";
 		std::cout << "Reading COMPARATOR calibration CSV file: ";
-		rcec = api.readComparatorCalibrationFromCsv(comp_str);
+		rcec = session->api.readComparatorCalibrationFromCsv(comp_str);
 		std::cout << rcec << "\n";
 
 		// Write Calibration paramters to general register
 		std::cout << "Writing calibration parameters: ";
-		srac = api.writeChannelRegisters(true);
+		srac = session->api.writeChannelRegisters(true);
 		std::cout << srac << "\n\n";
 
 		// Activate probe regions 1-12
 		for (unsigned int i = 0; i < 12; i++)
 		{
 			std::cout << "Activating probe region: " << i;
-			gec = api.generalConfiguration.setBiasPixEnBit(i, activeRegions[i]);
+			gec = session->api.generalConfiguration.setBiasPixEnBit(i, activeRegions[i]);
 			std::string active = "False\n";
 			if (activeRegions[i])
 				active = "True\n";
 			std::cout << " " << gec << " " << active;
 		}
 		std::cout << "Activating probe region: " << 12; // Activate 13th region (as is required)
-		gec = api.generalConfiguration.setBiasPixEnBit(12, true);
+		gec = session->api.generalConfiguration.setBiasPixEnBit(12, true);
 		std::cout << " " << gec << " True\n";
 
+		// Gather table for compacted reads (live recording channels only)
+		BuildActiveChannelMap(session, activeRegions);
+		std::cout << "Live recording channels: " << session->active_channels.Count() << "\n";
+
 		// Write settings to register
 		std::cout << "Writing activation settings: ";
-		srac = api.writeGeneralRegister(true);
+		srac = session->api.writeGeneralRegister(true);
 		std::cout << srac << "\n";
 
 		// Generate a Bias voltage for Probe
@@ -156,7 +402,7 @@ extern "C"
 		// Check that bias Voltage is in range
 		if (biasVoltage < 0.0f) { biasVoltage = 0.0f; }
 		if (biasVoltage > 2.5f) { biasVoltage = 2.5f; }
-		dcec = api.generateDC(DAC_C, biasVoltage);
+		dcec = session->api.generateDC(DAC_C, biasVoltage);
 		std::cout << biasVoltage << "V " << dcec << "\n";
 
 		// Set Gain and Mode for every channel
@@ -164,15 +410,15 @@ extern "C"
 
 		std::cout << "Setting channel parameters (Gain, Mode, Ref): ";
 		int c = 0;
-		for (c = 0; c < n_channels; c++)
+		for (c = 0; c < session->n_channels; c++)
 		{
-			ccec = api.allChannelConfigurations.setRefSel(c, RefSel(CsvParser.ChannelConfigReference[c]));
+			ccec = session->api.allChannelConfigurations.setRefSel(c, RefSel(CsvParser.ChannelConfigReference[c]));
 			if (ccec) { break; }
-			ccec = api.allChannelConfigurations.setGain(c, CsvParser.ChannelConfigGain[c]);
+			ccec = session->api.allChannelConfigurations.setGain(c, CsvParser.ChannelConfigGain[c]);
 			if (ccec) { break; }
-			ccec = api.allChannelConfigurations.setMode(c, CsvParser.ChannelConfigMode[c]);
+			ccec = session->api.allChannelConfigurations.setMode(c, CsvParser.ChannelConfigMode[c]);
 			if (ccec) { break; }
-			ccec = api.allChannelConfigurations.setBw(c, CsvParser.ChannelConfigBW[c]);
+			ccec = session->api.allChannelConfigurations.setBw(c, CsvParser.ChannelConfigBW[c]);
 			if (ccec) { break; }
 		}
 		// Check/Report for exception (channel config error)
@@ -184,10 +430,16 @@ extern "C"
 			std::cout << "channel config success.\n";
 		}
 
+		// Per-channel volts per ADC code (for consumers of raw ADC codes)
+		for (c = 0; c < (int)session->n_channels && c < (int)CsvParser.ChannelConfigGain.size(); c++)
+		{
+			session->channel_scale[c] = SCALE_FACTOR_TO_VOLTAGE / channel_gains[CsvParser.ChannelConfigGain[c] & 7];
+		}
+
 
 		// Write settings to channel register
 		std::cout << "Writing to channel settings: ";
-		srac = api.writeChannelRegisters(true);
+		srac = session->api.writeChannelRegisters(true);
 		std::cout << srac << "\n\n";
 
 		// Enable Test Mode?
@@ -195,25 +447,25 @@ extern "C"
 		{
 			// Send a sinewave from Headstage DAC
 			std::cout << "Enable Testing: ";
-			gec = api.generalConfiguration.setTestInputEnBit(true);
+			gec = session->api.generalConfiguration.setTestInputEnBit(true);
 			std::cout << gec << "\n";
 
 			// Write settings to general register
 			std::cout << "Writing to general register: ";
-			srac = api.writeGeneralRegister(true);
+			srac = session->api.writeGeneralRegister(true);
 			std::cout << srac << "\n";
 
 			// Start genertating a sinewave on DAC_A
-			dcec = api.generateSine(DAC_A, 5, 0.0f, 5);
+			dcec = session->api.generateSine(DAC_A, 5, 0.0f, 5);
 			std::cout << "Gernating Sinewave Test Signal (1660 Hz): ";
 			std::cout << dcec << "\n\n";
-			testing = true;
+			session->testing = true;
 		}
 
 	}
 
 	// Start NeuroSeeker Probe
-	__declspec(dllexport) void NSK_Start(bool stream, char* _stream_file)
+	__declspec(dllexport) void NSK_Start(NskSession *session, bool stream, char* _stream_file)
 	{
 		// Error Code containers
 		DigitalControlErrorCode dec;
@@ -224,88 +476,432 @@ extern "C"
 
 		// Reset probe
 		std::cout << "Resetting probe: ";
-		dec = api.nrst(false);
+		dec = session->api.nrst(false);
 		std::cout << dec << "\n";
 
 		// Reset DataPath (FPGA)
 		std::cout << "Resetting Datapath (FPGA): ";
-		ec = api.resetDatapath();
+		ec = session->api.resetDatapath();
 		std::cout << ec << "\n";
 
 		// Start probe
 		std::cout << "Starting probe: ";
-		dec = api.nrst(true);
+		dec = session->api.nrst(true);
 		std::cout << dec << "\n";
 
 		// Stream Recording (start?)
-		stream_recording = stream;
-		if (stream_recording)
+		session->stream_recording = stream;
+		if (session->stream_recording)
 		{
 			std::string stream_file(_stream_file);
+			bool segmented = IsSegmented(session->segmentation);
+			std::string recording_file = segmented ? ManifestFileName(stream_file) : stream_file;
+			session->recorded_file = recording_file;
 			std::cout << "Starting Recording Stream: ";
-			ec = api.startRecording(stream_file);
-			std::cout << ec << "\n";
+			if (segmented && session->recording_format != RECORDING_RAW)
+				session->recorder = new SegmentedWriter(session->recording_format, session->segmentation);
+			else
+				session->recorder = CreateRecordingWriter(session->recording_format);
+			if (session->recorder && session->recording_format == RECORDING_PACKED && session->decoder && !session->decoder->IsIdentityMap())
+			{
+				// Packed records hold ADC codes, which the native layout's channel values are not
+				std::cout << "cannot pack the native decoder's channel values, not recording\n";
+				delete session->recorder;
+				session->recorder = NULL;
+			}
+			else if (session->recorder)
+			{
+				// The DLL's own formats are fed by the acquisition thread
+				bool opened = session->recorder->Open(stream_file, session->write_behind);
+				std::cout << (opened ? "recording to " : "failed to create ") << recording_file << "\n";
+				if (!opened)
+				{
+					delete session->recorder;
+					session->recorder = NULL;
+				}
+			}
+			else
+			{
+				// Raw stream, written behind the data link reads instead of inside them
+				bool opened = session->api.StartStreamRecording(stream_file, session->write_behind, session->segmentation);
+				std::cout << (opened ? "recording to " : "failed to create ") << recording_file << "\n";
+			}
+		}
+
+		// Start reader thread (drains the basestation FIFO into the acquisition ring)
+		std::cout << "Starting acquisition thread: ";
+		delete session->ring;
+		session->ring = new PacketRing(session->ring_capacity);
+		session->packet_stats.Reset();
+		session->sync_edges.Reset();
+		session->clock_model.Reset();
+		// Poll the basestation FIFO fill level for adaptive block sizing, from the reader thread between packet reads
+		if (session->block_sizer.IsEnabled())
+		{
+			session->fifo_monitor.Start(&session->api, &session->config_mutex, DEFAULT_FIFO_POLL_MS);
 		}
+		session->acquisition.Start(&session->api, &session->config_mutex, session->ring, &session->packet_stats, session->recorder,
+			session->block_sizer.IsEnabled() ? &session->fifo_monitor : NULL);
+		std::cout << session->ring->Capacity() << " packet ring\n";
 	}
 
-	// Read NeuroSeeker Raw Packets
-	__declspec(dllexport) int NSK_Read(float *buffer, int buffer_size)
+	// Adapt the live block size between min_size and max_size samples from the FIFO/ring backlog (min_size 0 disables),
+	// takes effect at the next NSK_Start
+	__declspec(dllexport) void NSK_SetAdaptiveBlockSize(NskSession *session, int min_size, int max_size)
 	{
-		// Error Code containers
-		ReadErrorCode rec;
+		session->block_sizer.SetRange(min_size, max_size);
+	}
 
-		// Fill data matrix with channel data from N packets (all_samp_ch0 -> all_samp_ch 1...all_samp_chN)
-		for (int i = 0; i < buffer_size; i++)
+	// Number of samples to request with the next live read (0 when adaptive sizing is off)
+	__declspec(dllexport) int NSK_NextBlockSize(NskSession *session)
+	{
+		return NextBlockSize(session);
+	}
+
+	// Adaptive block sizing telemetry (chosen size, FIFO and ring fill levels, grow/shrink counts)
+	__declspec(dllexport) void NSK_GetBlockSizing(NskSession *session, NskBlockSizing *sizing)
+	{
+		*sizing = session->block_sizer.Telemetry();
+	}
+
+	// Select the format of stream recordings started by the next NSK_Start (0: vendor raw .nsk, 1: compressed .nskz,
+	// 2: packed .nskp)
+	__declspec(dllexport) void NSK_SetRecordingFormat(NskSession *session, int format)
+	{
+		session->recording_format = format == RECORDING_COMPRESSED || format == RECORDING_PACKED ? format : RECORDING_RAW;
+	}
+
+	// Split stream recordings started by the next NSK_Start into segments of seconds of data or megabytes, whichever
+	// comes first (0 for both: one file). Segments are listed in a manifest <stream file stem>.nskm, which
+	// NSK_Open_File plays back as one recording.
+	__declspec(dllexport) void NSK_SetSegmentation(NskSession *session, int seconds, int megabytes)
+	{
+		session->segmentation.segment_seconds = std::max(seconds, 0);
+		session->segmentation.segment_mb = std::max(megabytes, 0);
+	}
+
+	// Stream recording telemetry (all zero when recording with the vendor API or not recording)
+	__declspec(dllexport) void NSK_GetRecordingStats(NskSession *session, NskRecordingStats *stats)
+	{
+		if (session->recorder)
+			*stats = session->recorder->Stats();
+		else
+			*stats = NskRecordingStats();
+	}
+
+	// Stream recording write-behind settings used by the next NSK_Start: queue of queue_buffers buffers of buffer_kb KB
+	// (0 keeps the default), unbuffered writes, flush to disk every sync_ms ms (0: only when the recording stops)
+	__declspec(dllexport) void NSK_SetWriteBehind(NskSession *session, int queue_buffers, int buffer_kb, bool direct_io, int sync_ms)
+	{
+		NskWriteBehindOptions options = DefaultWriteBehindOptions();
+		if (queue_buffers > 0) options.queue_buffers = queue_buffers;
+		if (buffer_kb > 0) options.buffer_kb = buffer_kb;
+		options.direct_io = direct_io ? 1 : 0;
+		options.sync_ms = std::max(sync_ms, 0);
+		session->write_behind = options;
+	}
+
+	// Stream recording write-behind telemetry (queue depth and high-water, producer stalls, syncs, write errors)
+	__declspec(dllexport) void NSK_GetWriteBehind(NskSession *session, NskWriteBehind *telemetry)
+	{
+		if (session->recorder)
+			*telemetry = session->recorder->WriteTelemetry();
+		else
+			*telemetry = session->api.StreamRecordingTelemetry();
+	}
+
+	// Set the capacity (in packets) of the acquisition ring used by the next NSK_Start
+	__declspec(dllexport) void NSK_SetRingCapacity(NskSession *session, int capacity)
+	{
+		session->ring_capacity = capacity;
+	}
+
+	// Report acquisition ring capacity, current fill, high-water mark and overrun (dropped packet) count
+	__declspec(dllexport) void NSK_GetRingStats(NskSession *session, int *capacity, int *fill, int *high_water, unsigned long long *overruns)
+	{
+		if (!session->ring)
 		{
-			// Read next packet (sample) from FIFO
-			rec = api.readElectrodeData(ep, NULL);
-			if (rec != READ_SUCCESS) return i;
+			*capacity = *fill = *high_water = 0;
+			*overruns = 0;
+			return;
+		}
+		*capacity = session->ring->Capacity();
+		*fill = session->ring->Available();
+		*high_water = session->ring->HighWaterMark();
+		*overruns = session->ring->Overruns();
+	}
 
-			for (int c = 0; c < n_channels; c++)
-			{
-				buffer[(c * buffer_size) + i] = ep.getChannelData(c);
-			}
+	// Expected packet counter increment between consecutive packets (default 1)
+	__declspec(dllexport) void NSK_SetCounterStep(NskSession *session, unsigned int step)
+	{
+		session->packet_stats.SetCounterStep(step);
+	}
+
+	// Cumulative packet accounting (delivered, gaps, lost, duplicates, resets, DATA_ERROR packets, link timeouts)
+	__declspec(dllexport) void NSK_GetPacketStats(NskSession *session, NskPacketStats *stats)
+	{
+		*stats = session->packet_stats.Totals();
+	}
+
+	// Counter gaps found in the last block read, returns the number of gaps (up to max_gaps are copied)
+	__declspec(dllexport) int NSK_GetBlockGaps(NskSession *session, NskGap *gaps, int max_gaps)
+	{
+		const std::vector<NskGap> &block_gaps = session->packet_stats.BlockGaps();
+		int n = std::min((int)block_gaps.size(), max_gaps);
+		std::copy(block_gaps.begin(), block_gaps.begin() + n, gaps);
+		return (int)block_gaps.size();
+	}
+
+	// Sync lines (bit mask of the sync word) on which edge events are reported (default all 16)
+	__declspec(dllexport) void NSK_SetSyncLineMask(NskSession *session, unsigned int mask)
+	{
+		session->sync_edges.SetLineMask((unsigned short)mask);
+	}
+
+	// Sync-line edges found in the last block read, returns the number of events (up to max_events are copied)
+	__declspec(dllexport) int NSK_GetSyncEvents(NskSession *session, NskSyncEvent *events, int max_events)
+	{
+		const std::vector<NskSyncEvent> &block_events = session->sync_edges.BlockEvents();
+		int n = std::min((int)block_events.size(), max_events);
+		std::copy(block_events.begin(), block_events.begin() + n, events);
+		return (int)block_events.size();
+	}
+
+	// Monotonic host time (ns), on the same clock as the packet arrival timestamps
+	__declspec(dllexport) long long NSK_GetHostTime()
+	{
+		return HostTimeNs();
+	}
+
+	// Fit window of the counter-to-host-time model, in packets
+	__declspec(dllexport) void NSK_SetClockWindow(NskSession *session, double packets)
+	{
+		session->clock_model.SetWindow(packets);
+	}
+
+	// Current counter-to-host-time linear fit
+	__declspec(dllexport) void NSK_GetClockModel(NskSession *session, NskClockModel *model)
+	{
+		*model = session->clock_model.Model();
+	}
+
+	// Arrival, delivery and model times of the last block read
+	__declspec(dllexport) void NSK_GetBlockTiming(NskSession *session, NskBlockTiming *timing)
+	{
+		*timing = session->clock_model.BlockTiming();
+	}
+
+	// Fitted host time (ns) of an unwrapped packet counter
+	__declspec(dllexport) double NSK_CounterToHostTime(NskSession *session, unsigned long long counter)
+	{
+		return session->clock_model.CounterToHostTime(counter);
+	}
+
+	// Read NeuroSeeker Raw Packets
+	__declspec(dllexport) int NSK_Read(NskSession *session, float *buffer, int buffer_size)
+	{
+		if (!session->ring) return 0;
+
+		// Fill data matrix with channel data from N packets (all_samp_ch0 -> all_samp_ch 1...all_samp_chN, or sample-major, see NSK_SetLayout)
+		return ReadRingBlocks(session, buffer, NULL, buffer_size, buffer_size);
+	}
+
+	// Read NeuroSeeker Raw Packets as raw ADC codes (channel-major, as NSK_Read)
+	__declspec(dllexport) int NSK_Read_Raw(NskSession *session, short *buffer, int buffer_size)
+	{
+		if (!session->ring) return 0;
+		return ReadRingBlocks(session, buffer, NULL, buffer_size, buffer_size);
+	}
+
+	// Read NeuroSeeker Raw Packets together with the sync word of every sample (sync_buffer holds buffer_size words)
+	__declspec(dllexport) int NSK_Read_Sync(NskSession *session, float *buffer, unsigned short *sync_buffer, int buffer_size)
+	{
+		if (!session->ring) return 0;
+		return ReadRingBlocks(session, buffer, sync_buffer, buffer_size, buffer_size);
+	}
+
+	// As NSK_Read_Sync, as raw ADC codes
+	__declspec(dllexport) int NSK_Read_Raw_Sync(NskSession *session, short *buffer, unsigned short *sync_buffer, int buffer_size)
+	{
+		if (!session->ring) return 0;
+		return ReadRingBlocks(session, buffer, sync_buffer, buffer_size, buffer_size);
+	}
+
+	// Select the layout written by the read functions (0: channel-major, 1: sample-major)
+	__declspec(dllexport) void NSK_SetLayout(NskSession *session, int layout)
+	{
+		session->output_layout = layout == LAYOUT_SAMPLE_MAJOR ? LAYOUT_SAMPLE_MAJOR : LAYOUT_CHANNEL_MAJOR;
+	}
+
+	// Set the enabled regions used for channel compaction (without configuring a probe, e.g. for file playback)
+	__declspec(dllexport) void NSK_SetActiveRegions(NskSession *session, int *activeRegions)
+	{
+		BuildActiveChannelMap(session, activeRegions);
+	}
+
+	// Enable/disable compacted output (only live recording channels, in NSK_GetChannelMap order)
+	__declspec(dllexport) void NSK_SetCompaction(NskSession *session, bool compact)
+	{
+		session->compact_channels = compact;
+	}
+
+	// Number of channels (rows or columns) written by the read functions
+	__declspec(dllexport) int NSK_GetChannelCount(NskSession *session)
+	{
+		return session->OutputChannels().Count();
+	}
+
+	// Fill the probe channel index of every output channel, returns the output channel count
+	__declspec(dllexport) int NSK_GetChannelMap(NskSession *session, int *channel_indices)
+	{
+		const std::vector<int> &indices = session->OutputChannels().Indices();
+		std::copy(indices.begin(), indices.end(), channel_indices);
+		return (int)indices.size();
+	}
+
+	// Create the pool of leased blocks (n_blocks buffers of n_channels x block_size, float or raw ADC codes); false,
+	// keeping the current pool, if a size is not positive or while blocks of it are still leased
+	__declspec(dllexport) bool NSK_SetBlockPool(NskSession *session, int n_blocks, int block_size, bool raw)
+	{
+		if (n_blocks <= 0 || block_size <= 0)
+		{
+			std::cout << "Block pool not replaced: invalid size " << n_blocks << " x " << block_size << "\n";
+			return false;
 		}
-		return buffer_size;
+		if (!FreeBlockPool(session))
+		{
+			std::cout << "Block pool not replaced: " << session->block_pool->Leased() << " blocks still leased\n";
+			return false;
+		}
+		session->block_pool = new BlockPool(n_blocks, block_size, session->n_channels, raw);
+		return true;
+	}
+
+	// Lease the next block of probe data without copying (returns samples read, 0 at end, -1 if no free block)
+	__declspec(dllexport) int NSK_AcquireBlock(NskSession *session, NskBlock *block)
+	{
+		if (!session->ring || !session->block_pool) return 0;
+		int index = session->block_pool->Acquire();
+		if (index < 0) return -1;
 
+		// Fill the whole block, or the adaptive block size if that is smaller (channel-major rows stay the pool block size
+		// apart, the step LeaseBlock reports)
+		int row_step = session->block_pool->BlockSize();
+		int block_size = row_step;
+		int adaptive_size = NextBlockSize(session);
+		if (adaptive_size > 0 && adaptive_size < block_size)
+			block_size = adaptive_size;
+
+		int n_read;
+		if (session->block_pool->IsRaw())
+			n_read = ReadRingBlocks(session, (short *)session->block_pool->Data(index), session->block_pool->Sync(index), block_size, row_step);
+		else
+			n_read = ReadRingBlocks(session, (float *)session->block_pool->Data(index), session->block_pool->Sync(index), block_size, row_step);
+		return LeaseBlock(session, index, n_read, true, block);
+	}
+
+	// Return a leased block to the pool
+	__declspec(dllexport) bool NSK_ReleaseBlock(NskSession *session, unsigned long long sequence)
+	{
+		if (!session->block_pool) return false;
+		return session->block_pool->Release(sequence);
+	}
+
+	// Get the per-channel scale from raw ADC code to volts (n_channels values, indexed by probe channel)
+	__declspec(dllexport) void NSK_GetChannelScale(NskSession *session, float *scale)
+	{
+		std::copy(session->channel_scale.begin(), session->channel_scale.end(), scale);
 	}
 
 
 	// Close NeuroSeeker Probe
-	__declspec(dllexport) void NSK_Close()
+	__declspec(dllexport) void NSK_Close(NskSession *session)
 	{
 		// Error Code containers
-		ErrorCode ec;
 		GeneralConfigErrorCode gec;
 		DacControlErrorCode dcec;
 		ShiftRegisterAccessErrorCode srac;
 
+		// Stop reader thread and FIFO polling
+		session->acquisition.Stop();
+		session->fifo_monitor.Stop();
+		if (session->ring)
+		{
+			std::cout << "Acquisition ring: high-water " << session->ring->HighWaterMark() << "/" << session->ring->Capacity();
+			std::cout << ", overruns " << session->ring->Overruns() << ", read error " << session->acquisition.LastError() << "\n";
+			NskPacketStats stats = session->packet_stats.Totals();
+			std::cout << "Packets: " << stats.packets << ", lost " << stats.lost << " in " << stats.gaps << " gaps, ";
+			std::cout << stats.duplicates << " duplicates, " << stats.data_errors << " data errors, " << stats.link_timeouts << " link timeouts\n";
+			delete session->ring;
+			session->ring = NULL;
+		}
+
 		// Stream Recording (stop?)
-		if (stream_recording)
+		if (session->stream_recording)
 		{
 			std::cout << "Stopping the Recording Stream: ";
-			ec = api.stopRecording();
-			std::cout << ec << "\n";
-			stream_recording = false;
+			NskWriteBehind write_stats;
+			if (session->recorder)
+			{
+				bool closed = session->recorder->Close();
+				NskRecordingStats stats = session->recorder->Stats();
+				write_stats = session->recorder->WriteTelemetry();
+				std::cout << (closed ? "closed, " : "write error, ") << stats.samples << " samples, " << stats.bytes_out << " bytes (";
+				std::cout << std::setprecision(3) << (stats.bytes_out ? (double)stats.bytes_in / stats.bytes_out : 0.0) << "x)";
+				if (stats.clipped) std::cout << ", " << stats.clipped << " values clipped";
+				std::cout << "\n";
+				delete session->recorder;
+				session->recorder = NULL;
+			}
+			else
+			{
+				bool closed = session->api.StopStreamRecording();
+				write_stats = session->api.StreamRecordingTelemetry();
+				std::cout << (closed ? "closed, " : "write error, ") << write_stats.bytes_written << " bytes\n";
+			}
+			std::cout << "Write-behind queue: high-water " << write_stats.queue_high_water << " buffers, " << write_stats.stalls << " stalls (";
+			std::cout << write_stats.stall_ns / 1000000 << " ms, longest " << write_stats.max_stall_ns / 1000000 << " ms), ";
+			std::cout << write_stats.syncs << " syncs, " << write_stats.write_errors << " write errors\n";
+			session->stream_recording = false;
+
+			// Overview pyramid of the finished recording, off the caller's thread
+			if (session->build_pyramid)
+			{
+				if (session->pyramid_builder.joinable()) session->pyramid_builder.join();
+				std::string recorded_file = session->recorded_file;
+				bool native = session->decoder != NULL;
+				PacketDecoder decoder = native ? *session->decoder : PacketDecoder();
+				std::cout << "Building overview pyramid " << PyramidFileName(recorded_file) << " in the background\n";
+				session->pyramid_builder = std::thread([recorded_file, native, decoder]()
+				{
+					NskPyramidResult result;
+					std::string error;
+					if (!BuildPyramid(recorded_file, PyramidFileName(recorded_file), native ? &decoder : NULL, 0, result, error))
+						std::cout << "Overview pyramid of " << recorded_file << " failed: " << error << "\n";
+				});
+			}
 		}
 
 		// Disable Test mode (if testing)
-		if (testing)
+		if (session->testing)
 		{
 			std::cout << "Stopping the Test Mode: ";
-			dcec = api.generateDC(DAC_A, 0.0f);
-			gec = api.generalConfiguration.setTestInputEnBit(false);
-			srac = api.writeGeneralRegister(true);
+			dcec = session->api.generateDC(DAC_A, 0.0f);
+			gec = session->api.generalConfiguration.setTestInputEnBit(false);
+			srac = session->api.writeGeneralRegister(true);
 			std::cout << dcec << " " << gec << " " << srac << "\n";
-			testing = false;
+			session->testing = false;
 		}
 
+		// Free leased block buffers (kept while blocks are still leased)
+		FreeBlockPool(session);
+
 		// Stop Log
-		api.stopLog();
+		session->api.stopLog();
 
 		// Close connection to Nsk Probe
 		std::cout << "Attempting to close Nsk Probe: ";
-		api.close();
+		session->api.close();
 		std::cout << "Closed\n";
 	}
 
@@ -314,8 +910,16 @@ extern "C"
 
 	// Function Library for Loading NSK FIles
 	// --------------------------------------
-	// Open NeuroSeeker Data File
-	__declspec(dllexport) void NSK_Open_File(char *filename)
+	// Report a data file that cannot be played back (the session is left without an open file)
+	static bool FailOpenFile(NskSession *session, const char *reason)
+	{
+		std::cout << reason << "\n";
+		session->playback_file.clear();
+		return false;
+	}
+
+	// Open NeuroSeeker Data File (false if the file or manifest cannot be played back)
+	__declspec(dllexport) bool NSK_Open_File(NskSession *session, char *filename)
 	{
 		// Error Code containers
 		ErrorCode ec;
@@ -323,46 +927,460 @@ extern "C"
 		// Check Nsk API version
 		std::cout << "Opening NeuroSeeker Data File: ";
 		const std::string filename_str(filename);
-		DataLink = new NeuroseekerDataLinkFile(filename_str);
-		ec = api.datamode(true); // set ElectrodeMode
+		delete session->data_link;
+		session->data_link = NULL;
+		session->mapped_file = NULL;
+		delete session->recording_file;
+		session->recording_file = NULL;
+		delete session->pyramid;
+		session->pyramid = NULL;
+		session->playback_file = filename_str;
+		session->pacer.Reset();
+		session->packet_stats.Reset();
+		session->sync_edges.Reset();
+		session->clock_model.Reset();
+
+		// Segmented recording: the manifest's segments play back as one recording with global sample indices
+		if (IsManifestFile(filename_str))
+		{
+			RecordingManifest manifest;
+			if (!ReadManifest(filename_str, manifest)) return FailOpenFile(session, "invalid manifest");
+			if (manifest.format != RECORDING_RAW)
+			{
+				SegmentedReader *segments = new SegmentedReader();
+				if (!segments->Open(filename_str))
+				{
+					delete segments;
+					return FailOpenFile(session, "no readable segment");
+				}
+				std::cout << segments->Segments() << " segments (" << segments->MissingSegments() << " unreadable), " << segments->Samples() << " samples (";
+				std::cout << segments->MissingSamples() << " missing)\n";
+				session->recording_file = segments;
+				return true;
+			}
+			std::vector<std::string> segment_files;
+			std::vector<unsigned long long> first_samples;
+			for (size_t i = 0; i < manifest.segments.size(); i++)
+			{
+				segment_files.push_back(ManifestSegmentPath(filename_str, manifest.segments[i].file));
+				first_samples.push_back(manifest.segments[i].first_sample);
+			}
+			session->mapped_file = new NeuroseekerDataLinkMapped(segment_files, first_samples);
+			if (!session->mapped_file->IsOpen())
+			{
+				delete session->mapped_file;
+				session->mapped_file = NULL;
+				return FailOpenFile(session, "no readable segment");
+			}
+			std::cout << session->mapped_file->Segments() << " segments (" << session->mapped_file->MissingSegments() << " unreadable), ";
+			std::cout << session->mapped_file->Packets() << " samples (" << session->mapped_file->MissingPackets() << " missing): ";
+			session->data_link = session->mapped_file;
+			session->mapped_file->SetReadahead(session->readahead_window);
+			ec = session->api.datamode(true); // set ElectrodeMode
+			std::cout << ec << "\n";
+			return true;
+		}
+
+		// The DLL's own formats are decoded without the vendor data link
+		int format = RecordingFileFormat(filename_str);
+		if (format != RECORDING_RAW)
+		{
+			session->recording_file = CreateRecordingReader(format);
+			const char *name = format == RECORDING_PACKED ? "packed" : "compressed";
+			if (!session->recording_file->Open(filename_str))
+			{
+				delete session->recording_file;
+				session->recording_file = NULL;
+				return FailOpenFile(session, (std::string("invalid ") + name + " file").c_str());
+			}
+			std::cout << name << ", " << session->recording_file->Samples() << " samples\n";
+			return true;
+		}
+
+		// Memory-mapped (seekable) playback, or the stream reader if the file cannot be mapped
+		session->mapped_file = new NeuroseekerDataLinkMapped(filename_str);
+		session->data_link = session->mapped_file;
+		if (!session->mapped_file->IsOpen())
+		{
+			delete session->mapped_file;
+			session->mapped_file = NULL;
+			session->data_link = NULL;
+			if (!std::ifstream(filename_str, std::ios::binary)) return FailOpenFile(session, "cannot open file");
+			session->data_link = new NeuroseekerDataLinkFile(filename_str);
+		}
+		else
+		{
+			session->mapped_file->SetReadahead(session->readahead_window);
+		}
+		ec = session->api.datamode(true); // set ElectrodeMode
 		std::cout << ec << "\n";
+		return true;
 	}
 
 	// Read NeuroSeeker Data File
-	__declspec(dllexport) int NSK_Read_File(float *buffer, unsigned short *sync_buffer, int buffer_size)
+	__declspec(dllexport) int NSK_Read_File(NskSession *session, float *buffer, unsigned short *sync_buffer, int buffer_size)
 	{
 		// Error Code containers
 		ReadErrorCode rec;
-		unsigned int pos;
+		unsigned int pos = 0;
 
 		// Adjust file reading
 		// - Subtract baseline (DC)
 		// - Subtract median per Region Groups (2 region blocks)
 
-		// Fill data matrix with channel data from N packets (all_samp_ch0 -> all_samp_ch 1...all_samp_chN)
-		for (int i = 0; i < buffer_size; i++)
-		{
-			// Read next packet (sample) from FIFO
-			rec = api.readElectrodeData(ep, DataLink);
-			if (rec != READ_SUCCESS) return i;
+		if (!session->data_link && !session->recording_file) return 0;
 
-			pos = ep.getCounter(0);
-			sync_buffer[i] = ep.getSynchronization();
-			for (int c = 0; c < n_channels; c++)
-			{
-				buffer[(c * buffer_size) + i] = ep.getChannelData(c);
-				
-			}
-		}
+		// Fill data matrix with channel data from N packets (all_samp_ch0 -> all_samp_ch 1...all_samp_chN, or sample-major, see NSK_SetLayout)
+		int n_read = ReadPacketBlocks(session, session->data_link, buffer, sync_buffer, buffer_size, rec, pos);
+		session->pacer.Release(n_read);
+		if (n_read < buffer_size) return n_read;
 		std::cout << rec << " " << pos << "\n";
 		return buffer_size;
 	}
 
+	// Read NeuroSeeker Data File as raw ADC codes (channel-major, as NSK_Read_File)
+	__declspec(dllexport) int NSK_Read_File_Raw(NskSession *session, short *buffer, unsigned short *sync_buffer, int buffer_size)
+	{
+		// Error Code containers
+		ReadErrorCode rec;
+		unsigned int pos = 0;
+
+		if (!session->data_link && !session->recording_file) return 0;
+		int n_read = ReadPacketBlocks(session, session->data_link, buffer, sync_buffer, buffer_size, rec, pos);
+		session->pacer.Release(n_read);
+		return n_read;
+	}
+
+	// Read every stride-th sample of the data file (as NSK_Read_File, returns samples read), skipping the samples in
+	// between without decoding them; paced playback treats each sample as stride samples of recording time
+	__declspec(dllexport) int NSK_Read_File_Strided(NskSession *session, float *buffer, unsigned short *sync_buffer, int buffer_size, int stride)
+	{
+		ReadErrorCode rec;
+		unsigned int pos = 0;
+
+		if (!session->data_link && !session->recording_file) return 0;
+		int n_read = ReadPacketBlocks(session, session->data_link, buffer, sync_buffer, buffer_size, rec, pos, stride);
+		session->pacer.Release(n_read * std::max(stride, 1));
+		return n_read;
+	}
+
+	// Read every stride-th sample of the data file as raw ADC codes (as NSK_Read_File_Raw)
+	__declspec(dllexport) int NSK_Read_File_Raw_Strided(NskSession *session, short *buffer, unsigned short *sync_buffer, int buffer_size, int stride)
+	{
+		ReadErrorCode rec;
+		unsigned int pos = 0;
+
+		if (!session->data_link && !session->recording_file) return 0;
+		int n_read = ReadPacketBlocks(session, session->data_link, buffer, sync_buffer, buffer_size, rec, pos, stride);
+		session->pacer.Release(n_read * std::max(stride, 1));
+		return n_read;
+	}
+
+	// Skip count samples of the data file without decoding them, also on files that cannot be seeked (false on a
+	// read error; stops at the end of the file)
+	__declspec(dllexport) bool NSK_Skip_File(NskSession *session, unsigned long long count)
+	{
+		if (!session->data_link && !session->recording_file) return false;
+		if (SkipPackets(session, session->data_link, count) != READ_SUCCESS) return false;
+		// The counters and sync word no longer follow on from the last read
+		session->packet_stats.Resync();
+		session->sync_edges.Reset();
+		session->clock_model.Reset();
+		session->pacer.Resync();
+		return true;
+	}
+
+	// Number of samples (packets) in the open data file (0 if the file is not seekable)
+	__declspec(dllexport) unsigned long long NSK_Get_File_Samples(NskSession *session)
+	{
+		if (session->recording_file) return session->recording_file->Samples();
+		return session->mapped_file ? session->mapped_file->Packets() : 0;
+	}
+
+	// Readahead window of file playback in MB (0: off), applied to the open file and the files opened next
+	__declspec(dllexport) void NSK_SetFileReadahead(NskSession *session, int megabytes)
+	{
+		session->readahead_window = megabytes > 0 ? (unsigned long long)megabytes << 20 : 0;
+		if (session->mapped_file) session->mapped_file->SetReadahead(session->readahead_window);
+	}
+
+	// Readahead telemetry of the open file (all zero when the file is not memory-mapped)
+	__declspec(dllexport) void NSK_GetFileReadahead(NskSession *session, NskReadahead *readahead)
+	{
+		if (session->mapped_file)
+			*readahead = session->mapped_file->ReadaheadTelemetry();
+		else
+			*readahead = NskReadahead();
+	}
+
+	// Sample index of the next file read
+	__declspec(dllexport) unsigned long long NSK_Get_File_Position(NskSession *session)
+	{
+		if (session->recording_file) return session->recording_file->Position();
+		return session->mapped_file ? session->mapped_file->Position() : 0;
+	}
+
+	// Move the next file read to a sample index (false if the file is not seekable or sample is past the end)
+	__declspec(dllexport) bool NSK_Seek_File(NskSession *session, unsigned long long sample)
+	{
+		if (session->recording_file)
+		{
+			if (!session->recording_file->Seek(sample)) return false;
+		}
+		else if (!session->mapped_file || !session->mapped_file->Seek(sample)) return false;
+		// The counters and sync word no longer follow on from the last read
+		session->packet_stats.Resync();
+		session->sync_edges.Reset();
+		session->clock_model.Reset();
+		session->pacer.Resync();
+		return true;
+	}
+
+	// Read count samples starting at a sample index (as NSK_Read_File, returns samples read, -1 if the file is not seekable)
+	__declspec(dllexport) int NSK_Read_File_At(NskSession *session, unsigned long long start, float *buffer, unsigned short *sync_buffer, int count)
+	{
+		ReadErrorCode rec;
+		unsigned int pos = 0;
+
+		if (!session->data_link && !session->recording_file) return -1;
+		if (!NSK_Seek_File(session, start)) return -1;
+		return ReadPacketBlocks(session, session->data_link, buffer, sync_buffer, count, rec, pos);
+	}
+
+	// Read count samples starting at a sample index as raw ADC codes (as NSK_Read_File_Raw)
+	__declspec(dllexport) int NSK_Read_File_Raw_At(NskSession *session, unsigned long long start, short *buffer, unsigned short *sync_buffer, int count)
+	{
+		ReadErrorCode rec;
+		unsigned int pos = 0;
+
+		if (!session->data_link && !session->recording_file) return -1;
+		if (!NSK_Seek_File(session, start)) return -1;
+		return ReadPacketBlocks(session, session->data_link, buffer, sync_buffer, count, rec, pos);
+	}
+
+	// Lease the next block of file data without copying (returns samples read, 0 at end, -1 if no free block)
+	__declspec(dllexport) int NSK_AcquireFileBlock(NskSession *session, NskBlock *block)
+	{
+		// Error Code containers
+		ReadErrorCode rec;
+		unsigned int pos = 0;
+
+		if ((!session->data_link && !session->recording_file) || !session->block_pool) return 0;
+		int index = session->block_pool->Acquire();
+		if (index < 0) return -1;
+
+		int n_read;
+		if (session->block_pool->IsRaw())
+			n_read = ReadPacketBlocks(session, session->data_link, (short *)session->block_pool->Data(index), session->block_pool->Sync(index), session->block_pool->BlockSize(), rec, pos);
+		else
+			n_read = ReadPacketBlocks(session, session->data_link, (float *)session->block_pool->Data(index), session->block_pool->Sync(index), session->block_pool->BlockSize(), rec, pos);
+		session->pacer.Release(n_read);
+		return LeaseBlock(session, index, n_read, true, block);
+	}
+
+	// Release sequential file reads (NSK_Read_File, NSK_Read_File_Raw, NSK_AcquireFileBlock) at speed times the sample
+	// rate against the host clock (speed 0: as fast as possible, 1: real time; sample_rate 0: nominal 20 kHz)
+	__declspec(dllexport) void NSK_SetPlaybackSpeed(NskSession *session, double speed, double sample_rate)
+	{
+		session->pacer.SetSpeed(speed, sample_rate);
+	}
+
+	// Paced playback telemetry (blocks released, how far behind schedule, time spent waiting)
+	__declspec(dllexport) void NSK_GetPlaybackPacing(NskSession *session, NskPlaybackPacing *pacing)
+	{
+		*pacing = session->pacer.Telemetry();
+	}
+
 	// Close NeuroSeeker Data File
-	__declspec(dllexport) void NSK_Close_File()
+	__declspec(dllexport) void NSK_Close_File(NskSession *session)
 	{
 		// Free memory from data buffer
-		free(DataLink);
+		delete session->data_link;
+		session->data_link = NULL;
+		session->mapped_file = NULL;
+		delete session->recording_file;
+		session->recording_file = NULL;
+		delete session->pyramid;
+		session->pyramid = NULL;
+		session->playback_file.clear();
+		FreeBlockPool(session);
+	}
+
+	// Learn the packet chain layout of a recording from the vendor decoder, and save it as a layout file
+	__declspec(dllexport) bool NSK_LearnPacketLayout(char *nsk_file, char *layout_file)
+	{
+		std::cout << "Learning packet layout from " << nsk_file << ": ";
+		std::vector<char> chain;
+		if (!ReadReferenceChain(nsk_file, chain))
+		{
+			std::cout << "no valid packet\n";
+			return false;
+		}
+		PacketLayout layout;
+		std::string error;
+		if (!LearnPacketLayout(&chain[0], layout, error))
+		{
+			std::cout << error << "\n";
+			return false;
+		}
+		PacketDecoder decoder;
+		bool saved = decoder.SetLayout(layout) && decoder.Save(layout_file);
+		std::cout << (saved ? "saved " : "failed to save ") << layout_file << "\n";
+		return saved;
+	}
+
+	// Decode a whole recording with both the vendor and the native decoder, counting the packets on which they disagree
+	__declspec(dllexport) bool NSK_ValidatePacketLayout(char *layout_file, char *nsk_file, unsigned long long *packets, unsigned long long *mismatches)
+	{
+		PacketDecoder decoder;
+		if (!decoder.Load(layout_file)) return false;
+		return ValidatePacketDecoder(decoder, nsk_file, *packets, *mismatches);
+	}
+
+	// Decode a whole recording on all cores into a flat binary of the given channels (ascending probe channels, NULL for
+	// all) and optionally of the sync words; layout_file selects the native decoder (NULL or empty: vendor decoder),
+	// which extracts only the codes of subsets of up to 360 channels (e.g. NSK_ChannelsInRows) from each packet
+	__declspec(dllexport) bool NSK_ExportFile(char *nsk_file, char *out_file, char *sync_file, char *layout_file, int *channels, int n_channels, NskExportOptions *options, NskExportResult *result)
+	{
+		PacketDecoder decoder;
+		bool native = layout_file != NULL && layout_file[0] != 0;
+		if (native && !decoder.Load(layout_file))
+		{
+			std::cout << "Invalid packet layout file: " << layout_file << "\n";
+			return false;
+		}
+		std::vector<int> channel_list;
+		if (channels) channel_list.assign(channels, channels + n_channels);
+
+		std::string error;
+		if (!ExportRecording(nsk_file, out_file, sync_file ? sync_file : "", native ? &decoder : NULL, channel_list, *options, *result, error))
+		{
+			std::cout << "Export of " << nsk_file << " failed: " << error << "\n";
+			return false;
+		}
+		return true;
+	}
+
+	// Probe channels of electrode rows [first_row, last_row] (360 rows of 4, ascending) for NSK_ExportFile; returns the
+	// number of channels, written to channels unless it is NULL (room for 1440)
+	__declspec(dllexport) int NSK_ChannelsInRows(int first_row, int last_row, int *channels)
+	{
+		std::vector<int> rows = ChannelsInRows(first_row, last_row);
+		if (channels && !rows.empty()) std::copy(rows.begin(), rows.end(), channels);
+		return (int)rows.size();
+	}
+
+	// Convert a whole recording into a compressed (1) or packed (2) recording, encoding on threads threads (0 for all
+	// cores); layout_file selects the native decoder (NULL or empty: vendor decoder)
+	__declspec(dllexport) bool NSK_ConvertFile(char *nsk_file, char *out_file, char *layout_file, int format, int threads, NskExportResult *result)
+	{
+		PacketDecoder decoder;
+		bool native = layout_file != NULL && layout_file[0] != 0;
+		if (native && !decoder.Load(layout_file))
+		{
+			std::cout << "Invalid packet layout file: " << layout_file << "\n";
+			return false;
+		}
+
+		std::string error;
+		if (!ConvertRecording(nsk_file, out_file, native ? &decoder : NULL, format, threads, *result, error))
+		{
+			std::cout << "Conversion of " << nsk_file << " failed: " << error << "\n";
+			return false;
+		}
+		return true;
+	}
+
+	// Check every packet of a raw recording or manifest on threads threads: status bits, counter continuity and sync
+	// sanity (options NULL for the defaults); writes the bad ranges to report_file unless it is NULL or empty, and
+	// returns false only if the file could not be scanned. layout_file selects the native decoder (NULL or empty: vendor)
+	__declspec(dllexport) bool NSK_ScanFile(char *nsk_file, char *report_file, char *layout_file, NskScanOptions *options, NskScanResult *result)
+	{
+		PacketDecoder decoder;
+		bool native = layout_file != NULL && layout_file[0] != 0;
+		if (native && !decoder.Load(layout_file))
+		{
+			std::cout << "Invalid packet layout file: " << layout_file << "\n";
+			return false;
+		}
+
+		std::vector<NskBadRange> ranges;
+		std::string error;
+		if (!ScanRecording(nsk_file, native ? &decoder : NULL, options ? *options : DefaultScanOptions(), *result, ranges, error))
+		{
+			std::cout << "Scan of " << nsk_file << " failed: " << error << "\n";
+			return false;
+		}
+		if (report_file != NULL && report_file[0] != 0 && !WriteScanReport(report_file, nsk_file, *result, ranges))
+		{
+			std::cout << "Cannot write scan report " << report_file << "\n";
+			return false;
+		}
+		return true;
+	}
+
+	// Build the min/max/mean overview pyramid (<recording>.nskv) of any playable recording or manifest on threads threads
+	// (0 for all cores); layout_file selects the native decoder for raw recordings (NULL or empty: vendor decoder)
+	__declspec(dllexport) bool NSK_BuildPyramid(char *recording_file, char *layout_file, int threads, NskPyramidResult *result)
+	{
+		PacketDecoder decoder;
+		bool native = layout_file != NULL && layout_file[0] != 0;
+		if (native && !decoder.Load(layout_file))
+		{
+			std::cout << "Invalid packet layout file: " << layout_file << "\n";
+			return false;
+		}
+
+		std::string error;
+		if (!BuildPyramid(recording_file, PyramidFileName(recording_file), native ? &decoder : NULL, threads, *result, error))
+		{
+			std::cout << "Overview pyramid of " << recording_file << " failed: " << error << "\n";
+			return false;
+		}
+		return true;
+	}
+
+	// Build the overview pyramid of stream recordings in the background once NSK_Close has stopped them
+	__declspec(dllexport) void NSK_SetPyramidOnClose(NskSession *session, bool enable)
+	{
+		session->build_pyramid = enable;
+	}
+
+	// Summarise samples [start, end) of the open playback file in columns columns of n_channels min/max/mean ADC codes
+	// (bins[column * n_channels + channel], probe channel order) from its overview pyramid; returns the pyramid level
+	// used, -1 if the file has no pyramid or the span is empty or out of range
+	__declspec(dllexport) int NSK_QueryPyramid(NskSession *session, unsigned long long start, unsigned long long end, int columns, NskPyramidBin *bins)
+	{
+		if (session->playback_file.empty()) return -1;
+		if (session->pyramid == NULL)
+		{
+			PyramidReader *pyramid = new PyramidReader();
+			if (!pyramid->Open(PyramidFileName(session->playback_file)))
+			{
+				delete pyramid;
+				return -1;
+			}
+			session->pyramid = pyramid;
+		}
+		return session->pyramid->Query(start, end, columns, bins);
+	}
+
+	// Decode data link reads with the native decoder of a layout file (NULL or empty: vendor decoder)
+	__declspec(dllexport) bool NSK_SetPacketDecoder(NskSession *session, char *layout_file)
+	{
+		delete session->decoder;
+		session->decoder = NULL;
+		if (layout_file == NULL || layout_file[0] == 0) return true;
+
+		PacketDecoder *decoder = new PacketDecoder();
+		if (!decoder->Load(layout_file))
+		{
+			std::cout << "Invalid packet layout file: " << layout_file << "\n";
+			delete decoder;
+			return false;
+		}
+		session->decoder = decoder;
+		return true;
 	}
 
 }
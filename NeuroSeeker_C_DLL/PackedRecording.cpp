@@ -0,0 +1,234 @@
+// PackedRecording.cpp : Fixed-width 10-bit packed recording writer and reader
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define NSK_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "PackedRecording.h"
+
+static_assert(sizeof(NskpFileHeader) == 32, "Unexpected .nskp header packing");
+static_assert(NUMBER_OF_CHANNELS % 8 == 0, "Packed records hold whole groups of 8 channels");
+static_assert(sizeof(PacketRecord().counters) == 4 * PACKED_COUNTERS, "Packed records hold every packet counter");
+
+int PackRecord(const PacketRecord& record, unsigned char* packed)
+{
+	memcpy(packed, record.counters, 4 * PACKED_COUNTERS);
+	memcpy(packed + 4 * PACKED_COUNTERS, &record.synchronization, 2);
+	packed[4 * PACKED_COUNTERS + 2] = packed[4 * PACKED_COUNTERS + 3] = 0;
+	unsigned char* low = packed + PACKED_HEADER_BYTES;
+	unsigned char* high = low + PACKED_LOW_BYTES;
+	const float* values = record.channelData;
+	int clipped = 0;
+	int c = 0;
+#ifdef NSK_SSE2
+	// Round and saturate 8 channels, split into low bytes and a word of 2-bit high parts (summed lane by lane).
+	// Codes that do not convert back to their value are counted lane by lane (compare masks are -1)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i code_max = _mm_set1_epi16(PACKED_CODE_MAX);
+	const __m128i low_mask = _mm_set1_epi16(0xFF);
+	const __m128i high_shift = _mm_setr_epi16(1 << 0, 1 << 2, 1 << 4, 1 << 6, 1 << 8, 1 << 10, 1 << 12, 1 << 14);
+	const __m128i ones = _mm_set1_epi16(1);
+	__m128i inexact = zero;
+	for (; c + 8 <= (int)NUMBER_OF_CHANNELS; c += 8)
+	{
+		__m128 lo_values = _mm_loadu_ps(values + c);
+		__m128 hi_values = _mm_loadu_ps(values + c + 4);
+		__m128i codes = _mm_packs_epi32(_mm_cvtps_epi32(lo_values), _mm_cvtps_epi32(hi_values));
+		codes = _mm_min_epi16(_mm_max_epi16(codes, zero), code_max);
+		inexact = _mm_sub_epi32(inexact, _mm_castps_si128(_mm_cmpneq_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(codes, zero)), lo_values)));
+		inexact = _mm_sub_epi32(inexact, _mm_castps_si128(_mm_cmpneq_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(codes, zero)), hi_values)));
+		_mm_storel_epi64((__m128i*)(low + c), _mm_packus_epi16(_mm_and_si128(codes, low_mask), zero));
+		__m128i sums = _mm_madd_epi16(_mm_mullo_epi16(_mm_srli_epi16(codes, 8), high_shift), ones);
+		sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(1, 0, 3, 2)));
+		sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, _MM_SHUFFLE(2, 3, 0, 1)));
+		unsigned int word = (unsigned int)_mm_cvtsi128_si32(sums);
+		high[c / 4] = (unsigned char)word;
+		high[c / 4 + 1] = (unsigned char)(word >> 8);
+	}
+	inexact = _mm_add_epi32(inexact, _mm_shuffle_epi32(inexact, _MM_SHUFFLE(1, 0, 3, 2)));
+	inexact = _mm_add_epi32(inexact, _mm_shuffle_epi32(inexact, _MM_SHUFFLE(2, 3, 0, 1)));
+	clipped = _mm_cvtsi128_si32(inexact);
+#endif
+	for (; c < (int)NUMBER_OF_CHANNELS; c += 8)
+	{
+		unsigned int word = 0;
+		for (int j = 0; j < 8; j++)
+		{
+			int code = std::min(std::max((int)lrintf(values[c + j]), 0), PACKED_CODE_MAX);
+			if ((float)code != values[c + j]) clipped++;
+			low[c + j] = (unsigned char)code;
+			word |= (unsigned int)(code >> 8) << (2 * j);
+		}
+		high[c / 4] = (unsigned char)word;
+		high[c / 4 + 1] = (unsigned char)(word >> 8);
+	}
+	return clipped;
+}
+
+void UnpackRecord(const unsigned char* packed, PacketRecord* record)
+{
+	memcpy(record->counters, packed, 4 * PACKED_COUNTERS);
+	memcpy(&record->synchronization, packed + 4 * PACKED_COUNTERS, 2);
+	const unsigned char* low = packed + PACKED_HEADER_BYTES;
+	const unsigned char* high = low + PACKED_LOW_BYTES;
+	float* values = record->channelData;
+	int c = 0;
+#ifdef NSK_SSE2
+	// Broadcast the high word of 8 channels, move each lane's 2 bits to the top (multiply) and down to bits 8..9
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i high_shift = _mm_setr_epi16(1 << 14, 1 << 12, 1 << 10, 1 << 8, 1 << 6, 1 << 4, 1 << 2, 1 << 0);
+	for (; c + 8 <= (int)NUMBER_OF_CHANNELS; c += 8)
+	{
+		__m128i lows = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(low + c)), zero);
+		__m128i highs = _mm_set1_epi16((short)(high[c / 4] | (high[c / 4 + 1] << 8)));
+		highs = _mm_slli_epi16(_mm_srli_epi16(_mm_mullo_epi16(highs, high_shift), 14), 8);
+		__m128i codes = _mm_or_si128(lows, highs);
+		_mm_storeu_ps(values + c, _mm_cvtepi32_ps(_mm_unpacklo_epi16(codes, zero)));
+		_mm_storeu_ps(values + c + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(codes, zero)));
+	}
+#endif
+	for (; c < (int)NUMBER_OF_CHANNELS; c += 8)
+	{
+		unsigned int word = high[c / 4] | (high[c / 4 + 1] << 8);
+		for (int j = 0; j < 8; j++)
+		{
+			values[c + j] = (float)(low[c + j] | (((word >> (2 * j)) & 3) << 8));
+		}
+	}
+}
+
+PackedWriter::PackedWriter()
+	: packed(PACKED_RECORD_BYTES), samples(0), clipped(0)
+{
+}
+
+PackedWriter::~PackedWriter()
+{
+	Close();
+}
+
+bool PackedWriter::Open(const std::string& filename, const NskWriteBehindOptions& options)
+{
+	Close();
+	if (!file.Open(filename, options)) return false;
+	NskpFileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = NSKP_FILE_MAGIC;
+	header.version = NSKP_VERSION;
+	header.channels = NUMBER_OF_CHANNELS;
+	header.record_bytes = PACKED_RECORD_BYTES;
+	file.Write(&header, sizeof(header));
+	samples = 0;
+	clipped = 0;
+	return true;
+}
+
+bool PackedWriter::Close()
+{
+	return file.Close();
+}
+
+bool PackedWriter::IsOpen() const
+{
+	return file.IsOpen();
+}
+
+void PackedWriter::Append(const PacketRecord* records, int n)
+{
+	unsigned long long inexact = 0;
+	for (int i = 0; i < n; i++)
+	{
+		inexact += PackRecord(records[i], &packed[0]);
+		file.Write(&packed[0], PACKED_RECORD_BYTES);
+	}
+	samples += n;
+	clipped += inexact;
+}
+
+NskRecordingStats PackedWriter::Stats() const
+{
+	NskWriteBehind telemetry = file.Telemetry();
+	NskRecordingStats stats;
+	stats.samples = samples;
+	stats.bytes_in = samples * PACKET_CHAIN_BYTES;
+	stats.bytes_out = telemetry.bytes_written;
+	stats.stalls = telemetry.stalls;
+	stats.clipped = clipped;
+	return stats;
+}
+
+NskWriteBehind PackedWriter::WriteTelemetry() const
+{
+	return file.Telemetry();
+}
+
+PackedReader::PackedReader()
+	: samples(0), position(0)
+{
+}
+
+PackedReader::~PackedReader()
+{
+	Close();
+}
+
+bool PackedReader::Open(const std::string& filename)
+{
+	Close();
+	if (!file.Open(filename)) return false;
+	const NskpFileHeader* header = (const NskpFileHeader*)file.View(0, sizeof(NskpFileHeader));
+	if (header == NULL || header->magic != NSKP_FILE_MAGIC || header->version != NSKP_VERSION ||
+		header->channels != NUMBER_OF_CHANNELS || header->record_bytes != PACKED_RECORD_BYTES)
+	{
+		Close();
+		return false;
+	}
+	// A record cut short by the end of the file is not counted
+	samples = (file.Size() - sizeof(NskpFileHeader)) / PACKED_RECORD_BYTES;
+	position = 0;
+	return true;
+}
+
+void PackedReader::Close()
+{
+	file.Close();
+	samples = 0;
+	position = 0;
+}
+
+bool PackedReader::IsOpen() const
+{
+	return file.IsOpen();
+}
+
+unsigned long long PackedReader::Samples() const
+{
+	return samples;
+}
+
+unsigned long long PackedReader::Position() const
+{
+	return position;
+}
+
+bool PackedReader::Seek(unsigned long long sample)
+{
+	if (sample > samples) return false;
+	position = sample;
+	return true;
+}
+
+bool PackedReader::ReadNext(PacketRecord* record)
+{
+	if (position >= samples) return false;
+	const unsigned char* packed = (const unsigned char*)file.View(sizeof(NskpFileHeader) + position * PACKED_RECORD_BYTES, PACKED_RECORD_BYTES);
+	if (packed == NULL) return false;
+	UnpackRecord(packed, record);
+	position++;
+	return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "RecordingFile.h"
+#include "MappedFile.h"
+
+// Bit-packed recording (.nskp) layout, all fields little-endian:
+//   file header   NskpFileHeader
+//   records       one PACKED_RECORD_BYTES record per sample, so sample i starts at header + i * PACKED_RECORD_BYTES
+// Record: the 20 packet counters (uint32 each), sync word (uint16), 2 reserved bytes, then the 10-bit ADC codes of
+// all channels as PACKED_LOW_BYTES low bytes followed by one uint16 of high bits per 8 channels (channel 8g + j in
+// bits 2j..2j+1 of word g). A channel value is stored as the code equal to it, which is what the vendor decoder
+// returns; values that are not a code 0..1023 are rounded and saturated, and counted by the writer (clipped).
+// Recordings decoded with a layout whose codes do not read as themselves (PacketDecoder::IsIdentityMap) are not packed.
+const unsigned int NSKP_FILE_MAGIC = 0x504B534E;   // "NSKP"
+const unsigned int NSKP_VERSION = 2;
+
+const int PACKED_CODE_BITS = 10;
+const int PACKED_CODE_MAX = (1 << PACKED_CODE_BITS) - 1;
+const int PACKED_COUNTERS = 20;
+const int PACKED_HEADER_BYTES = 4 * PACKED_COUNTERS + 4;
+const int PACKED_LOW_BYTES = NUMBER_OF_CHANNELS;
+const int PACKED_HIGH_WORDS = NUMBER_OF_CHANNELS / 8;
+const int PACKED_RECORD_BYTES = PACKED_HEADER_BYTES + PACKED_LOW_BYTES + 2 * PACKED_HIGH_WORDS;
+
+struct NskpFileHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int channels;
+	unsigned int record_bytes;
+	unsigned int reserved[4];
+};
+
+// Pack a packet record into a PACKED_RECORD_BYTES record; returns the number of channel values that were not stored
+// exactly (not a code 0..1023)
+int PackRecord(const PacketRecord& record, unsigned char* packed);
+// Unpack a record into a packet record (host_time is left to the caller)
+void UnpackRecord(const unsigned char* packed, PacketRecord* record);
+
+// .nskp writer: packs on the producer's thread into a write-behind file
+class PackedWriter : public RecordingWriter
+{
+public:
+	PackedWriter();
+	~PackedWriter();
+
+	bool Open(const std::string& filename, const NskWriteBehindOptions& options);
+	bool Close();
+	bool IsOpen() const;
+
+	void Append(const PacketRecord* records, int n);
+
+	NskRecordingStats Stats() const;
+	NskWriteBehind WriteTelemetry() const;
+
+private:
+	WriteBehindFile file;
+	std::vector<unsigned char> packed;
+	std::atomic<unsigned long long> samples;
+	std::atomic<unsigned long long> clipped;
+};
+
+// .nskp reader on a memory mapping: fixed-size records make every sample directly addressable
+class PackedReader : public RecordingReader
+{
+public:
+	PackedReader();
+	~PackedReader();
+
+	bool Open(const std::string& filename);
+	void Close();
+	bool IsOpen() const;
+
+	unsigned long long Samples() const;
+	unsigned long long Position() const;
+	bool Seek(unsigned long long sample);
+	bool ReadNext(PacketRecord* record);
+
+private:
+	MappedFile file;
+	unsigned long long samples;
+	unsigned long long position;
+};
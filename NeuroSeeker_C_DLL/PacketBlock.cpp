@@ -0,0 +1,145 @@
+// PacketBlock.cpp : Packet-major decoding and channel-major transpose of electrode packet blocks
+
+#include <string.h>
+#include <math.h>
+#include <stddef.h>
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define NSK_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "PacketBlock.h"
+
+static_assert(sizeof(PacketRecord) % sizeof(float) == 0, "PacketRecord stride must be a whole number of floats");
+static_assert(offsetof(PacketRecord, channelData) % sizeof(float) == 0, "PacketRecord channel data must be float aligned");
+
+void TransposeBlock(const float* src, int src_stride, int n_samples, int n_channels, float* dst, int dst_stride)
+{
+	// Work through tiles of channels so that the destination rows of a tile stay cached
+	for (int c0 = 0; c0 < n_channels; c0 += TRANSPOSE_TILE_CHANNELS)
+	{
+		int c1 = std::min(c0 + TRANSPOSE_TILE_CHANNELS, n_channels);
+		int i = 0;
+#ifdef NSK_SSE2
+		for (; i + 4 <= n_samples; i += 4)
+		{
+			const float* s = src + (i * src_stride);
+			int c = c0;
+			for (; c + 4 <= c1; c += 4)
+			{
+				__m128 r0 = _mm_loadu_ps(s + c);
+				__m128 r1 = _mm_loadu_ps(s + src_stride + c);
+				__m128 r2 = _mm_loadu_ps(s + (2 * src_stride) + c);
+				__m128 r3 = _mm_loadu_ps(s + (3 * src_stride) + c);
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+				_mm_storeu_ps(dst + (c * dst_stride) + i, r0);
+				_mm_storeu_ps(dst + ((c + 1) * dst_stride) + i, r1);
+				_mm_storeu_ps(dst + ((c + 2) * dst_stride) + i, r2);
+				_mm_storeu_ps(dst + ((c + 3) * dst_stride) + i, r3);
+			}
+			for (; c < c1; c++)
+			{
+				for (int k = 0; k < 4; k++)
+				{
+					dst[(c * dst_stride) + i + k] = s[(k * src_stride) + c];
+				}
+			}
+		}
+#endif
+		for (; i < n_samples; i++)
+		{
+			const float* s = src + (i * src_stride);
+			for (int c = c0; c < c1; c++)
+			{
+				dst[(c * dst_stride) + i] = s[c];
+			}
+		}
+	}
+}
+
+// Round a channel value to the nearest ADC code (saturating, matching _mm_cvtps_epi32 + _mm_packs_epi32)
+static inline short ToAdcCode(float value)
+{
+	long code = lrintf(value);
+	if (code > 32767) code = 32767;
+	if (code < -32768) code = -32768;
+	return (short)code;
+}
+
+void TransposeBlock(const float* src, int src_stride, int n_samples, int n_channels, short* dst, int dst_stride)
+{
+	// Same tiling as the float transpose, converting each 4x4 tile to ADC codes before the store
+	for (int c0 = 0; c0 < n_channels; c0 += TRANSPOSE_TILE_CHANNELS)
+	{
+		int c1 = std::min(c0 + TRANSPOSE_TILE_CHANNELS, n_channels);
+		int i = 0;
+#ifdef NSK_SSE2
+		for (; i + 4 <= n_samples; i += 4)
+		{
+			const float* s = src + (i * src_stride);
+			int c = c0;
+			for (; c + 4 <= c1; c += 4)
+			{
+				__m128 r0 = _mm_loadu_ps(s + c);
+				__m128 r1 = _mm_loadu_ps(s + src_stride + c);
+				__m128 r2 = _mm_loadu_ps(s + (2 * src_stride) + c);
+				__m128 r3 = _mm_loadu_ps(s + (3 * src_stride) + c);
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+				__m128i p01 = _mm_packs_epi32(_mm_cvtps_epi32(r0), _mm_cvtps_epi32(r1));
+				__m128i p23 = _mm_packs_epi32(_mm_cvtps_epi32(r2), _mm_cvtps_epi32(r3));
+				_mm_storel_epi64((__m128i*)(dst + (c * dst_stride) + i), p01);
+				_mm_storel_epi64((__m128i*)(dst + ((c + 1) * dst_stride) + i), _mm_srli_si128(p01, 8));
+				_mm_storel_epi64((__m128i*)(dst + ((c + 2) * dst_stride) + i), p23);
+				_mm_storel_epi64((__m128i*)(dst + ((c + 3) * dst_stride) + i), _mm_srli_si128(p23, 8));
+			}
+			for (; c < c1; c++)
+			{
+				for (int k = 0; k < 4; k++)
+				{
+					dst[(c * dst_stride) + i + k] = ToAdcCode(s[(k * src_stride) + c]);
+				}
+			}
+		}
+#endif
+		for (; i < n_samples; i++)
+		{
+			const float* s = src + (i * src_stride);
+			for (int c = c0; c < c1; c++)
+			{
+				dst[(c * dst_stride) + i] = ToAdcCode(s[c]);
+			}
+		}
+	}
+}
+
+void CopyBlockRows(const float* src, int src_stride, int n_samples, int n_channels, float* dst, int dst_stride)
+{
+	for (int i = 0; i < n_samples; i++)
+	{
+		memcpy(dst + (i * dst_stride), src + (i * src_stride), n_channels * sizeof(float));
+	}
+}
+
+void CopyBlockRows(const float* src, int src_stride, int n_samples, int n_channels, short* dst, int dst_stride)
+{
+	for (int i = 0; i < n_samples; i++)
+	{
+		const float* s = src + (i * src_stride);
+		short* d = dst + (i * dst_stride);
+		int c = 0;
+#ifdef NSK_SSE2
+		for (; c + 8 <= n_channels; c += 8)
+		{
+			__m128i lo = _mm_cvtps_epi32(_mm_loadu_ps(s + c));
+			__m128i hi = _mm_cvtps_epi32(_mm_loadu_ps(s + c + 4));
+			_mm_storeu_si128((__m128i*)(d + c), _mm_packs_epi32(lo, hi));
+		}
+#endif
+		for (; c < n_channels; c++)
+		{
+			d[c] = ToAdcCode(s[c]);
+		}
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ElectrodePacket.h"
+#include "NeuroseekerConstants.h"
+
+// Nominal probe sample rate (packets per second), converts durations to sample counts
+const double NOMINAL_SAMPLE_RATE = 20000.0;
+
+// Number of packets decoded into the packet-major scratch block before each transpose
+// (64 packets x ~5.7 KB = 365 KB, sized to stay resident in L2)
+const int PACKET_BLOCK_SIZE = 64;
+
+// Channels per tile of the channel-major transpose
+const int TRANSPOSE_TILE_CHANNELS = 32;
+
+// Output sample layouts
+enum SampleLayout
+{
+	LAYOUT_CHANNEL_MAJOR = 0, // n_channels rows of samples (all_samp_ch0, all_samp_ch1, ...)
+	LAYOUT_SAMPLE_MAJOR  = 1  // n_samples rows of channels (interleaved frames, packet order)
+};
+
+// One decoded electrode packet: the ElectrodePacket data members (Nsk API V1.8 layout), followed by
+// the host arrival time
+struct PacketRecord
+{
+	unsigned short synchronization;
+	unsigned int counters[20];
+	float channelData[NUMBER_OF_CHANNELS];
+	long long host_time;  // monotonic host time (ns) at which the packet was read
+};
+
+// Distance (in floats) between the channel data of consecutive packet records
+const int PACKET_RECORD_STRIDE = sizeof(PacketRecord) / sizeof(float);
+
+// Transpose a packet-major block (n_samples rows of n_channels, src_stride floats apart) into
+// channel-major output (n_channels rows, dst_stride floats apart)
+void TransposeBlock(const float* src, int src_stride, int n_samples, int n_channels, float* dst, int dst_stride);
+
+// As above, rounding each value to its (10-bit) ADC code
+void TransposeBlock(const float* src, int src_stride, int n_samples, int n_channels, short* dst, int dst_stride);
+
+// Copy a packet-major block into sample-major output (n_samples rows of n_channels, dst_stride apart), no transpose
+void CopyBlockRows(const float* src, int src_stride, int n_samples, int n_channels, float* dst, int dst_stride);
+
+// As above, rounding each value to its (10-bit) ADC code
+void CopyBlockRows(const float* src, int src_stride, int n_samples, int n_channels, short* dst, int dst_stride);
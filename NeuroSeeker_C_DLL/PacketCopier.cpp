@@ -0,0 +1,69 @@
+// PacketCopier.cpp : Vendor ElectrodePacket to packet record copies
+
+#include <string.h>
+#include <stddef.h>
+
+#include "PacketCopier.h"
+
+static_assert(offsetof(PacketRecord, channelData) + sizeof(float) * NUMBER_OF_CHANNELS == sizeof(ElectrodePacket), "ElectrodePacket layout does not match Nsk API V1.8");
+
+bool VerifyPacketLayout(const ElectrodePacket& ep)
+{
+	const PacketRecord* layout = reinterpret_cast<const PacketRecord*>(&ep);
+	if (layout->synchronization != ep.getSynchronization())
+		return false;
+	for (unsigned int i = 0; i < 20; i++)
+	{
+		if (layout->counters[i] != ep.getCounter(i))
+			return false;
+	}
+	for (unsigned int c = 0; c < NUMBER_OF_CHANNELS; c++)
+	{
+		if (layout->channelData[c] != ep.getChannelData(c))
+			return false;
+	}
+	return true;
+}
+
+PacketCopier::PacketCopier()
+	: direct_access(-1)
+{
+}
+
+void PacketCopier::SetDirectAccess(bool enabled)
+{
+	direct_access = enabled ? 1 : 0;
+}
+
+void PacketCopier::Copy(const ElectrodePacket& ep, PacketRecord* record)
+{
+	if (direct_access == 1)
+	{
+		memcpy(record, &ep, sizeof(ElectrodePacket));
+		return;
+	}
+
+	record->synchronization = ep.getSynchronization();
+	for (unsigned int i = 0; i < 20; i++)
+	{
+		record->counters[i] = ep.getCounter(i);
+	}
+	for (unsigned int c = 0; c < NUMBER_OF_CHANNELS; c++)
+	{
+		record->channelData[c] = ep.getChannelData(c);
+	}
+
+	// Verify the mirrored layout on the first packet carrying data (an all-zero packet proves nothing)
+	if (direct_access == -1)
+	{
+		bool has_data = false;
+		for (unsigned int c = 0; c < NUMBER_OF_CHANNELS && !has_data; c++)
+		{
+			has_data = record->channelData[c] != 0.0f;
+		}
+		if (has_data)
+		{
+			direct_access = VerifyPacketLayout(ep) ? 1 : 0;
+		}
+	}
+}
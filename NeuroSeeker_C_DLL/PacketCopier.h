@@ -0,0 +1,24 @@
+#pragma once
+
+#include "PacketBlock.h"
+
+// Check that the mirrored layout matches the values returned by the ElectrodePacket accessors
+bool VerifyPacketLayout(const ElectrodePacket& ep);
+
+// Copies vendor packets into packet records, with one memcpy once the mirrored layout has been verified on a packet
+// carrying data (member accessors until then). Each ElectrodePacket owner (session, reader thread, export worker)
+// keeps its own copier, so sessions share no state.
+class PacketCopier
+{
+public:
+	PacketCopier();
+
+	// Enable/disable direct (memcpy) access to the ElectrodePacket data members
+	void SetDirectAccess(bool enabled);
+
+	// Copy sync word, counters and channel data of one packet into a packet record (host_time is left to the caller)
+	void Copy(const ElectrodePacket& ep, PacketRecord* record);
+
+private:
+	int direct_access;  // -1 = not yet verified, 0 = use accessors, 1 = memcpy packet members
+};
@@ -0,0 +1,454 @@
+// PacketDecoder.cpp : Vendor-independent electrode packet chain decoder
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fstream>
+#include <map>
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define NSK_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "PacketDecoder.h"
+
+// Field numbering used while compiling: sync word, 20 counters, then the channels
+const int FIELD_SYNC = 0;
+const int FIELD_COUNTER = 1;
+const int FIELD_CHANNEL = 21;
+const int FIELD_COUNT = FIELD_CHANNEL + NUMBER_OF_CHANNELS;
+
+static inline unsigned int BitMask(int width)
+{
+	return width >= 32 ? 0xFFFFFFFFu : (1u << width) - 1;
+}
+
+static inline unsigned int ByteSwap(unsigned int x)
+{
+	return (x >> 24) | ((x >> 8) & 0xFF00u) | ((x << 8) & 0xFF0000u) | (x << 24);
+}
+
+// Word and bit position of a chain bit, for little or big endian chain words
+static inline void ChainBitPosition(int chain_bit, bool big_endian, int& word, int& pos)
+{
+	int byte = chain_bit >> 3;
+	word = byte >> 2;
+	pos = (big_endian ? 3 - (byte & 3) : (byte & 3)) * 8 + (chain_bit & 7);
+}
+
+PacketDecoder::PacketDecoder()
+	: ready(false), big_endian(false), code_offset(0), code_scale(0.0f)
+{
+}
+
+PacketDecoder::~PacketDecoder()
+{
+}
+
+bool PacketDecoder::SetLayout(const PacketLayout& _layout)
+{
+	layout = _layout;
+	ready = Compile();
+	return ready;
+}
+
+bool PacketDecoder::IsReady() const
+{
+	return ready;
+}
+
+const PacketLayout& PacketDecoder::Layout() const
+{
+	return layout;
+}
+
+bool PacketDecoder::IsIdentityMap() const
+{
+	return ready && code_offset == 0 && code_scale == 1.0f;
+}
+
+unsigned int PacketDecoder::ReadField(const unsigned int* words, const std::vector<Segment>& segments)
+{
+	unsigned int value = 0;
+	for (size_t s = 0; s < segments.size(); s++)
+	{
+		const Segment& seg = segments[s];
+		value |= ((words[seg.word] >> seg.shift) & BitMask(seg.width)) << seg.field_shift;
+	}
+	return value;
+}
+
+bool PacketDecoder::BuildSegments(bool _big_endian, std::vector<std::vector<Segment> >& fields) const
+{
+	// Collect (field bit, word, position) of every field bit
+	struct FieldBit { int bit; int word; int pos; };
+	std::vector<std::vector<FieldBit> > field_bits(FIELD_COUNT);
+	for (int i = 0; i < PACKET_CHAIN_BITS; i++)
+	{
+		const ChainBit& cb = layout.bits[i];
+		int field, width;
+		switch (cb.kind)
+		{
+		case CHAIN_SYNC: field = FIELD_SYNC; width = 16; break;
+		case CHAIN_COUNTER: field = FIELD_COUNTER + cb.index; width = 32; if (cb.index < 0 || cb.index >= 20) return false; break;
+		case CHAIN_CHANNEL: field = FIELD_CHANNEL + cb.index; width = CHANNEL_CODE_BITS; if (cb.index < 0 || cb.index >= (int)NUMBER_OF_CHANNELS) return false; break;
+		default: continue;
+		}
+		if (cb.bit < 0 || cb.bit >= width) return false;
+		FieldBit fb;
+		fb.bit = cb.bit;
+		ChainBitPosition(i, _big_endian, fb.word, fb.pos);
+		field_bits[field].push_back(fb);
+	}
+
+	// Merge runs of consecutive bits into segments
+	fields.assign(FIELD_COUNT, std::vector<Segment>());
+	for (int f = 0; f < FIELD_COUNT; f++)
+	{
+		std::vector<FieldBit>& fbs = field_bits[f];
+		std::sort(fbs.begin(), fbs.end(), [](const FieldBit& a, const FieldBit& b) { return a.bit < b.bit; });
+		for (size_t k = 0; k < fbs.size(); k++)
+		{
+			if (k > 0 && fbs[k].bit == fbs[k - 1].bit) return false;
+			std::vector<Segment>& segs = fields[f];
+			if (!segs.empty())
+			{
+				Segment& last = segs.back();
+				if (last.word == fbs[k].word && last.shift + last.width == fbs[k].pos && last.field_shift + last.width == fbs[k].bit)
+				{
+					last.width++;
+					continue;
+				}
+			}
+			Segment seg = { fbs[k].word, fbs[k].pos, 1, fbs[k].bit };
+			segs.push_back(seg);
+		}
+	}
+	return true;
+}
+
+bool PacketDecoder::Compile()
+{
+	if ((int)layout.bits.size() != PACKET_CHAIN_BITS || (int)layout.code_values.size() != CHANNEL_CODES)
+		return false;
+
+	// Use the word byte order in which the fields are the fewest contiguous runs
+	std::vector<std::vector<Segment> > little, big;
+	if (!BuildSegments(false, little) || !BuildSegments(true, big))
+		return false;
+	size_t n_little = 0, n_big = 0;
+	for (int f = 0; f < FIELD_COUNT; f++)
+	{
+		n_little += little[f].size();
+		n_big += big[f].size();
+	}
+	big_endian = n_big < n_little;
+	std::vector<std::vector<Segment> >& fields = big_endian ? big : little;
+
+	// Status pairs: adjacent pairs in one word become a per-word mask, anything else is checked bit by bit
+	status_masks.assign(PACKET_CHAIN_WORDS, 0);
+	status_pairs.clear();
+	for (int i = 0; i < PACKET_CHAIN_BITS; i++)
+	{
+		const ChainBit& cb = layout.bits[i];
+		if (cb.kind != CHAIN_STATUS) continue;
+		int j = cb.index;
+		if (j < 0 || j >= PACKET_CHAIN_BITS || layout.bits[j].kind != CHAIN_STATUS || layout.bits[j].index != i || j == i)
+			return false;
+		if (j < i) continue;
+		int word_i, pos_i, word_j, pos_j;
+		ChainBitPosition(i, big_endian, word_i, pos_i);
+		ChainBitPosition(j, big_endian, word_j, pos_j);
+		if (word_i == word_j && abs(pos_i - pos_j) == 1)
+			status_masks[word_i] |= 1u << std::min(pos_i, pos_j);
+		else
+			status_pairs.push_back(std::make_pair(word_i * 32 + pos_i, word_j * 32 + pos_j));
+	}
+
+	sync_segments = fields[FIELD_SYNC];
+	for (int k = 0; k < 20; k++)
+	{
+		counter_segments[k] = fields[FIELD_COUNTER + k];
+	}
+	channel_segments.assign(fields.begin() + FIELD_CHANNEL, fields.end());
+
+	// Group channels held in a single full-width segment by shift, four at a time
+	std::map<int, std::vector<int> > by_shift;
+	scalar_channels.clear();
+	for (int c = 0; c < (int)NUMBER_OF_CHANNELS; c++)
+	{
+		const std::vector<Segment>& segs = channel_segments[c];
+		if (segs.size() == 1 && segs[0].width == CHANNEL_CODE_BITS && segs[0].field_shift == 0)
+			by_shift[segs[0].shift].push_back(c);
+		else
+			scalar_channels.push_back(c);
+	}
+	channel_groups.clear();
+	for (std::map<int, std::vector<int> >::const_iterator it = by_shift.begin(); it != by_shift.end(); ++it)
+	{
+		const std::vector<int>& channels = it->second;
+		size_t k = 0;
+		for (; k + 4 <= channels.size(); k += 4)
+		{
+			ChannelGroup group;
+			group.shift = it->first;
+			group.consecutive = true;
+			for (int l = 0; l < 4; l++)
+			{
+				group.channel[l] = channels[k + l];
+				group.word[l] = channel_segments[channels[k + l]][0].word;
+				group.consecutive = group.consecutive && group.channel[l] == group.channel[0] + l;
+			}
+			channel_groups.push_back(group);
+		}
+		scalar_channels.insert(scalar_channels.end(), channels.begin() + k, channels.end());
+	}
+
+	// Linear code to value map (bit-exact with the vendor values) lets the groups convert in vector registers:
+	// value = (code - code_offset) * code_scale, with code_offset the code that reads as zero
+	code_offset = (int)(std::find(layout.code_values.begin(), layout.code_values.end(), 0.0f) - layout.code_values.begin());
+	code_scale = code_offset + 1 < CHANNEL_CODES ? layout.code_values[code_offset + 1] : 0.0f;
+	for (int code = 0; code < CHANNEL_CODES && code_scale != 0.0f; code++)
+	{
+		float value = (float)(code - code_offset) * code_scale;
+		if (memcmp(&value, &layout.code_values[code], sizeof(float)) != 0)
+			code_scale = 0.0f;
+	}
+	return true;
+}
+
+void PacketDecoder::LoadWords(const char* chain, unsigned int* words) const
+{
+	if (!big_endian)
+	{
+		memcpy(words, chain, PACKET_CHAIN_BYTES);
+		return;
+	}
+	int w = 0;
+#ifdef NSK_SSE2
+	for (; w + 4 <= PACKET_CHAIN_WORDS; w += 4)
+	{
+		// Swap the bytes of each 16-bit half, then the halves
+		__m128i x = _mm_loadu_si128((const __m128i*)(chain + (w * 4)));
+		x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+		x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1);
+		_mm_storeu_si128((__m128i*)(words + w), x);
+	}
+#endif
+	for (; w < PACKET_CHAIN_WORDS; w++)
+	{
+		unsigned int x;
+		memcpy(&x, chain + (w * 4), sizeof(x));
+		words[w] = ByteSwap(x);
+	}
+}
+
+bool PacketDecoder::CheckStatus(const unsigned int* words) const
+{
+	// Every pair must read 01 or 10: bit p of (w ^ (w >> 1)) is set for the pair at p, p + 1
+	const unsigned int* masks = &status_masks[0];
+	int w = 0;
+#ifdef NSK_SSE2
+	for (; w + 4 <= PACKET_CHAIN_WORDS; w += 4)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(words + w));
+		__m128i m = _mm_loadu_si128((const __m128i*)(masks + w));
+		__m128i t = _mm_and_si128(_mm_xor_si128(x, _mm_srli_epi32(x, 1)), m);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(t, m)) != 0xFFFF) return false;
+	}
+#endif
+	for (; w < PACKET_CHAIN_WORDS; w++)
+	{
+		if (((words[w] ^ (words[w] >> 1)) & masks[w]) != masks[w]) return false;
+	}
+	for (size_t p = 0; p < status_pairs.size(); p++)
+	{
+		int a = status_pairs[p].first, b = status_pairs[p].second;
+		if ((((words[a >> 5] >> (a & 31)) ^ (words[b >> 5] >> (b & 31))) & 1) == 0) return false;
+	}
+	return true;
+}
+
+void PacketDecoder::DecodeHeaderWords(const unsigned int* words, PacketRecord* record) const
+{
+	record->synchronization = (unsigned short)ReadField(words, sync_segments);
+	for (int k = 0; k < 20; k++)
+	{
+		record->counters[k] = ReadField(words, counter_segments[k]);
+	}
+}
+
+void PacketDecoder::DecodeWords(const unsigned int* words, PacketRecord* record) const
+{
+	DecodeHeaderWords(words, record);
+
+	const float* code_values = &layout.code_values[0];
+	float* channel_data = record->channelData;
+	size_t g = 0;
+#ifdef NSK_SSE2
+	const __m128i code_mask = _mm_set1_epi32(CHANNEL_CODES - 1);
+	const __m128 scale = _mm_set1_ps(code_scale);
+	const __m128i offset = _mm_set1_epi32(code_offset);
+	for (; g < channel_groups.size(); g++)
+	{
+		const ChannelGroup& group = channel_groups[g];
+		__m128i x = _mm_set_epi32((int)words[group.word[3]], (int)words[group.word[2]], (int)words[group.word[1]], (int)words[group.word[0]]);
+		__m128i code = _mm_and_si128(_mm_srl_epi32(x, _mm_cvtsi32_si128(group.shift)), code_mask);
+		if (code_scale != 0.0f)
+		{
+			__m128 value = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(code, offset)), scale);
+			if (group.consecutive)
+			{
+				_mm_storeu_ps(channel_data + group.channel[0], value);
+				continue;
+			}
+			float values[4];
+			_mm_storeu_ps(values, value);
+			for (int l = 0; l < 4; l++)
+			{
+				channel_data[group.channel[l]] = values[l];
+			}
+		}
+		else {
+			int codes[4];
+			_mm_storeu_si128((__m128i*)codes, code);
+			for (int l = 0; l < 4; l++)
+			{
+				channel_data[group.channel[l]] = code_values[codes[l]];
+			}
+		}
+	}
+#endif
+	for (; g < channel_groups.size(); g++)
+	{
+		const ChannelGroup& group = channel_groups[g];
+		for (int l = 0; l < 4; l++)
+		{
+			channel_data[group.channel[l]] = code_values[(words[group.word[l]] >> group.shift) & (CHANNEL_CODES - 1)];
+		}
+	}
+	for (size_t k = 0; k < scalar_channels.size(); k++)
+	{
+		int c = scalar_channels[k];
+		channel_data[c] = code_values[ReadField(words, channel_segments[c]) & (CHANNEL_CODES - 1)];
+	}
+}
+
+ReadErrorCode PacketDecoder::Decode(const char* chain, PacketRecord* record) const
+{
+	unsigned int words[PACKET_CHAIN_WORDS];
+	LoadWords(chain, words);
+	if (!CheckStatus(words)) return DATA_ERROR;
+	DecodeWords(words, record);
+	return READ_SUCCESS;
+}
+
+ReadErrorCode PacketDecoder::DecodeHeader(const char* chain, PacketRecord* record) const
+{
+	unsigned int words[PACKET_CHAIN_WORDS];
+	LoadWords(chain, words);
+	if (!CheckStatus(words)) return DATA_ERROR;
+	DecodeHeaderWords(words, record);
+	return READ_SUCCESS;
+}
+
+int PacketDecoder::DecodeBlock(const char* chains, int n, PacketRecord* records, int* data_errors) const
+{
+	unsigned int words[PACKET_CHAIN_WORDS];
+	int n_out = 0;
+	int errors = 0;
+	for (int i = 0; i < n; i++)
+	{
+		LoadWords(chains + ((size_t)i * PACKET_CHAIN_BYTES), words);
+		if (!CheckStatus(words))
+		{
+			errors++;
+			continue;
+		}
+		DecodeWords(words, &records[n_out++]);
+	}
+	if (data_errors) *data_errors = errors;
+	return n_out;
+}
+
+bool PacketDecoder::PlanSubset(const std::vector<int>& channels, Subset& subset) const
+{
+	if (!ready) return false;
+	subset.channels = channels;
+	subset.channel_segments.resize(channels.size());
+	for (size_t k = 0; k < channels.size(); k++)
+	{
+		if (channels[k] < 0 || channels[k] >= (int)NUMBER_OF_CHANNELS) return false;
+		subset.channel_segments[k] = channel_segments[channels[k]];
+	}
+	return true;
+}
+
+ReadErrorCode PacketDecoder::DecodeSubset(const char* chain, const Subset& subset, unsigned short* codes, unsigned short* sync) const
+{
+	unsigned int words[PACKET_CHAIN_WORDS];
+	LoadWords(chain, words);
+	if (!CheckStatus(words)) return DATA_ERROR;
+	*sync = (unsigned short)ReadField(words, sync_segments);
+	for (size_t k = 0; k < subset.channel_segments.size(); k++)
+	{
+		codes[k] = (unsigned short)(ReadField(words, subset.channel_segments[k]) & (CHANNEL_CODES - 1));
+	}
+	return READ_SUCCESS;
+}
+
+bool PacketDecoder::Load(const std::string& filename)
+{
+	std::ifstream in(filename.c_str());
+	std::string magic;
+	int version, n_bits, n_codes;
+	in >> magic >> version >> n_bits;
+	if (!in || magic != "NSK_PACKET_LAYOUT" || version != 1 || n_bits != PACKET_CHAIN_BITS)
+		return false;
+
+	PacketLayout loaded;
+	loaded.bits.resize(n_bits);
+	for (int i = 0; i < n_bits; i++)
+	{
+		in >> loaded.bits[i].kind >> loaded.bits[i].index >> loaded.bits[i].bit;
+	}
+	in >> n_codes;
+	if (!in || n_codes != CHANNEL_CODES)
+		return false;
+
+	// Code values are stored as their IEEE bit patterns so the round trip is exact
+	loaded.code_values.resize(n_codes);
+	for (int c = 0; c < n_codes; c++)
+	{
+		unsigned int pattern;
+		in >> std::hex >> pattern >> std::dec;
+		memcpy(&loaded.code_values[c], &pattern, sizeof(float));
+	}
+	if (!in)
+		return false;
+	return SetLayout(loaded);
+}
+
+bool PacketDecoder::Save(const std::string& filename) const
+{
+	if (!ready) return false;
+	std::ofstream out(filename.c_str());
+	out << "NSK_PACKET_LAYOUT 1\n" << PACKET_CHAIN_BITS << "\n";
+	for (int i = 0; i < PACKET_CHAIN_BITS; i++)
+	{
+		const ChainBit& cb = layout.bits[i];
+		out << cb.kind << " " << cb.index << " " << cb.bit << "\n";
+	}
+	out << CHANNEL_CODES << "\n";
+	for (int c = 0; c < CHANNEL_CODES; c++)
+	{
+		unsigned int pattern;
+		memcpy(&pattern, &layout.code_values[c], sizeof(float));
+		char hex[16];
+		snprintf(hex, sizeof(hex), "%08x", pattern);
+		out << hex << "\n";
+	}
+	return (bool)out;
+}
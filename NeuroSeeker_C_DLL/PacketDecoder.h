@@ -0,0 +1,130 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "PacketBlock.h"
+
+// Electrode packet chain as read from the data link and stored in .nsk files (Nsk API V1.8: 501 words)
+const int PACKET_CHAIN_BYTES = ElectrodePacket::bytesize;
+const int PACKET_CHAIN_WORDS = PACKET_CHAIN_BYTES / 4;
+const int PACKET_CHAIN_BITS = PACKET_CHAIN_BYTES * 8;
+
+// Width of a channel ADC code
+const int CHANNEL_CODE_BITS = 10;
+const int CHANNEL_CODES = 1 << CHANNEL_CODE_BITS;
+
+// Packets decoded per call by the bulk readers
+const int DECODE_BLOCK_SIZE = 4096;
+
+// What one bit of the chain holds (chain bit i is bit i % 8 of byte i / 8)
+enum ChainBitKind
+{
+	CHAIN_UNUSED  = 0, // ignored by the vendor decoder
+	CHAIN_STATUS  = 1, // status bit, must differ from its partner bit (00 and 11 are DATA_ERROR)
+	CHAIN_SYNC    = 2, // bit of the synchronization word
+	CHAIN_COUNTER = 3, // bit of a packet counter
+	CHAIN_CHANNEL = 4  // bit of a channel ADC code
+};
+
+struct ChainBit
+{
+	int kind;   // ChainBitKind
+	int index;  // counter or channel number (status: chain bit of the partner)
+	int bit;    // bit of the field value
+};
+
+// Meaning of every chain bit, and the channel value of every ADC code, as learned from the vendor decoder
+struct PacketLayout
+{
+	std::vector<ChainBit> bits;      // PACKET_CHAIN_BITS entries
+	std::vector<float> code_values;  // CHANNEL_CODES entries
+};
+
+// Vendor-independent decoder of electrode packet chains, driven by a PacketLayout.
+// The layout is compiled into word/shift extractions; channel codes sharing a shift are extracted four
+// at a time, and the status bits of four words are checked at once.
+// No layout ships with the DLL. One is learned from the vendor decoder on a recording of the probe in use
+// (NSK_LearnPacketLayout, NeuroSeeker_Tools learn) and checked against it bit for bit (NSK_ValidatePacketLayout,
+// NeuroSeeker_Tools validate); both need the vendor library, so they run on Windows. The layout file is plain text
+// and can be used anywhere, and this decoder makes no vendor calls, but the tree builds only through its MSVC projects.
+class PacketDecoder
+{
+public:
+	// Bits width of chain word 'word' (from 'shift') that land at 'field_shift' of a field value
+	struct Segment
+	{
+		int word;
+		int shift;
+		int width;
+		int field_shift;
+	};
+
+	// Compiled decoding of a few channels (PlanSubset): the status bits of the whole chain are checked, but only
+	// the sync word and the codes of the selected channels are extracted
+	struct Subset
+	{
+		std::vector<int> channels;                      // probe channels, in output order
+		std::vector<std::vector<Segment> > channel_segments;
+	};
+
+	PacketDecoder();
+	~PacketDecoder();
+
+	// Use the given layout (returns false, and keeps the decoder unusable, if it is malformed)
+	bool SetLayout(const PacketLayout& layout);
+	// Read/write a layout file
+	bool Load(const std::string& filename);
+	bool Save(const std::string& filename) const;
+
+	bool IsReady() const;
+	const PacketLayout& Layout() const;
+	// True if every ADC code decodes to its own value, as with the vendor decoder (the values can be stored as codes)
+	bool IsIdentityMap() const;
+
+	// Decode one chain into a record (host_time is left to the caller): READ_SUCCESS, or DATA_ERROR on bad status bits
+	ReadErrorCode Decode(const char* chain, PacketRecord* record) const;
+	// Check the status bits and decode only the sync word and counters (channel data is left as is)
+	ReadErrorCode DecodeHeader(const char* chain, PacketRecord* record) const;
+	// Decode n consecutive chains, skipping (and counting) DATA_ERROR chains; returns the number of records written
+	int DecodeBlock(const char* chains, int n, PacketRecord* records, int* data_errors) const;
+
+	// Compile the decoding of a channel subset (false if the decoder is not ready or a channel is out of range)
+	bool PlanSubset(const std::vector<int>& channels, Subset& subset) const;
+	// Decode the ADC codes of a subset's channels (codes[k] for subset.channels[k], index into Layout().code_values)
+	// and the sync word: READ_SUCCESS, or DATA_ERROR on bad status bits
+	ReadErrorCode DecodeSubset(const char* chain, const Subset& subset, unsigned short* codes, unsigned short* sync) const;
+
+private:
+	// Four channels whose codes sit in one segment at the same shift
+	struct ChannelGroup
+	{
+		int word[4];
+		int channel[4];
+		int shift;
+		bool consecutive;
+	};
+
+	static unsigned int ReadField(const unsigned int* words, const std::vector<Segment>& segments);
+	bool Compile();
+	bool BuildSegments(bool big_endian, std::vector<std::vector<Segment> >& fields) const;
+	void LoadWords(const char* chain, unsigned int* words) const;
+	bool CheckStatus(const unsigned int* words) const;
+	void DecodeHeaderWords(const unsigned int* words, PacketRecord* record) const;
+	void DecodeWords(const unsigned int* words, PacketRecord* record) const;
+
+	PacketLayout layout;
+	bool ready;
+
+	// Compiled layout
+	bool big_endian;
+	std::vector<unsigned int> status_masks;        // per word: low bit of every adjacent status pair
+	std::vector<std::pair<int, int> > status_pairs; // other status pairs (chain bits)
+	std::vector<Segment> sync_segments;
+	std::vector<Segment> counter_segments[20];
+	std::vector<std::vector<Segment> > channel_segments;
+	std::vector<ChannelGroup> channel_groups;
+	std::vector<int> scalar_channels;
+	int code_offset;                                // code_values[c] == (c - code_offset) * code_scale for every code,
+	float code_scale;                               // or code_scale 0 (table lookup)
+};
@@ -0,0 +1,291 @@
+// PacketLayoutProbe.cpp : Learning and validating the native decoder layout against the vendor decoder
+
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <fstream>
+#include <algorithm>
+
+#include "PacketCopier.h"
+#include "PacketLayoutProbe.h"
+
+// Chains searched for a valid reference packet at the start of a file
+const int MAX_REFERENCE_CHAINS = 1024;
+
+// Decode with the vendor decoder, reading the packet through its accessors (the reference for the native layout)
+static ReadErrorCode VendorDecode(ElectrodePacket& ep, std::vector<char>& chain, PacketRecord* record)
+{
+	ReadErrorCode rec = ep.getElectrodePacketFromChain(&chain[0]);
+	if (rec == READ_SUCCESS)
+	{
+		PacketCopier copier;
+		copier.SetDirectAccess(false);
+		copier.Copy(ep, record);
+	}
+	return rec;
+}
+
+static inline void FlipBit(std::vector<char>& chain, int bit)
+{
+	chain[bit >> 3] ^= (char)(1 << (bit & 7));
+}
+
+static inline void SetBit(std::vector<char>& chain, int bit, int value)
+{
+	if (((chain[bit >> 3] >> (bit & 7)) & 1) != value) FlipBit(chain, bit);
+}
+
+// Index of the only set bit, or -1 if none or several bits are set
+static int SingleBit(unsigned int x)
+{
+	if (x == 0 || (x & (x - 1)) != 0) return -1;
+	int bit = 0;
+	while ((x >> bit) != 1) bit++;
+	return bit;
+}
+
+static bool SameRecord(const PacketRecord& a, const PacketRecord& b)
+{
+	return a.synchronization == b.synchronization &&
+		memcmp(a.counters, b.counters, sizeof(a.counters)) == 0 &&
+		memcmp(a.channelData, b.channelData, sizeof(a.channelData)) == 0;
+}
+
+static std::string Describe(const char* what, int bit)
+{
+	char text[128];
+	snprintf(text, sizeof(text), "%s (chain bit %d)", what, bit);
+	return text;
+}
+
+bool LearnPacketLayout(const char* chain, PacketLayout& layout, std::string& error)
+{
+	ElectrodePacket ep;
+	std::vector<char> work(chain, chain + PACKET_CHAIN_BYTES);
+	PacketRecord base, probe;
+	if (VendorDecode(ep, work, &base) != READ_SUCCESS)
+	{
+		error = "reference chain is not a valid packet";
+		return false;
+	}
+
+	// Flip every chain bit in turn and see which field (if any) the vendor decoder reports differently
+	ChainBit unused = { CHAIN_UNUSED, 0, 0 };
+	layout.bits.assign(PACKET_CHAIN_BITS, unused);
+	std::vector<std::vector<std::pair<float, int> > > channel_bits(NUMBER_OF_CHANNELS);
+	for (int i = 0; i < PACKET_CHAIN_BITS; i++)
+	{
+		FlipBit(work, i);
+		ReadErrorCode rec = VendorDecode(ep, work, &probe);
+		FlipBit(work, i);
+		if (rec == DATA_ERROR)
+		{
+			ChainBit status = { CHAIN_STATUS, -1, 0 };
+			layout.bits[i] = status;
+			continue;
+		}
+		if (rec != READ_SUCCESS)
+		{
+			error = Describe("vendor decoder failed", i);
+			return false;
+		}
+
+		int changes = 0;
+		unsigned int sync = probe.synchronization ^ base.synchronization;
+		if (sync)
+		{
+			ChainBit cb = { CHAIN_SYNC, 0, SingleBit(sync) };
+			layout.bits[i] = cb;
+			changes++;
+		}
+		for (int k = 0; k < 20; k++)
+		{
+			unsigned int counter = probe.counters[k] ^ base.counters[k];
+			if (counter)
+			{
+				ChainBit cb = { CHAIN_COUNTER, k, SingleBit(counter) };
+				layout.bits[i] = cb;
+				changes++;
+			}
+		}
+		for (int c = 0; c < (int)NUMBER_OF_CHANNELS; c++)
+		{
+			if (memcmp(&probe.channelData[c], &base.channelData[c], sizeof(float)) != 0)
+			{
+				ChainBit cb = { CHAIN_CHANNEL, c, 0 };
+				layout.bits[i] = cb;
+				channel_bits[c].push_back(std::make_pair(fabsf(probe.channelData[c] - base.channelData[c]), i));
+				changes++;
+			}
+		}
+		if (changes > 1 || layout.bits[i].bit < 0)
+		{
+			error = Describe("chain bit maps to more than one field bit", i);
+			return false;
+		}
+	}
+
+	// Order each channel's chain bits by weight: the smallest change is code bit 0
+	int reference_channel = -1;
+	for (int c = 0; c < (int)NUMBER_OF_CHANNELS; c++)
+	{
+		std::vector<std::pair<float, int> >& bits = channel_bits[c];
+		std::sort(bits.begin(), bits.end());
+		if ((int)bits.size() > CHANNEL_CODE_BITS)
+		{
+			error = Describe("channel has more chain bits than an ADC code", bits[0].second);
+			return false;
+		}
+		for (size_t k = 0; k < bits.size(); k++)
+		{
+			if (k > 0 && bits[k].first == bits[k - 1].first)
+			{
+				error = Describe("two chain bits of a channel have the same weight", bits[k].second);
+				return false;
+			}
+			layout.bits[bits[k].second].bit = (int)k;
+		}
+		if (reference_channel < 0 && (int)bits.size() == CHANNEL_CODE_BITS)
+			reference_channel = c;
+	}
+	if (reference_channel < 0)
+	{
+		error = "no channel carries a full ADC code";
+		return false;
+	}
+
+	// Pair the status bits: flipping both bits of a valid pair (01 <-> 10) is accepted again
+	for (int i = 0; i < PACKET_CHAIN_BITS; i++)
+	{
+		if (layout.bits[i].kind != CHAIN_STATUS || layout.bits[i].index >= 0) continue;
+		int partner = -1;
+		for (int pass = 0; pass < 2 && partner < 0; pass++)
+		{
+			// Same word first, then anywhere in the chain
+			int first = pass == 0 ? (i / 32) * 32 : 0;
+			int last = pass == 0 ? first + 32 : PACKET_CHAIN_BITS;
+			for (int j = first; j < last && partner < 0; j++)
+			{
+				if (j == i || layout.bits[j].kind != CHAIN_STATUS || layout.bits[j].index >= 0) continue;
+				FlipBit(work, i);
+				FlipBit(work, j);
+				if (VendorDecode(ep, work, &probe) == READ_SUCCESS && SameRecord(probe, base))
+					partner = j;
+				FlipBit(work, i);
+				FlipBit(work, j);
+			}
+		}
+		if (partner < 0)
+		{
+			error = Describe("status bit has no partner", i);
+			return false;
+		}
+		layout.bits[i].index = partner;
+		layout.bits[partner].index = i;
+	}
+
+	// Channel value of every ADC code, through the reference channel
+	std::vector<int> code_bits(CHANNEL_CODE_BITS);
+	for (size_t k = 0; k < channel_bits[reference_channel].size(); k++)
+	{
+		code_bits[k] = channel_bits[reference_channel][k].second;
+	}
+	layout.code_values.resize(CHANNEL_CODES);
+	std::vector<char> coded(work);
+	for (int code = 0; code < CHANNEL_CODES; code++)
+	{
+		for (int k = 0; k < CHANNEL_CODE_BITS; k++)
+		{
+			SetBit(coded, code_bits[k], (code >> k) & 1);
+		}
+		if (VendorDecode(ep, coded, &probe) != READ_SUCCESS)
+		{
+			error = Describe("vendor decoder rejected a channel code", code_bits[0]);
+			return false;
+		}
+		layout.code_values[code] = probe.channelData[reference_channel];
+	}
+
+	// Confirm on randomized chains (valid status pairs, random everything else) and on one invalid pair
+	PacketDecoder decoder;
+	if (!decoder.SetLayout(layout))
+	{
+		error = "learned layout is inconsistent";
+		return false;
+	}
+	unsigned int state = 0x9E3779B9u;
+	PacketRecord native;
+	for (int t = 0; t < LAYOUT_VERIFY_PACKETS; t++)
+	{
+		std::vector<char> random(work);
+		for (int i = 0; i < PACKET_CHAIN_BITS; i++)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			const ChainBit& cb = layout.bits[i];
+			if (cb.kind != CHAIN_STATUS)
+				SetBit(random, i, state & 1);
+			else if (cb.index > i)
+			{
+				SetBit(random, i, state & 1);
+				SetBit(random, cb.index, (state & 1) ^ 1);
+			}
+		}
+		if (t == LAYOUT_VERIFY_PACKETS - 1)
+		{
+			// Break one pair (00 or 11)
+			for (int i = 0; i < PACKET_CHAIN_BITS; i++)
+			{
+				if (layout.bits[i].kind == CHAIN_STATUS)
+				{
+					FlipBit(random, i);
+					break;
+				}
+			}
+		}
+		ReadErrorCode vendor_rec = VendorDecode(ep, random, &probe);
+		ReadErrorCode native_rec = decoder.Decode(&random[0], &native);
+		if (vendor_rec != native_rec || (vendor_rec == READ_SUCCESS && !SameRecord(probe, native)))
+		{
+			char text[128];
+			snprintf(text, sizeof(text), "native decoder differs from the vendor decoder on randomized chain %d", t);
+			error = text;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ValidatePacketDecoder(const PacketDecoder& decoder, const std::string& filename, unsigned long long& packets, unsigned long long& mismatches)
+{
+	packets = mismatches = 0;
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	if (!in || !decoder.IsReady()) return false;
+
+	ElectrodePacket ep;
+	std::vector<char> chain(PACKET_CHAIN_BYTES);
+	PacketRecord vendor, native;
+	while (in.read(&chain[0], PACKET_CHAIN_BYTES))
+	{
+		ReadErrorCode vendor_rec = VendorDecode(ep, chain, &vendor);
+		ReadErrorCode native_rec = decoder.Decode(&chain[0], &native);
+		if (vendor_rec != native_rec || (vendor_rec == READ_SUCCESS && !SameRecord(vendor, native)))
+			mismatches++;
+		packets++;
+	}
+	return true;
+}
+
+bool ReadReferenceChain(const std::string& filename, std::vector<char>& chain)
+{
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	ElectrodePacket ep;
+	chain.resize(PACKET_CHAIN_BYTES);
+	for (int n = 0; n < MAX_REFERENCE_CHAINS && in.read(&chain[0], PACKET_CHAIN_BYTES); n++)
+	{
+		if (ep.getElectrodePacketFromChain(&chain[0]) == READ_SUCCESS)
+			return true;
+	}
+	return false;
+}
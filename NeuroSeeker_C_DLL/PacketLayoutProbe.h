@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+#include "PacketDecoder.h"
+
+// Randomized chains decoded by both decoders to confirm a learned layout
+const int LAYOUT_VERIFY_PACKETS = 4096;
+
+// Learn the chain layout by decoding single-bit variations of a valid chain with the vendor decoder
+// (ElectrodePacket::getElectrodePacketFromChain), then confirm it on randomized chains
+bool LearnPacketLayout(const char* chain, PacketLayout& layout, std::string& error);
+
+// Decode every chain of a .nsk file with both decoders, counting the packets on which they disagree
+bool ValidatePacketDecoder(const PacketDecoder& decoder, const std::string& filename, unsigned long long& packets, unsigned long long& mismatches);
+
+// Read the first chain of a .nsk file that the vendor decoder accepts
+bool ReadReferenceChain(const std::string& filename, std::vector<char>& chain);
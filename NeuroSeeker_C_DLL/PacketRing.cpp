@@ -0,0 +1,106 @@
+// PacketRing.cpp : Lock-free SPSC ring of decoded electrode packets
+
+#include <chrono>
+
+#include "PacketRing.h"
+
+// Round the capacity up to a power of two so slot indices stay continuous when the counters wrap
+static int RingCapacity(int requested)
+{
+	int capacity = 1;
+	if (requested <= 0) requested = DEFAULT_RING_CAPACITY;
+	while (capacity < requested) capacity <<= 1;
+	return capacity;
+}
+
+PacketRing::PacketRing(int capacity)
+	: slots(RingCapacity(capacity)),
+	  capacity(RingCapacity(capacity)),
+	  head(0), tail(0), high_water(0), overruns(0), consumer_waiting(false)
+{
+}
+
+PacketRing::~PacketRing()
+{
+}
+
+PacketRecord* PacketRing::BeginWrite()
+{
+	unsigned int h = head.load(std::memory_order_relaxed);
+	unsigned int t = tail.load(std::memory_order_acquire);
+	if ((int)(h - t) >= capacity)
+		return NULL;
+	return &slots[h & (capacity - 1)];
+}
+
+void PacketRing::CommitWrite()
+{
+	// Sequentially consistent publish, paired with the consumer_waiting flag in WaitForData
+	unsigned int h = head.load(std::memory_order_relaxed) + 1;
+	head.store(h, std::memory_order_seq_cst);
+
+	// Track the deepest fill level seen by the producer
+	int fill = (int)(h - tail.load(std::memory_order_relaxed));
+	if (fill > high_water.load(std::memory_order_relaxed))
+		high_water.store(fill, std::memory_order_relaxed);
+
+	if (consumer_waiting.load(std::memory_order_seq_cst))
+		NotifyConsumer();
+}
+
+void PacketRing::RecordOverrun()
+{
+	overruns.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PacketRing::NotifyConsumer()
+{
+	// Take the lock so the wakeup cannot fall between the consumer's check and its wait
+	{
+		std::lock_guard<std::mutex> lock(wait_mutex);
+	}
+	data_ready.notify_one();
+}
+
+int PacketRing::Available() const
+{
+	return (int)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed));
+}
+
+int PacketRing::Peek(const PacketRecord** first) const
+{
+	unsigned int t = tail.load(std::memory_order_relaxed);
+	int available = (int)(head.load(std::memory_order_acquire) - t);
+	int index = t & (capacity - 1);
+	*first = &slots[index];
+	return available < capacity - index ? available : capacity - index;
+}
+
+void PacketRing::Consume(int count)
+{
+	tail.store(tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
+
+bool PacketRing::WaitForData(int timeout_ms)
+{
+	std::unique_lock<std::mutex> lock(wait_mutex);
+	consumer_waiting.store(true, std::memory_order_seq_cst);
+	bool ready = data_ready.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return Available() > 0; });
+	consumer_waiting.store(false, std::memory_order_relaxed);
+	return ready;
+}
+
+int PacketRing::Capacity() const
+{
+	return capacity;
+}
+
+int PacketRing::HighWaterMark() const
+{
+	return high_water.load(std::memory_order_relaxed);
+}
+
+unsigned long long PacketRing::Overruns() const
+{
+	return overruns.load(std::memory_order_relaxed);
+}
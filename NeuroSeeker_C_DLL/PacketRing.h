@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "PacketBlock.h"
+
+// Default ring capacity in packets (~24 MB, rounded up to a power of two)
+const int DEFAULT_RING_CAPACITY = 4096;
+
+// Lock-free single-producer/single-consumer ring of decoded electrode packets.
+// The producer (acquisition thread) fills slots in place, the consumer (NSK_Read) reads
+// contiguous runs of slots and releases them. Blocking is only used to put an idle consumer to sleep.
+class PacketRing
+{
+public:
+	PacketRing(int capacity);
+	~PacketRing();
+
+	// Producer: slot to fill next, or NULL when the ring is full
+	PacketRecord* BeginWrite();
+	// Producer: publish the slot returned by BeginWrite
+	void CommitWrite();
+	// Producer: count a packet dropped because the ring was full
+	void RecordOverrun();
+	// Producer: wake the consumer (e.g. when acquisition stops)
+	void NotifyConsumer();
+
+	// Consumer: number of packets ready to be read
+	int Available() const;
+	// Consumer: first readable slot and the number of contiguous slots from it (up to the wrap point)
+	int Peek(const PacketRecord** first) const;
+	// Consumer: release count slots back to the producer
+	void Consume(int count);
+	// Consumer: wait until data is available or the timeout expires
+	bool WaitForData(int timeout_ms);
+
+	int Capacity() const;
+	int HighWaterMark() const;
+	unsigned long long Overruns() const;
+
+private:
+	std::vector<PacketRecord> slots;
+	int capacity;
+
+	// Monotonic write/read counters (wrap-around safe), kept on separate cache lines
+	std::atomic<unsigned int> head;
+	char pad_head[64];
+	std::atomic<unsigned int> tail;
+	char pad_tail[64];
+
+	std::atomic<int> high_water;
+	std::atomic<unsigned long long> overruns;
+
+	std::atomic<bool> consumer_waiting;
+	std::mutex wait_mutex;
+	std::condition_variable data_ready;
+};
@@ -0,0 +1,104 @@
+// PacketStats.cpp : Packet-loss and counter-gap accounting
+
+#include <string.h>
+
+#include "PacketStats.h"
+
+PacketStats::PacketStats()
+	: data_errors(0), link_timeouts(0), counter_step(1)
+{
+	Reset();
+}
+
+PacketStats::~PacketStats()
+{
+}
+
+void PacketStats::Reset()
+{
+	memset(&totals, 0, sizeof(totals));
+	data_errors = 0;
+	link_timeouts = 0;
+	block_gaps.clear();
+	last_counter = 0;
+	has_last = false;
+}
+
+void PacketStats::Resync()
+{
+	has_last = false;
+}
+
+void PacketStats::SetCounterStep(unsigned int step)
+{
+	counter_step = step > 0 ? step : 1;
+}
+
+unsigned int PacketStats::CounterStep() const
+{
+	return counter_step;
+}
+
+void PacketStats::BeginBlock()
+{
+	block_gaps.clear();
+}
+
+void PacketStats::Track(const PacketRecord* records, int n, int offset)
+{
+	for (int i = 0; i < n; i++)
+	{
+		unsigned int counter = records[i].counters[0];
+		if (has_last)
+		{
+			// Unsigned difference handles counter wrap-around
+			unsigned int expected = last_counter + counter_step;
+			unsigned int delta = counter - last_counter;
+			if (delta != counter_step)
+			{
+				NskGap gap = { offset + i, expected, counter, 0 };
+				if (delta == 0)
+				{
+					totals.duplicates++;
+				}
+				else if ((int)delta < 0)
+				{
+					totals.resets++;
+					gap.lost = -1;
+				}
+				else {
+					gap.lost = (int)(delta / counter_step) - 1;
+					totals.gaps++;
+					totals.lost += gap.lost;
+				}
+				block_gaps.push_back(gap);
+			}
+		}
+		last_counter = counter;
+		has_last = true;
+	}
+	totals.packets += n;
+}
+
+void PacketStats::RecordDataError()
+{
+	data_errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PacketStats::RecordLinkTimeout()
+{
+	link_timeouts.fetch_add(1, std::memory_order_relaxed);
+}
+
+NskPacketStats PacketStats::Totals() const
+{
+	NskPacketStats result = totals;
+	result.data_errors = data_errors.load(std::memory_order_relaxed);
+	result.link_timeouts = link_timeouts.load(std::memory_order_relaxed);
+	return result;
+}
+
+const std::vector<NskGap>& PacketStats::BlockGaps() const
+{
+	return block_gaps;
+}
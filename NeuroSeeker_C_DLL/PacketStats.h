@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "PacketBlock.h"
+
+// Consecutive DATA_ERROR packets after which a read is treated as failed (stream is not recovering)
+const int MAX_CONSECUTIVE_DATA_ERRORS = 1024;
+
+// Cumulative packet accounting since the stream was opened
+struct NskPacketStats
+{
+	unsigned long long packets;      // packets delivered to the consumer
+	unsigned long long gaps;         // counter jumps larger than one step
+	unsigned long long lost;         // packets missing inside those gaps
+	unsigned long long duplicates;   // packets repeating the previous counter
+	unsigned long long resets;       // counter jumps backwards (stream restart)
+	unsigned long long data_errors;  // packets rejected by the decoder with DATA_ERROR
+	unsigned long long link_timeouts; // live reads that timed out on the data link (READ_LINK_ERROR) and were retried
+};
+
+// Counter discontinuity found in the last block read
+struct NskGap
+{
+	int sample;              // sample index (in the block) of the first packet after the gap
+	unsigned int expected;   // counter value that was expected
+	unsigned int counter;    // counter value that was received
+	int lost;                // missing packets (0 for a duplicate, -1 for a backwards jump)
+};
+
+// Counter continuity tracking on the packet counter (counter 0) of every delivered packet
+class PacketStats
+{
+public:
+	PacketStats();
+	~PacketStats();
+
+	// Forget all counts (new stream)
+	void Reset();
+	// Forget the previous counter but keep the counts (the stream was moved, e.g. by a file seek)
+	void Resync();
+	// Expected counter increment between consecutive packets
+	void SetCounterStep(unsigned int step);
+	unsigned int CounterStep() const;
+
+	// Consumer: start a new block (clears the block gap list)
+	void BeginBlock();
+	// Consumer: check continuity of n records delivered at sample offset in the current block
+	void Track(const PacketRecord* records, int n, int offset);
+	// Producer (any thread): count a packet rejected with DATA_ERROR
+	void RecordDataError();
+	// Producer (any thread): count a data link read that timed out
+	void RecordLinkTimeout();
+
+	NskPacketStats Totals() const;
+	const std::vector<NskGap>& BlockGaps() const;
+
+private:
+	NskPacketStats totals;
+	std::atomic<unsigned long long> data_errors;
+	std::atomic<unsigned long long> link_timeouts;
+	std::vector<NskGap> block_gaps;
+	unsigned int counter_step;
+	unsigned int last_counter;
+	bool has_last;
+};
@@ -0,0 +1,128 @@
+// PlaybackPacer.cpp : Real-time (or scaled) pacing of file playback against the host clock
+
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <mmsystem.h>
+#endif
+
+#include "PlaybackPacer.h"
+#include "PacketBlock.h"
+#include "ClockModel.h"
+
+PlaybackPacer::PlaybackPacer()
+	: ns_per_sample(0.0), anchored(false), anchor_time(0), scheduled(0), high_resolution(false)
+{
+	memset(&pacing, 0, sizeof(pacing));
+	pacing.sample_rate = NOMINAL_SAMPLE_RATE;
+}
+
+PlaybackPacer::~PlaybackPacer()
+{
+	SetTimerResolution(false);
+}
+
+void PlaybackPacer::SetSpeed(double speed, double sample_rate)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pacing.speed = speed > 0.0 ? speed : 0.0;
+	pacing.sample_rate = sample_rate > 0.0 ? sample_rate : NOMINAL_SAMPLE_RATE;
+	ns_per_sample = pacing.speed > 0.0 ? 1e9 / (pacing.sample_rate * pacing.speed) : 0.0;
+	anchored = false;
+	SetTimerResolution(pacing.speed > 0.0);
+}
+
+bool PlaybackPacer::IsEnabled() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pacing.speed > 0.0;
+}
+
+void PlaybackPacer::Reset()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	double speed = pacing.speed, sample_rate = pacing.sample_rate;
+	memset(&pacing, 0, sizeof(pacing));
+	pacing.speed = speed;
+	pacing.sample_rate = sample_rate;
+	anchored = false;
+}
+
+void PlaybackPacer::Resync()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (anchored) pacing.resyncs++;
+	anchored = false;
+}
+
+void PlaybackPacer::Release(int n)
+{
+	long long now = HostTimeNs();
+	long long due;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (pacing.speed <= 0.0 || n <= 0) return;
+		if (!anchored)
+		{
+			// The first block is due one block duration after it was read
+			anchor_time = now;
+			scheduled = 0;
+			anchored = true;
+		}
+		scheduled += n;
+		due = anchor_time + (long long)(scheduled * ns_per_sample);
+		pacing.samples += n;
+		pacing.blocks++;
+		pacing.lag_ns = now > due ? now - due : 0;
+		if (pacing.lag_ns > 0)
+		{
+			pacing.late_blocks++;
+			if (pacing.lag_ns > pacing.max_lag_ns) pacing.max_lag_ns = pacing.lag_ns;
+			if (pacing.lag_ns > PACING_RESYNC_NS)
+			{
+				// Too far behind (stalled consumer or disk): start over rather than releasing a burst
+				anchor_time = now;
+				scheduled = 0;
+				pacing.resyncs++;
+			}
+			return;
+		}
+	}
+
+	// Sleep most of the way, then yield up to the deadline
+	long long wait_start = now;
+	while (now < due)
+	{
+		long long remaining = due - now;
+		if (remaining > PACING_SPIN_NS)
+			std::this_thread::sleep_for(std::chrono::nanoseconds(remaining - PACING_SPIN_NS));
+		else
+			std::this_thread::yield();
+		now = HostTimeNs();
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	pacing.wait_ns += now - wait_start;
+}
+
+NskPlaybackPacing PlaybackPacer::Telemetry() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pacing;
+}
+
+void PlaybackPacer::SetTimerResolution(bool high)
+{
+	if (high == high_resolution) return;
+#ifdef _WIN32
+	// Sleep granularity is one system timer tick (15.6 ms by default), too coarse for blocks of a few ms
+	if (high)
+		timeBeginPeriod(1);
+	else
+		timeEndPeriod(1);
+#endif
+	high_resolution = high;
+}
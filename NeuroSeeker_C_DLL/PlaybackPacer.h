@@ -0,0 +1,57 @@
+#pragma once
+
+#include <mutex>
+
+// Time before a block is due at which the pacer stops sleeping and yields until the deadline
+const long long PACING_SPIN_NS = 2000000;
+// Lag behind schedule after which the schedule restarts from the current block (instead of bursting to catch up)
+const long long PACING_RESYNC_NS = 1000000000;
+
+// Paced playback telemetry
+struct NskPlaybackPacing
+{
+	double speed;                     // playback speed (1: real time, 0: unpaced)
+	double sample_rate;               // recording sample rate the schedule is based on (Hz)
+	unsigned long long samples;       // samples released on schedule since the file was opened
+	unsigned long long blocks;
+	unsigned long long late_blocks;   // blocks that were read and decoded after they were due
+	long long lag_ns;                 // how far the last block was behind schedule (0 when on time)
+	long long max_lag_ns;
+	unsigned long long wait_ns;       // total time spent waiting for blocks to become due
+	unsigned int resyncs;             // schedule restarts (lag over PACING_RESYNC_NS, seeks)
+};
+
+// Releases file playback blocks against the host clock: the block ending at sample s since the schedule
+// started is due s / (sample_rate * speed) seconds after the first block. Reading and decoding happen
+// before the wait, so they are part of the schedule rather than added to it.
+class PlaybackPacer
+{
+public:
+	PlaybackPacer();
+	~PlaybackPacer();
+
+	// Pace at speed times the sample rate (speed <= 0: unpaced, sample_rate <= 0: NOMINAL_SAMPLE_RATE)
+	void SetSpeed(double speed, double sample_rate);
+	bool IsEnabled() const;
+
+	// Forget the schedule and telemetry (new file)
+	void Reset();
+	// Restart the schedule at the next block, e.g. after a seek
+	void Resync();
+
+	// Wait until the block of n samples just read is due
+	void Release(int n);
+
+	NskPlaybackPacing Telemetry() const;
+
+private:
+	void SetTimerResolution(bool high);
+
+	mutable std::mutex mutex;
+	NskPlaybackPacing pacing;
+	double ns_per_sample;
+	bool anchored;
+	long long anchor_time;
+	unsigned long long scheduled;     // samples released since anchor_time
+	bool high_resolution;
+};
@@ -0,0 +1,95 @@
+// RawRecording.cpp : Decoding reader of raw .nsk recordings, for whole-file tools working on packet records
+
+#include <string.h>
+
+#include "RawRecording.h"
+#include "PacketStats.h"
+
+RawReader::RawReader(const PacketDecoder* _decoder)
+	: link(NULL), decoder(_decoder), has_previous(false), data_errors(0)
+{
+}
+
+RawReader::~RawReader()
+{
+	Close();
+}
+
+bool RawReader::Open(const std::string& filename)
+{
+	return Open(std::vector<std::string>(1, filename), std::vector<unsigned long long>());
+}
+
+bool RawReader::Open(const std::vector<std::string>& segment_files, const std::vector<unsigned long long>& first_samples)
+{
+	Close();
+	link = new NeuroseekerDataLinkMapped(segment_files, first_samples);
+	if (!link->IsOpen())
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void RawReader::Close()
+{
+	delete link;
+	link = NULL;
+	has_previous = false;
+	data_errors = 0;
+}
+
+bool RawReader::IsOpen() const
+{
+	return link != NULL;
+}
+
+unsigned long long RawReader::Samples() const
+{
+	return link ? link->Packets() : 0;
+}
+
+unsigned long long RawReader::Position() const
+{
+	return link ? link->Position() : 0;
+}
+
+bool RawReader::Seek(unsigned long long sample)
+{
+	if (link == NULL || sample > link->Packets()) return false;
+
+	// Find the last valid packet before the new position, to stand in for DATA_ERROR packets right after it
+	has_previous = false;
+	for (int i = 1; i <= MAX_CONSECUTIVE_DATA_ERRORS && (unsigned long long)i <= sample && !has_previous; i++)
+	{
+		link->Seek(sample - i);
+		const char* chain = link->NextChain();
+		has_previous = chain != NULL && decoder.Decode(chain, &previous) == READ_SUCCESS;
+	}
+	return link->Seek(sample);
+}
+
+bool RawReader::ReadNext(PacketRecord* record)
+{
+	if (link == NULL) return false;
+	const char* chain = link->NextChain();
+	if (chain == NULL) return false;
+	if (decoder.Decode(chain, record) != READ_SUCCESS)
+	{
+		data_errors++;
+		if (has_previous)
+			*record = previous;
+		else
+			memset(record, 0, sizeof(PacketRecord));
+		return true;
+	}
+	previous = *record;
+	has_previous = true;
+	return true;
+}
+
+unsigned long long RawReader::DataErrors() const
+{
+	return data_errors;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "RecordingFile.h"
+#include "MappedFile.h"
+#include "FileExport.h"
+
+// Raw (.nsk) recording, or the segments of a raw manifest, read as packet records: chains are decoded on the
+// caller's thread from the memory mapping, so several readers of one file can work in parallel. DATA_ERROR
+// packets are returned as a copy of the previous valid packet, keeping the sample count intact.
+class RawReader : public RecordingReader
+{
+public:
+	// Native decoder when one is given (shared, read-only), the vendor decoder otherwise
+	RawReader(const PacketDecoder* decoder);
+	~RawReader();
+
+	bool Open(const std::string& filename);
+	// Segments of a raw manifest, placed at their listed first samples (see NeuroseekerDataLinkMapped)
+	bool Open(const std::vector<std::string>& segment_files, const std::vector<unsigned long long>& first_samples);
+	void Close();
+	bool IsOpen() const;
+
+	unsigned long long Samples() const;
+	unsigned long long Position() const;
+	bool Seek(unsigned long long sample);
+	bool ReadNext(PacketRecord* record);
+
+	// Packets replaced by the previous valid packet
+	unsigned long long DataErrors() const;
+
+private:
+	NeuroseekerDataLinkMapped* link;
+	ChainDecoder decoder;
+	PacketRecord previous;
+	bool has_previous;
+	unsigned long long data_errors;
+};
@@ -0,0 +1,252 @@
+// RecordingAPI.cpp : Raw stream recording through a write-behind thread instead of inside the data link read
+
+#include <stdio.h>
+#include <algorithm>
+
+#include "RecordingAPI.h"
+#include "PacketDecoder.h"
+
+NeuroseekerDataLinkRecorder::NeuroseekerDataLinkRecorder(NeuroseekerDataLinkIntf* _link)
+	: link(_link), record_file(NULL), prepared(NULL), prepare_failed(false), options(DefaultWriteBehindOptions()), recording(false), segmented(false),
+	segment(0), segment_limit(0), segment_bytes(0), recorded_bytes(0)
+{
+	closed_telemetry = NskWriteBehind();
+}
+
+NeuroseekerDataLinkRecorder::~NeuroseekerDataLinkRecorder()
+{
+	StopRecording();
+}
+
+bool NeuroseekerDataLinkRecorder::readn(char* buffer, size_t size)
+{
+	if (!link->readn(buffer, size)) return false;
+	if (recording) Record(buffer, size);
+	return true;
+}
+
+bool NeuroseekerDataLinkRecorder::writen(char* buffer, size_t size)
+{
+	return link->writen(buffer, size);
+}
+
+void NeuroseekerDataLinkRecorder::flushTxFifo()
+{
+	link->flushTxFifo();
+}
+
+NeuroseekerDataLinkIntf* NeuroseekerDataLinkRecorder::Link() const
+{
+	return link;
+}
+
+bool NeuroseekerDataLinkRecorder::StartRecording(const std::string& filename, const NskWriteBehindOptions& _options, const NskSegmentOptions& segmentation)
+{
+	StopRecording();
+	options = _options;
+	segmented = IsSegmented(segmentation);
+	segment_limit = SegmentSampleLimit(segmentation, RECORDING_RAW) * PACKET_CHAIN_BYTES;
+	segment_bytes = 0;
+	recorded_bytes = 0;
+	closed_telemetry = NskWriteBehind();
+	prepare_failed = false;
+	if (segmented && !segments.Open(filename, RECORDING_RAW)) return false;
+
+	segment = 0;
+	std::string path = segmented ? segments.SegmentPath(segment) : filename;
+	WriteBehindFile* file = new WriteBehindFile();
+	if (!file->Open(path, options))
+	{
+		delete file;
+		if (segmented) segments.Close();
+		return false;
+	}
+	if (segmented)
+	{
+		segments.AddSegment(path, 0);
+		segments.Post([this] { PrepareSegment(1); });
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		record_file = file;
+	}
+	recording = true;
+	return true;
+}
+
+bool NeuroseekerDataLinkRecorder::StopRecording()
+{
+	if (!recording) return true;
+	recording = false;
+	WriteBehindFile* file;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		file = record_file;
+		record_file = NULL;
+	}
+	bool closed = file->Close();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		AccumulateWriteBehind(closed_telemetry, file->Telemetry());
+	}
+	delete file;
+	if (!segmented) return closed;
+	segments.Retire(segment, [closed] { return closed; }, segment_bytes / PACKET_CHAIN_BYTES);
+	bool finished = segments.Close();
+
+	// The segment opened for a rotation that did not come is not part of the recording
+	WriteBehindFile* unused = prepared.exchange(NULL);
+	if (unused)
+	{
+		unused->Close();
+		delete unused;
+		remove(segments.SegmentPath(segment + 1).c_str());
+	}
+	return finished;
+}
+
+bool NeuroseekerDataLinkRecorder::IsRecording() const
+{
+	return recording;
+}
+
+NskWriteBehind NeuroseekerDataLinkRecorder::Telemetry() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	NskWriteBehind telemetry = closed_telemetry;
+	if (record_file)
+	{
+		NskWriteBehind current = record_file->Telemetry();
+		telemetry.queue_buffers = current.queue_buffers;
+		telemetry.queue_depth = current.queue_depth;
+		AccumulateWriteBehind(telemetry, current);
+	}
+	return telemetry;
+}
+
+void NeuroseekerDataLinkRecorder::Record(const char* buffer, size_t size)
+{
+	// Segments end on a chain boundary, a read spanning it is split between two segments. Past the limit (the next
+	// segment is not open yet) every chain boundary is a chance to rotate.
+	while (size > 0)
+	{
+		size_t n = size;
+		if (segment_limit > 0)
+		{
+			unsigned long long end = std::max(segment_limit, (segment_bytes / PACKET_CHAIN_BYTES + 1) * PACKET_CHAIN_BYTES);
+			n = (size_t)std::min<unsigned long long>(size, end - segment_bytes);
+		}
+		record_file->Write(buffer, n);
+		segment_bytes += n;
+		buffer += n;
+		size -= n;
+		if (segment_limit > 0 && segment_bytes >= segment_limit && segment_bytes % PACKET_CHAIN_BYTES == 0) Rotate();
+	}
+}
+
+void NeuroseekerDataLinkRecorder::PrepareSegment(int index)
+{
+	WriteBehindFile* file = new WriteBehindFile();
+	if (file->Open(segments.SegmentPath(index), options))
+	{
+		prepared = file;
+		return;
+	}
+	delete file;
+	prepare_failed = true;
+}
+
+void NeuroseekerDataLinkRecorder::Rotate()
+{
+	// Swap in the segment opened ahead of time, or keep writing the current one until it is ready
+	WriteBehindFile* next = prepared.exchange(NULL);
+	if (next == NULL)
+	{
+		// The next segment cannot be created: keep recording into the current one rather than lose data
+		if (prepare_failed) segment_limit = 0;
+		return;
+	}
+	int previous_segment = segment;
+	unsigned long long previous_packets = segment_bytes / PACKET_CHAIN_BYTES;
+	recorded_bytes += segment_bytes;
+	segment_bytes = 0;
+	segment++;
+
+	WriteBehindFile* previous;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		previous = record_file;
+		record_file = next;
+	}
+	segments.Retire(previous_segment, [this, previous]
+	{
+		bool closed = previous->Close();
+		NskWriteBehind telemetry = previous->Telemetry();
+		delete previous;
+		std::lock_guard<std::mutex> lock(mutex);
+		AccumulateWriteBehind(closed_telemetry, telemetry);
+		return closed;
+	}, previous_packets);
+	// List the new segment, then open the one after it
+	int current = segment;
+	unsigned long long first_sample = recorded_bytes / PACKET_CHAIN_BYTES;
+	segments.Post([this, current, first_sample]
+	{
+		segments.AddSegment(segments.SegmentPath(current), first_sample);
+		PrepareSegment(current + 1);
+	});
+}
+
+NeuroseekerRecordingAPI::NeuroseekerRecordingAPI()
+	: recorder(NULL)
+{
+}
+
+NeuroseekerRecordingAPI::~NeuroseekerRecordingAPI()
+{
+	// The base destructor closes the vendor link itself
+	if (recorder != NULL)
+	{
+		tcpDataLink_ = recorder->Link();
+		delete recorder;
+		recorder = NULL;
+	}
+}
+
+bool NeuroseekerRecordingAPI::StartStreamRecording(const std::string& filename, const NskWriteBehindOptions& options, const NskSegmentOptions& segmentation)
+{
+	return recorder != NULL && recorder->StartRecording(filename, options, segmentation);
+}
+
+bool NeuroseekerRecordingAPI::StopStreamRecording()
+{
+	return recorder == NULL || recorder->StopRecording();
+}
+
+NskWriteBehind NeuroseekerRecordingAPI::StreamRecordingTelemetry() const
+{
+	return recorder ? recorder->Telemetry() : NskWriteBehind();
+}
+
+ErrorCode NeuroseekerRecordingAPI::setupDataLink()
+{
+	ErrorCode ec = NeuroseekerAPI::setupDataLink();
+	if (ec == SUCCESS && tcpDataLink_ != NULL)
+	{
+		// Every packet read by the API goes through the recorder
+		recorder = new NeuroseekerDataLinkRecorder(tcpDataLink_);
+		tcpDataLink_ = recorder;
+	}
+	return ec;
+}
+
+void NeuroseekerRecordingAPI::closeDataLink()
+{
+	if (recorder != NULL)
+	{
+		tcpDataLink_ = recorder->Link();
+		delete recorder;
+		recorder = NULL;
+	}
+	NeuroseekerAPI::closeDataLink();
+}
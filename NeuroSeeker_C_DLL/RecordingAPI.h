@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "NeuroseekerAPI.h"
+#include "NeuroseekerDataLinkIntf.h"
+#include "WriteBehindFile.h"
+#include "SegmentedRecording.h"
+
+// Data link wrapped around the probe's TCP data link: every chunk read is passed on unchanged and, while
+// recording, copied to a write-behind file, so the read never waits on the disk
+class NeuroseekerDataLinkRecorder : public NeuroseekerDataLinkIntf
+{
+public:
+	NeuroseekerDataLinkRecorder(NeuroseekerDataLinkIntf* link);
+	~NeuroseekerDataLinkRecorder();
+
+	bool readn(char* buffer, size_t size);
+	bool writen(char* buffer, size_t size);
+	void flushTxFifo();
+
+	NeuroseekerDataLinkIntf* Link() const;
+
+	// Record the raw stream (the same bytes as the vendor recording) to filename, or to rotating segments of
+	// whole packet chains listed in a manifest
+	bool StartRecording(const std::string& filename, const NskWriteBehindOptions& options, const NskSegmentOptions& segmentation);
+	bool StopRecording();
+	bool IsRecording() const;
+	NskWriteBehind Telemetry() const;
+
+private:
+	void Record(const char* buffer, size_t size);
+	// Segment thread: open the next segment ahead of its rotation
+	void PrepareSegment(int index);
+	void Rotate();
+
+	NeuroseekerDataLinkIntf* link;
+	WriteBehindFile* record_file;            // current file (segment)
+	std::atomic<WriteBehindFile*> prepared;  // next segment once it is open
+	std::atomic<bool> prepare_failed;        // the next segment could not be created
+	NskWriteBehindOptions options;
+	bool recording;
+
+	bool segmented;
+	SegmentManifestWriter segments;
+	int segment;                             // manifest index of the current segment
+	unsigned long long segment_limit;        // bytes per segment, whole chains (0: no rotation)
+	unsigned long long segment_bytes;        // bytes in the current segment
+	unsigned long long recorded_bytes;       // bytes in the closed segments
+	NskWriteBehind closed_telemetry;
+	mutable std::mutex mutex;                // file swap and closed totals
+};
+
+// NeuroseekerAPI with the vendor stream recording (written inside the data link read) replaced by a
+// write-behind recording of the same raw stream
+class NeuroseekerRecordingAPI : public NeuroseekerAPI
+{
+public:
+	NeuroseekerRecordingAPI();
+	~NeuroseekerRecordingAPI();
+
+	// Start or stop the raw (.nsk) stream recording (false if no data link is open)
+	bool StartStreamRecording(const std::string& filename, const NskWriteBehindOptions& options, const NskSegmentOptions& segmentation);
+	bool StopStreamRecording();
+	NskWriteBehind StreamRecordingTelemetry() const;
+
+protected:
+	ErrorCode setupDataLink();
+	void closeDataLink();
+
+private:
+	NeuroseekerDataLinkRecorder* recorder;
+};
@@ -0,0 +1,78 @@
+// RecordingFile.cpp : Selection of the recording writers and readers by format
+
+#include <fstream>
+
+#include "RecordingFile.h"
+#include "CompressedRecording.h"
+#include "PackedRecording.h"
+#include "SegmentedRecording.h"
+#include "RawRecording.h"
+
+RecordingWriter* CreateRecordingWriter(int format, int threads)
+{
+	switch (format)
+	{
+	case RECORDING_COMPRESSED: return new CompressedWriter(threads);
+	case RECORDING_PACKED: return new PackedWriter();
+	default: return NULL;
+	}
+}
+
+RecordingReader* CreateRecordingReader(int format)
+{
+	switch (format)
+	{
+	case RECORDING_COMPRESSED: return new CompressedReader();
+	case RECORDING_PACKED: return new PackedReader();
+	default: return NULL;
+	}
+}
+
+int RecordingFileFormat(const std::string& filename)
+{
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	unsigned int magic = 0;
+	if (!file.read((char*)&magic, sizeof(magic))) return RECORDING_RAW;
+	if (magic == NSKZ_FILE_MAGIC) return RECORDING_COMPRESSED;
+	if (magic == NSKP_FILE_MAGIC) return RECORDING_PACKED;
+	return RECORDING_RAW;
+}
+
+RecordingReader* OpenRecordingReader(const std::string& filename, const PacketDecoder* decoder)
+{
+	RecordingReader* reader = NULL;
+	if (IsManifestFile(filename))
+	{
+		RecordingManifest manifest;
+		if (!ReadManifest(filename, manifest)) return NULL;
+		if (manifest.format == RECORDING_RAW)
+		{
+			std::vector<std::string> segment_files;
+			std::vector<unsigned long long> first_samples;
+			for (size_t i = 0; i < manifest.segments.size(); i++)
+			{
+				segment_files.push_back(ManifestSegmentPath(filename, manifest.segments[i].file));
+				first_samples.push_back(manifest.segments[i].first_sample);
+			}
+			RawReader* raw = new RawReader(decoder);
+			if (!raw->Open(segment_files, first_samples))
+			{
+				delete raw;
+				return NULL;
+			}
+			return raw;
+		}
+		reader = new SegmentedReader();
+	}
+	else
+	{
+		int format = RecordingFileFormat(filename);
+		reader = format == RECORDING_RAW ? new RawReader(decoder) : CreateRecordingReader(format);
+	}
+	if (!reader->Open(filename))
+	{
+		delete reader;
+		return NULL;
+	}
+	return reader;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+
+#include "PacketBlock.h"
+#include "WriteBehindFile.h"
+
+// Stream recording formats (NSK_SetRecordingFormat)
+enum RecordingFormat
+{
+	RECORDING_RAW        = 0, // vendor recording of the raw packet chains (.nsk)
+	RECORDING_COMPRESSED = 1, // lossless compressed recording (.nskz)
+	RECORDING_PACKED     = 2  // bit-packed 10-bit ADC codes, fixed record size (.nskp)
+};
+
+// Writer telemetry, as returned by NSK_GetRecordingStats
+struct NskRecordingStats
+{
+	unsigned long long samples;        // samples appended
+	unsigned long long bytes_in;       // size of the same samples as raw chains
+	unsigned long long bytes_out;      // bytes written
+	unsigned long long stalls;         // appends that waited for the encoder or the disk
+	unsigned long long clipped;        // channel values rounded or saturated to fit the format (packed: 10-bit codes)
+};
+
+// Recording written from packet records (the DLL's own formats, the vendor format is written by the API)
+class RecordingWriter
+{
+public:
+	virtual ~RecordingWriter() {}
+
+	// Create the file, written behind the producer with the given settings
+	virtual bool Open(const std::string& filename, const NskWriteBehindOptions& options) = 0;
+	// Flush buffered samples and close the file
+	virtual bool Close() = 0;
+	virtual bool IsOpen() const = 0;
+
+	// Producer: append n packet records (values are stored as ADC codes)
+	virtual void Append(const PacketRecord* records, int n) = 0;
+
+	virtual NskRecordingStats Stats() const = 0;
+	virtual NskWriteBehind WriteTelemetry() const = 0;
+};
+
+// Seekable playback of a recording in one of the DLL's own formats
+class RecordingReader
+{
+public:
+	virtual ~RecordingReader() {}
+
+	virtual bool Open(const std::string& filename) = 0;
+	virtual void Close() = 0;
+	virtual bool IsOpen() const = 0;
+
+	virtual unsigned long long Samples() const = 0;
+	// Sample index of the next ReadNext
+	virtual unsigned long long Position() const = 0;
+	virtual bool Seek(unsigned long long sample) = 0;
+	// Decode the next sample into a packet record (false at the end of the recording or on corrupt data)
+	virtual bool ReadNext(PacketRecord* record) = 0;
+};
+
+// New (unopened) writer of a format (NULL for RECORDING_RAW, which the vendor API writes), encoding on threads
+// threads for the formats that encode in parallel (threads <= 0: all cores)
+RecordingWriter* CreateRecordingWriter(int format, int threads = 0);
+
+// New (unopened) reader of a format (NULL for RECORDING_RAW, which is played back through a data link)
+RecordingReader* CreateRecordingReader(int format);
+
+// Format of a recording file, from its magic (RECORDING_RAW for anything else)
+int RecordingFileFormat(const std::string& filename);
+
+class PacketDecoder;
+
+// Open any recording (raw .nsk, the DLL's own formats, or a segment manifest) as packet records, for whole-file
+// tools; raw chains are decoded with the native decoder when one is given (NULL if the file cannot be read)
+RecordingReader* OpenRecordingReader(const std::string& filename, const PacketDecoder* decoder);
@@ -0,0 +1,380 @@
+// RecordingPyramid.cpp : Min/max/mean overview pyramids of recordings, built in parallel, for fast zoomed-out views
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "RecordingPyramid.h"
+#include "RecordingFile.h"
+#include "FileExport.h"
+
+static_assert(sizeof(NskPyramidBin) == 8, "Unexpected pyramid bin packing");
+static_assert(sizeof(NskvFileHeader) == 32, "Unexpected .nskv header packing");
+static_assert(sizeof(NskvLevel) == 24, "Unexpected .nskv level packing");
+
+static const size_t PYRAMID_ROW_BYTES = NUMBER_OF_CHANNELS * sizeof(NskPyramidBin);
+
+std::string PyramidFileName(const std::string& recording_file)
+{
+	return recording_file + NSKV_EXTENSION;
+}
+
+// Samples in a bin of spb samples (the last bin of a recording or work item can be short)
+static unsigned long long BinSamples(unsigned long long bin, unsigned long long spb, unsigned long long samples)
+{
+	unsigned long long first = bin * spb;
+	return first >= samples ? 0 : std::min(spb, samples - first);
+}
+
+// Merge two rows of bins holding na and nb samples (nb 0: copy a)
+static void CombineRows(const NskPyramidBin* a, unsigned long long na, const NskPyramidBin* b, unsigned long long nb, NskPyramidBin* out)
+{
+	if (nb == 0)
+	{
+		memcpy(out, a, PYRAMID_ROW_BYTES);
+		return;
+	}
+	float wa = (float)((double)na / (na + nb));
+	float wb = 1.0f - wa;
+	for (int c = 0; c < (int)NUMBER_OF_CHANNELS; c++)
+	{
+		out[c].min = std::min(a[c].min, b[c].min);
+		out[c].max = std::max(a[c].max, b[c].max);
+		out[c].mean = a[c].mean * wa + b[c].mean * wb;
+	}
+}
+
+// Shared state of the pyramid workers
+struct PyramidJob
+{
+	PyramidJob() : next_chunk(0), failed(false) {}
+
+	std::string recording_file;
+	const PacketDecoder* decoder;
+	unsigned long long samples;
+	int chunk_levels;
+	unsigned long long chunk_samples;
+	unsigned long long chunks;
+	std::vector<NskvLevel> levels;
+	ExportFile out;
+	std::vector<NskPyramidBin> top;   // the single level chunk_levels bin row of every work item
+
+	std::atomic<unsigned long long> next_chunk;
+	std::atomic<bool> failed;
+	std::mutex error_mutex;
+	std::string error;
+
+	void Fail(const std::string& message)
+	{
+		std::lock_guard<std::mutex> lock(error_mutex);
+		if (!failed) error = message;
+		failed = true;
+	}
+
+	bool WriteRows(int level, unsigned long long bin, const NskPyramidBin* rows, unsigned long long n)
+	{
+		return out.Write(levels[level].offset + bin * PYRAMID_ROW_BYTES, rows, (size_t)(n * PYRAMID_ROW_BYTES));
+	}
+};
+
+static void PyramidWorker(PyramidJob* job)
+{
+	RecordingReader* reader = OpenRecordingReader(job->recording_file, job->decoder);
+	if (reader == NULL)
+	{
+		job->Fail("cannot open " + job->recording_file);
+		return;
+	}
+	PacketRecord record;
+	std::vector<float> lo(NUMBER_OF_CHANNELS), hi(NUMBER_OF_CHANNELS), sum(NUMBER_OF_CHANNELS);
+	std::vector<std::vector<NskPyramidBin> > rows(job->chunk_levels + 1);
+	for (int level = 0; level <= job->chunk_levels; level++)
+		rows[level].resize(((size_t)1 << (job->chunk_levels - level)) * NUMBER_OF_CHANNELS);
+
+	while (!job->failed)
+	{
+		unsigned long long chunk = job->next_chunk++;
+		if (chunk >= job->chunks) break;
+		unsigned long long start = chunk * job->chunk_samples;
+		unsigned long long n = std::min(job->chunk_samples, job->samples - start);
+		if (!reader->Seek(start))
+		{
+			job->Fail("cannot seek " + job->recording_file);
+			break;
+		}
+
+		// Level 0: scan the samples of each bin
+		unsigned long long bins = (n + PYRAMID_BASE_SAMPLES - 1) / PYRAMID_BASE_SAMPLES;
+		for (unsigned long long b = 0; b < bins && !job->failed; b++)
+		{
+			unsigned long long m = BinSamples(b, PYRAMID_BASE_SAMPLES, n);
+			std::fill(lo.begin(), lo.end(), 1e9f);
+			std::fill(hi.begin(), hi.end(), -1e9f);
+			std::fill(sum.begin(), sum.end(), 0.0f);
+			for (unsigned long long i = 0; i < m; i++)
+			{
+				if (!reader->ReadNext(&record))
+				{
+					job->Fail("cannot read " + job->recording_file);
+					break;
+				}
+				const float* values = record.channelData;
+				for (int c = 0; c < (int)NUMBER_OF_CHANNELS; c++)
+				{
+					lo[c] = std::min(lo[c], values[c]);
+					hi[c] = std::max(hi[c], values[c]);
+					sum[c] += values[c];
+				}
+			}
+			NskPyramidBin* row = &rows[0][(size_t)b * NUMBER_OF_CHANNELS];
+			for (int c = 0; c < (int)NUMBER_OF_CHANNELS; c++)
+			{
+				row[c].min = (short)lrintf(lo[c]);
+				row[c].max = (short)lrintf(hi[c]);
+				row[c].mean = sum[c] / m;
+			}
+		}
+		if (job->failed) break;
+
+		// Levels 1..chunk_levels: merge pairs of bins of the level below
+		for (int level = 1; level <= job->chunk_levels; level++)
+		{
+			unsigned long long below = PYRAMID_BASE_SAMPLES << (level - 1);
+			unsigned long long level_bins = (n + 2 * below - 1) / (2 * below);
+			for (unsigned long long b = 0; b < level_bins; b++)
+			{
+				CombineRows(&rows[level - 1][(size_t)(2 * b) * NUMBER_OF_CHANNELS], BinSamples(2 * b, below, n),
+					&rows[level - 1][(size_t)(2 * b + 1) * NUMBER_OF_CHANNELS], BinSamples(2 * b + 1, below, n),
+					&rows[level][(size_t)b * NUMBER_OF_CHANNELS]);
+			}
+		}
+
+		// Every level of the work item is one contiguous range of rows
+		bool written = true;
+		for (int level = 0; level <= job->chunk_levels && written; level++)
+		{
+			unsigned long long spb = PYRAMID_BASE_SAMPLES << level;
+			unsigned long long first = chunk << (job->chunk_levels - level);
+			written = job->WriteRows(level, first, &rows[level][0], (n + spb - 1) / spb);
+		}
+		if (!written)
+		{
+			job->Fail("write error");
+			break;
+		}
+		memcpy(&job->top[(size_t)chunk * NUMBER_OF_CHANNELS], &rows[job->chunk_levels][0], PYRAMID_ROW_BYTES);
+	}
+	delete reader;
+}
+
+bool BuildPyramid(const std::string& recording_file, const std::string& pyramid_file, const PacketDecoder* decoder, int threads,
+	NskPyramidResult& result, std::string& error)
+{
+	memset(&result, 0, sizeof(result));
+	error.clear();
+	RecordingReader* reader = OpenRecordingReader(recording_file, decoder);
+	if (reader == NULL)
+	{
+		error = "cannot open " + recording_file;
+		return false;
+	}
+	PyramidJob job;
+	job.recording_file = recording_file;
+	job.decoder = decoder;
+	job.samples = reader->Samples();
+	delete reader;
+	if (job.samples == 0)
+	{
+		error = "empty recording";
+		return false;
+	}
+
+	// Levels down to a single bin, laid out after the header and level table
+	unsigned long long offset = sizeof(NskvFileHeader);
+	for (unsigned long long spb = PYRAMID_BASE_SAMPLES; ; spb *= 2)
+	{
+		NskvLevel level;
+		level.bins = (job.samples + spb - 1) / spb;
+		level.samples_per_bin = spb;
+		job.levels.push_back(level);
+		if (level.bins == 1) break;
+	}
+	offset += job.levels.size() * sizeof(NskvLevel);
+	for (size_t l = 0; l < job.levels.size(); l++)
+	{
+		job.levels[l].offset = offset;
+		offset += job.levels[l].bins * PYRAMID_ROW_BYTES;
+	}
+	job.chunk_levels = std::min(PYRAMID_CHUNK_LEVELS, (int)job.levels.size() - 1);
+	job.chunk_samples = (unsigned long long)PYRAMID_BASE_SAMPLES << job.chunk_levels;
+	job.chunks = (job.samples + job.chunk_samples - 1) / job.chunk_samples;
+	job.top.resize((size_t)job.chunks * NUMBER_OF_CHANNELS);
+	if (!job.out.Create(pyramid_file, offset))
+	{
+		error = "cannot create " + pyramid_file;
+		return false;
+	}
+
+	int n_threads = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+	if (n_threads < 1) n_threads = 1;
+	if ((unsigned long long)n_threads > job.chunks) n_threads = (int)job.chunks;
+	std::vector<std::thread> workers;
+	for (int t = 0; t < n_threads; t++) workers.push_back(std::thread(PyramidWorker, &job));
+	for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+
+	// Levels above the work items, from one bin row per work item
+	std::vector<NskPyramidBin> below(job.top), above;
+	for (size_t l = job.chunk_levels + 1; l < job.levels.size() && !job.failed; l++)
+	{
+		unsigned long long spb = job.levels[l - 1].samples_per_bin;
+		above.resize((size_t)job.levels[l].bins * NUMBER_OF_CHANNELS);
+		for (unsigned long long b = 0; b < job.levels[l].bins; b++)
+		{
+			CombineRows(&below[(size_t)(2 * b) * NUMBER_OF_CHANNELS], BinSamples(2 * b, spb, job.samples),
+				2 * b + 1 < job.levels[l - 1].bins ? &below[(size_t)(2 * b + 1) * NUMBER_OF_CHANNELS] : NULL, BinSamples(2 * b + 1, spb, job.samples),
+				&above[(size_t)b * NUMBER_OF_CHANNELS]);
+		}
+		if (!job.WriteRows((int)l, 0, &above[0], job.levels[l].bins)) job.Fail("write error");
+		below.swap(above);
+	}
+
+	// Header last: an interrupted build leaves a file without a valid magic
+	if (!job.failed)
+	{
+		NskvFileHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = NSKV_FILE_MAGIC;
+		header.version = NSKV_VERSION;
+		header.channels = NUMBER_OF_CHANNELS;
+		header.base_samples = PYRAMID_BASE_SAMPLES;
+		header.levels = (unsigned int)job.levels.size();
+		header.samples = job.samples;
+		if (!job.out.Write(sizeof(header), &job.levels[0], job.levels.size() * sizeof(NskvLevel)) || !job.out.Write(0, &header, sizeof(header)))
+			job.Fail("write error");
+	}
+	job.out.Close();
+	if (job.failed)
+	{
+		error = job.error;
+		return false;
+	}
+	result.samples = job.samples;
+	result.levels = job.levels.size();
+	result.bytes = offset;
+	return true;
+}
+
+PyramidReader::PyramidReader()
+{
+	memset(&header, 0, sizeof(header));
+}
+
+PyramidReader::~PyramidReader()
+{
+	Close();
+}
+
+bool PyramidReader::Open(const std::string& filename)
+{
+	Close();
+	if (!file.Open(filename)) return false;
+	const NskvFileHeader* view = (const NskvFileHeader*)file.View(0, sizeof(NskvFileHeader));
+	if (view == NULL || view->magic != NSKV_FILE_MAGIC || view->version != NSKV_VERSION || view->channels != NUMBER_OF_CHANNELS ||
+		view->levels == 0 || view->levels > 64)
+	{
+		Close();
+		return false;
+	}
+	header = *view;
+	const NskvLevel* table = (const NskvLevel*)file.View(sizeof(NskvFileHeader), header.levels * sizeof(NskvLevel));
+	if (table == NULL)
+	{
+		Close();
+		return false;
+	}
+	levels.assign(table, table + header.levels);
+	for (size_t l = 0; l < levels.size(); l++)
+	{
+		if (levels[l].samples_per_bin == 0 || levels[l].offset + levels[l].bins * PYRAMID_ROW_BYTES > file.Size())
+		{
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void PyramidReader::Close()
+{
+	file.Close();
+	memset(&header, 0, sizeof(header));
+	levels.clear();
+}
+
+bool PyramidReader::IsOpen() const
+{
+	return !levels.empty();
+}
+
+unsigned long long PyramidReader::Samples() const
+{
+	return header.samples;
+}
+
+int PyramidReader::Levels() const
+{
+	return (int)levels.size();
+}
+
+unsigned long long PyramidReader::SamplesPerBin(int level) const
+{
+	return level >= 0 && level < (int)levels.size() ? levels[level].samples_per_bin : 0;
+}
+
+int PyramidReader::SelectLevel(unsigned long long start, unsigned long long end, int columns) const
+{
+	if (levels.empty() || end <= start || columns <= 0) return -1;
+	unsigned long long per_column = (end - start) / columns;
+	int level = 0;
+	while (level + 1 < (int)levels.size() && levels[level + 1].samples_per_bin <= per_column) level++;
+	return level;
+}
+
+int PyramidReader::Query(unsigned long long start, unsigned long long end, int columns, NskPyramidBin* bins)
+{
+	if (end > header.samples) return -1;
+	int level = SelectLevel(start, end, columns);
+	if (level < 0) return -1;
+	unsigned long long spb = levels[level].samples_per_bin;
+	unsigned long long span = end - start;
+	for (int column = 0; column < columns; column++)
+	{
+		// Bins overlapping the column (at least one, when there are more columns than samples)
+		unsigned long long first = start + span * column / columns;
+		unsigned long long last = std::max(start + span * (column + 1) / columns, first + 1);
+		unsigned long long b0 = first / spb;
+		unsigned long long b1 = std::min((last + spb - 1) / spb, levels[level].bins);
+		NskPyramidBin* out = bins + (size_t)column * NUMBER_OF_CHANNELS;
+		unsigned long long samples = 0;
+		for (unsigned long long b = b0; b < b1; b++)
+		{
+			const NskPyramidBin* row = Row(level, b);
+			if (row == NULL) return -1;
+			unsigned long long n = BinSamples(b, spb, header.samples);
+			if (samples == 0)
+				memcpy(out, row, PYRAMID_ROW_BYTES);
+			else
+				CombineRows(out, samples, row, n, out);
+			samples += n;
+		}
+	}
+	return level;
+}
+
+const NskPyramidBin* PyramidReader::Row(int level, unsigned long long bin)
+{
+	return (const NskPyramidBin*)file.View(levels[level].offset + bin * PYRAMID_ROW_BYTES, PYRAMID_ROW_BYTES);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "PacketBlock.h"
+#include "MappedFile.h"
+
+class PacketDecoder;
+
+// Overview pyramid sidecar (<recording>.nskv, next to the recording or manifest), all fields little-endian:
+//   file header   NskvFileHeader
+//   level table   NskvLevel per level
+//   bins          per level, one row of channels NskPyramidBin per bin (bin-major)
+// Level 0 bins summarise PYRAMID_BASE_SAMPLES samples, every next level twice as many; the last level has one bin.
+const unsigned int NSKV_FILE_MAGIC = 0x564B534E;   // "NSKV"
+const unsigned int NSKV_VERSION = 1;
+const char* const NSKV_EXTENSION = ".nskv";
+
+// Samples per level 0 bin (12.8 ms at 20 kHz; views finer than this read the recording itself)
+const int PYRAMID_BASE_SAMPLES = 256;
+// Levels built from each work item of the builder (a work item covers 2^PYRAMID_CHUNK_LEVELS level 0 bins)
+const int PYRAMID_CHUNK_LEVELS = 6;
+
+// Summary of the ADC codes of one channel over a bin
+struct NskPyramidBin
+{
+	short min;
+	short max;
+	float mean;
+};
+
+struct NskvFileHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int channels;
+	unsigned int base_samples;
+	unsigned int levels;
+	unsigned int reserved;
+	unsigned long long samples;
+};
+
+struct NskvLevel
+{
+	unsigned long long offset;          // file offset of the first bin
+	unsigned long long bins;
+	unsigned long long samples_per_bin;
+};
+
+struct NskPyramidResult
+{
+	unsigned long long samples;         // samples summarised
+	unsigned long long levels;
+	unsigned long long bytes;           // size of the sidecar
+};
+
+// Sidecar file of a recording
+std::string PyramidFileName(const std::string& recording_file);
+
+// Build the pyramid of any playable recording (raw, compressed, packed or a manifest) on threads threads (0 for all
+// cores); raw chains are decoded with the native decoder when one is given
+bool BuildPyramid(const std::string& recording_file, const std::string& pyramid_file, const PacketDecoder* decoder, int threads,
+	NskPyramidResult& result, std::string& error);
+
+// Pyramid queries on a memory-mapped sidecar
+class PyramidReader
+{
+public:
+	PyramidReader();
+	~PyramidReader();
+
+	bool Open(const std::string& filename);
+	void Close();
+	bool IsOpen() const;
+
+	unsigned long long Samples() const;
+	int Levels() const;
+	unsigned long long SamplesPerBin(int level) const;
+
+	// Level for columns columns over [start, end): the coarsest with at least one bin per column
+	int SelectLevel(unsigned long long start, unsigned long long end, int columns) const;
+	// Summarise [start, end) in columns equal columns, column-major (bins[column * channels + channel]); returns the
+	// level used, -1 for an empty or out of range span
+	int Query(unsigned long long start, unsigned long long end, int columns, NskPyramidBin* bins);
+
+private:
+	const NskPyramidBin* Row(int level, unsigned long long bin);
+
+	MappedFile file;
+	NskvFileHeader header;
+	std::vector<NskvLevel> levels;
+};
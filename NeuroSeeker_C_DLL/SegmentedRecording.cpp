@@ -0,0 +1,573 @@
+// SegmentedRecording.cpp : Rotating recordings split into segment files, and playback of their manifest
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#include "SegmentedRecording.h"
+#include "PacketDecoder.h"
+#include "PackedRecording.h"
+
+static const char* FormatExtension(int format)
+{
+	switch (format)
+	{
+	case RECORDING_COMPRESSED: return ".nskz";
+	case RECORDING_PACKED: return ".nskp";
+	default: return ".nsk";
+	}
+}
+
+static std::string Directory(const std::string& path)
+{
+	size_t separator = path.find_last_of("/\\");
+	return separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+}
+
+NskSegmentOptions DefaultSegmentOptions()
+{
+	NskSegmentOptions options;
+	options.segment_seconds = 0;
+	options.segment_mb = 0;
+	return options;
+}
+
+bool IsSegmented(const NskSegmentOptions& options)
+{
+	return options.segment_seconds > 0 || options.segment_mb > 0;
+}
+
+unsigned long long SegmentSampleLimit(const NskSegmentOptions& options, int format)
+{
+	unsigned long long limit = 0;
+	if (options.segment_seconds > 0) limit = (unsigned long long)(options.segment_seconds * NOMINAL_SAMPLE_RATE);
+	unsigned long long record_bytes = format == RECORDING_RAW ? PACKET_CHAIN_BYTES : format == RECORDING_PACKED ? PACKED_RECORD_BYTES : 0;
+	if (options.segment_mb > 0 && record_bytes > 0)
+	{
+		unsigned long long by_size = std::max<unsigned long long>(((unsigned long long)options.segment_mb << 20) / record_bytes, 1);
+		limit = limit > 0 ? std::min(limit, by_size) : by_size;
+	}
+	return limit;
+}
+
+unsigned long long SegmentByteLimit(const NskSegmentOptions& options, int format)
+{
+	return format == RECORDING_COMPRESSED && options.segment_mb > 0 ? (unsigned long long)options.segment_mb << 20 : 0;
+}
+
+static size_t ExtensionStart(const std::string& path)
+{
+	size_t name_at = path.find_last_of("/\\");
+	name_at = name_at == std::string::npos ? 0 : name_at + 1;
+	size_t extension_at = path.find_last_of('.');
+	return extension_at == std::string::npos || extension_at < name_at ? path.size() : extension_at;
+}
+
+std::string ManifestFileName(const std::string& stream_file)
+{
+	return stream_file.substr(0, ExtensionStart(stream_file)) + NSKM_EXTENSION;
+}
+
+bool IsManifestFile(const std::string& filename)
+{
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	char tag[4];
+	return file.read(tag, sizeof(tag)) && std::string(tag, sizeof(tag)) == NSKM_FILE_TAG;
+}
+
+bool ReadManifest(const std::string& filename, RecordingManifest& manifest)
+{
+	std::ifstream file(filename.c_str());
+	std::string line;
+	if (!std::getline(file, line)) return false;
+	std::istringstream header(line);
+	std::string tag;
+	int version = 0;
+	if (!(header >> tag >> version >> manifest.format) || tag != NSKM_FILE_TAG || version > NSKM_VERSION) return false;
+
+	// Segment lines end with two numbers; everything before them is the file name
+	manifest.segments.clear();
+	while (std::getline(file, line))
+	{
+		line.erase(line.find_last_not_of(" \t\r") + 1);
+		if (line.empty()) continue;
+		size_t samples_at = line.find_last_of(' ');
+		if (samples_at == std::string::npos || samples_at == 0) return false;
+		size_t first_at = line.find_last_of(' ', samples_at - 1);
+		if (first_at == std::string::npos || first_at == 0) return false;
+		ManifestSegment segment;
+		segment.file = line.substr(0, first_at);
+		segment.first_sample = strtoull(line.c_str() + first_at + 1, NULL, 10);
+		segment.samples = strtoull(line.c_str() + samples_at + 1, NULL, 10);
+		manifest.segments.push_back(segment);
+	}
+	return true;
+}
+
+bool WriteManifest(const std::string& filename, const RecordingManifest& manifest)
+{
+	std::string temporary = filename + ".tmp";
+	{
+		std::ofstream file(temporary.c_str(), std::ios::trunc);
+		file << NSKM_FILE_TAG << " " << NSKM_VERSION << " " << manifest.format << "\n";
+		for (size_t i = 0; i < manifest.segments.size(); i++)
+		{
+			const ManifestSegment& segment = manifest.segments[i];
+			file << segment.file << " " << segment.first_sample << " " << segment.samples << "\n";
+		}
+		file.close();
+		if (file.fail()) return false;
+	}
+#ifdef _WIN32
+	return MoveFileExA(temporary.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return rename(temporary.c_str(), filename.c_str()) == 0;
+#endif
+}
+
+std::string ManifestSegmentPath(const std::string& manifest_file, const std::string& segment_file)
+{
+	return Directory(manifest_file) + segment_file;
+}
+
+void AccumulateWriteBehind(NskWriteBehind& total, const NskWriteBehind& telemetry)
+{
+	total.queue_high_water = std::max(total.queue_high_water, telemetry.queue_high_water);
+	total.bytes_written += telemetry.bytes_written;
+	total.stalls += telemetry.stalls;
+	total.stall_ns += telemetry.stall_ns;
+	total.max_stall_ns = std::max(total.max_stall_ns, telemetry.max_stall_ns);
+	total.syncs += telemetry.syncs;
+	total.write_errors += telemetry.write_errors;
+}
+
+SegmentManifestWriter::SegmentManifestWriter()
+	: failed(false), stopping(false)
+{
+	manifest.format = RECORDING_RAW;
+}
+
+SegmentManifestWriter::~SegmentManifestWriter()
+{
+	Close();
+}
+
+bool SegmentManifestWriter::Open(const std::string& stream_file, int format)
+{
+	Close();
+	size_t extension_at = ExtensionStart(stream_file);
+	stem = stream_file.substr(0, extension_at);
+	extension = stream_file.substr(extension_at);
+	// A manifest name gives no segment extension: use the format's
+	if (extension.empty() || extension == NSKM_EXTENSION) extension = FormatExtension(format);
+
+	manifest_file = ManifestFileName(stream_file);
+	manifest.format = format;
+	manifest.segments.clear();
+	failed = false;
+	if (!WriteManifest(manifest_file, manifest)) return false;
+	stopping = false;
+	worker = std::thread(&SegmentManifestWriter::Run, this);
+	return true;
+}
+
+bool SegmentManifestWriter::Close()
+{
+	if (!worker.joinable()) return !failed;
+	{
+		std::lock_guard<std::mutex> lock(task_mutex);
+		stopping = true;
+	}
+	task_signal.notify_one();
+	worker.join();
+	std::lock_guard<std::mutex> lock(mutex);
+	Update();
+	return !failed;
+}
+
+const std::string& SegmentManifestWriter::ManifestFile() const
+{
+	return manifest_file;
+}
+
+std::string SegmentManifestWriter::SegmentPath(int index) const
+{
+	char suffix[16];
+	snprintf(suffix, sizeof(suffix), "_%04d", index);
+	return stem + suffix + extension;
+}
+
+int SegmentManifestWriter::AddSegment(const std::string& path, unsigned long long first_sample)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	ManifestSegment segment;
+	segment.file = path.substr(Directory(path).size());
+	segment.first_sample = first_sample;
+	segment.samples = 0;
+	manifest.segments.push_back(segment);
+	Update();
+	return (int)manifest.segments.size() - 1;
+}
+
+void SegmentManifestWriter::Post(const std::function<void()>& task)
+{
+	{
+		std::lock_guard<std::mutex> lock(task_mutex);
+		tasks.push_back(task);
+	}
+	task_signal.notify_one();
+}
+
+void SegmentManifestWriter::Retire(int segment, const std::function<bool()>& close, unsigned long long samples)
+{
+	Post([this, segment, close, samples]
+	{
+		bool closed = close();
+		std::lock_guard<std::mutex> lock(mutex);
+		manifest.segments[segment].samples = samples;
+		if (!closed) failed = true;
+		Update();
+	});
+}
+
+void SegmentManifestWriter::Run()
+{
+	std::unique_lock<std::mutex> lock(task_mutex);
+	while (true)
+	{
+		task_signal.wait(lock, [this] { return stopping || !tasks.empty(); });
+		if (tasks.empty()) break;
+		std::function<void()> task = tasks.front();
+		tasks.pop_front();
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+void SegmentManifestWriter::Update()
+{
+	if (!WriteManifest(manifest_file, manifest)) failed = true;
+}
+
+SegmentedWriter::SegmentedWriter(int _format, const NskSegmentOptions& segmentation, int _threads)
+	: format(_format), sample_limit(SegmentSampleLimit(segmentation, _format)), byte_limit(SegmentByteLimit(segmentation, _format)),
+	threads(_threads), options(DefaultWriteBehindOptions()), writer(NULL), prepared(NULL), prepare_failed(false), segment(0), samples(0),
+	segment_samples(0)
+{
+	closed_stats = NskRecordingStats();
+	closed_telemetry = NskWriteBehind();
+}
+
+SegmentedWriter::~SegmentedWriter()
+{
+	Close();
+}
+
+bool SegmentedWriter::Open(const std::string& filename, const NskWriteBehindOptions& _options)
+{
+	Close();
+	options = _options;
+	samples = 0;
+	segment_samples = 0;
+	closed_stats = NskRecordingStats();
+	closed_telemetry = NskWriteBehind();
+	prepare_failed = false;
+	if (!segments.Open(filename, format)) return false;
+	segment = 0;
+	RecordingWriter* first = OpenSegment(segment);
+	if (first == NULL)
+	{
+		segments.Close();
+		return false;
+	}
+	segments.AddSegment(segments.SegmentPath(segment), 0);
+	segments.Post([this] { PrepareSegment(1); });
+	std::lock_guard<std::mutex> lock(mutex);
+	writer = first;
+	return true;
+}
+
+bool SegmentedWriter::Close()
+{
+	RecordingWriter* last;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		last = writer;
+		writer = NULL;
+	}
+	if (last == NULL) return true;
+	bool closed = last->Close();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		NskRecordingStats stats = last->Stats();
+		closed_stats.samples += stats.samples;
+		closed_stats.bytes_in += stats.bytes_in;
+		closed_stats.bytes_out += stats.bytes_out;
+		closed_stats.stalls += stats.stalls;
+		closed_stats.clipped += stats.clipped;
+		AccumulateWriteBehind(closed_telemetry, last->WriteTelemetry());
+	}
+	delete last;
+	segments.Retire(segment, [closed] { return closed; }, segment_samples);
+	samples += segment_samples;
+	segment_samples = 0;
+	bool finished = segments.Close();
+
+	// The segment opened for a rotation that did not come is not part of the recording
+	RecordingWriter* unused = prepared.exchange(NULL);
+	if (unused)
+	{
+		unused->Close();
+		delete unused;
+		remove(segments.SegmentPath(segment + 1).c_str());
+	}
+	return finished;
+}
+
+bool SegmentedWriter::IsOpen() const
+{
+	return writer != NULL;
+}
+
+void SegmentedWriter::Append(const PacketRecord* records, int n)
+{
+	while (n > 0)
+	{
+		// Past the limit (the next segment is not open yet) the current segment takes everything
+		int m = sample_limit > 0 && segment_samples < sample_limit ? (int)std::min<unsigned long long>(n, sample_limit - segment_samples) : n;
+		writer->Append(records, m);
+		segment_samples += m;
+		records += m;
+		n -= m;
+		if ((sample_limit > 0 && segment_samples >= sample_limit) || (byte_limit > 0 && writer->Stats().bytes_out >= byte_limit)) Rotate();
+	}
+}
+
+NskRecordingStats SegmentedWriter::Stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	NskRecordingStats stats = closed_stats;
+	if (writer)
+	{
+		NskRecordingStats current = writer->Stats();
+		stats.samples += current.samples;
+		stats.bytes_in += current.bytes_in;
+		stats.bytes_out += current.bytes_out;
+		stats.stalls += current.stalls;
+		stats.clipped += current.clipped;
+	}
+	return stats;
+}
+
+NskWriteBehind SegmentedWriter::WriteTelemetry() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	NskWriteBehind telemetry = closed_telemetry;
+	if (writer)
+	{
+		NskWriteBehind current = writer->WriteTelemetry();
+		telemetry.queue_buffers = current.queue_buffers;
+		telemetry.queue_depth = current.queue_depth;
+		AccumulateWriteBehind(telemetry, current);
+	}
+	return telemetry;
+}
+
+RecordingWriter* SegmentedWriter::OpenSegment(int index)
+{
+	RecordingWriter* opened = CreateRecordingWriter(format, threads);
+	if (opened == NULL || !opened->Open(segments.SegmentPath(index), options))
+	{
+		delete opened;
+		return NULL;
+	}
+	return opened;
+}
+
+void SegmentedWriter::PrepareSegment(int index)
+{
+	RecordingWriter* opened = OpenSegment(index);
+	if (opened)
+		prepared = opened;
+	else
+		prepare_failed = true;
+}
+
+void SegmentedWriter::Rotate()
+{
+	// Swap in the segment opened ahead of time, or keep appending to the current one until it is ready
+	RecordingWriter* next = prepared.exchange(NULL);
+	if (next == NULL)
+	{
+		if (prepare_failed)
+		{
+			// The next segment cannot be created: keep recording into the current one rather than lose data
+			sample_limit = 0;
+			byte_limit = 0;
+		}
+		return;
+	}
+	int previous_segment = segment;
+	unsigned long long previous_samples = segment_samples;
+	samples += segment_samples;
+	segment_samples = 0;
+	segment++;
+
+	// Samples and raw size are final when the segment is swapped out, the bytes written once it is closed
+	RecordingWriter* previous;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		previous = writer;
+		writer = next;
+		NskRecordingStats stats = previous->Stats();
+		closed_stats.samples += stats.samples;
+		closed_stats.bytes_in += stats.bytes_in;
+		closed_stats.clipped += stats.clipped;
+	}
+	segments.Retire(previous_segment, [this, previous]
+	{
+		bool closed = previous->Close();
+		NskRecordingStats stats = previous->Stats();
+		NskWriteBehind telemetry = previous->WriteTelemetry();
+		delete previous;
+		std::lock_guard<std::mutex> lock(mutex);
+		closed_stats.bytes_out += stats.bytes_out;
+		closed_stats.stalls += stats.stalls;
+		AccumulateWriteBehind(closed_telemetry, telemetry);
+		return closed;
+	}, previous_samples);
+	// List the new segment, then open the one after it
+	int current = segment;
+	unsigned long long first_sample = samples;
+	segments.Post([this, current, first_sample]
+	{
+		segments.AddSegment(segments.SegmentPath(current), first_sample);
+		PrepareSegment(current + 1);
+	});
+}
+
+SegmentedReader::SegmentedReader()
+	: current(0), missing(0), missing_samples(0)
+{
+}
+
+SegmentedReader::~SegmentedReader()
+{
+	Close();
+}
+
+bool SegmentedReader::Open(const std::string& filename)
+{
+	Close();
+	RecordingManifest manifest;
+	if (!ReadManifest(filename, manifest)) return false;
+
+	// Unreadable or empty segments are left out. A segment never starts before the end of the previous one, whatever
+	// its listing says.
+	unsigned long long end = 0;
+	for (size_t i = 0; i < manifest.segments.size(); i++)
+	{
+		RecordingReader* reader = CreateRecordingReader(manifest.format);
+		if (reader == NULL) return false;
+		if (!reader->Open(ManifestSegmentPath(filename, manifest.segments[i].file)) || reader->Samples() == 0)
+		{
+			delete reader;
+			missing++;
+			continue;
+		}
+		unsigned long long first = std::max(manifest.segments[i].first_sample, end);
+		missing_samples += first - end;
+		readers.push_back(reader);
+		first_samples.push_back(first);
+		end = first + reader->Samples();
+	}
+	first_samples.push_back(end);
+	current = 0;
+	if (readers.empty())
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void SegmentedReader::Close()
+{
+	for (size_t i = 0; i < readers.size(); i++) delete readers[i];
+	readers.clear();
+	first_samples.clear();
+	current = 0;
+	missing = 0;
+	missing_samples = 0;
+}
+
+bool SegmentedReader::IsOpen() const
+{
+	return !readers.empty();
+}
+
+unsigned long long SegmentedReader::Samples() const
+{
+	return first_samples.empty() ? 0 : first_samples.back();
+}
+
+unsigned long long SegmentedReader::Position() const
+{
+	if (readers.empty()) return 0;
+	// At the end of a segment the next read is the first sample of the next one, past any hole
+	RecordingReader* reader = readers[current];
+	if (reader->Position() >= reader->Samples() && current + 1 < readers.size()) return first_samples[current + 1];
+	return first_samples[current] + reader->Position();
+}
+
+bool SegmentedReader::Seek(unsigned long long sample)
+{
+	if (readers.empty() || sample > Samples()) return false;
+	// The end of the recording is the end of the last segment; a sample before the first segment or in a hole seeks
+	// to the start of the next segment
+	size_t next = std::upper_bound(first_samples.begin(), first_samples.end() - 1, sample) - first_samples.begin();
+	if (next == 0 || sample - first_samples[next - 1] > readers[next - 1]->Samples())
+	{
+		current = next;
+		return readers[current]->Seek(0);
+	}
+	current = next - 1;
+	return readers[current]->Seek(sample - first_samples[current]);
+}
+
+bool SegmentedReader::ReadNext(PacketRecord* record)
+{
+	while (current < readers.size())
+	{
+		RecordingReader* reader = readers[current];
+		if (reader->ReadNext(record)) return true;
+		// Corrupt data inside a segment ends the read as it does in a single file
+		if (reader->Position() < reader->Samples() || current + 1 >= readers.size()) return false;
+		current++;
+		readers[current]->Seek(0);
+	}
+	return false;
+}
+
+int SegmentedReader::Segments() const
+{
+	return (int)readers.size();
+}
+
+int SegmentedReader::MissingSegments() const
+{
+	return missing;
+}
+
+unsigned long long SegmentedReader::MissingSamples() const
+{
+	return missing_samples;
+}
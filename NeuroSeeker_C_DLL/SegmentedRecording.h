@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RecordingFile.h"
+
+// Recording manifest (.nskm), a text file:
+//   NSKM <version> <format>
+//   <segment file> <first sample> <samples>     one line per segment, file names relative to the manifest
+// The manifest is rewritten whenever a segment is started or closed; the segment being written lists 0 samples.
+const char* const NSKM_FILE_TAG = "NSKM";
+const char* const NSKM_EXTENSION = ".nskm";
+const int NSKM_VERSION = 1;
+
+// Recording rotation, as set by NSK_SetSegmentation: a new segment is started when the current one holds
+// segment_seconds of data or reaches segment_mb (0 for both: a single file)
+struct NskSegmentOptions
+{
+	int segment_seconds;
+	int segment_mb;
+};
+
+struct ManifestSegment
+{
+	std::string file;
+	unsigned long long first_sample;
+	unsigned long long samples;
+};
+
+struct RecordingManifest
+{
+	int format;
+	std::vector<ManifestSegment> segments;
+};
+
+// No rotation
+NskSegmentOptions DefaultSegmentOptions();
+bool IsSegmented(const NskSegmentOptions& options);
+
+// Samples per segment of a format (the size limit of the fixed-size formats is converted exactly; 0: no limit)
+unsigned long long SegmentSampleLimit(const NskSegmentOptions& options, int format);
+// Bytes per segment of the variable-size formats, checked against the bytes written (0: no limit); a compressed
+// segment can exceed it by the chunks still being encoded when the limit is reached
+unsigned long long SegmentByteLimit(const NskSegmentOptions& options, int format);
+
+// Manifest of a rotating recording to stream_file (<stem>.nskm)
+std::string ManifestFileName(const std::string& stream_file);
+// True if the file starts with the manifest tag
+bool IsManifestFile(const std::string& filename);
+bool ReadManifest(const std::string& filename, RecordingManifest& manifest);
+// Write the manifest to a temporary file and move it over filename, so readers never see a partial manifest
+bool WriteManifest(const std::string& filename, const RecordingManifest& manifest);
+// Path of a segment listed in a manifest
+std::string ManifestSegmentPath(const std::string& manifest_file, const std::string& segment_file);
+
+// Add the counters of a closed write-behind file to a running total
+void AccumulateWriteBehind(NskWriteBehind& total, const NskWriteBehind& telemetry);
+
+// Segment naming and manifest of a rotating recording: stream file <stem><ext> is recorded as <stem>.nskm and
+// segments <stem>_0000<ext>, <stem>_0001<ext>, ... A segment thread runs the slow part of a rotation (opening the
+// next segment ahead of time, closing the previous one, rewriting the manifest), so the producer only swaps files.
+class SegmentManifestWriter
+{
+public:
+	SegmentManifestWriter();
+	~SegmentManifestWriter();
+
+	// Write the empty manifest and start the segment thread
+	bool Open(const std::string& stream_file, int format);
+	// Run the tasks still queued, stop the segment thread and write the final manifest (false if a close or manifest
+	// write failed)
+	bool Close();
+
+	const std::string& ManifestFile() const;
+
+	// Path of segment index, and its listing in the manifest (from first_sample) once it is created
+	std::string SegmentPath(int index) const;
+	int AddSegment(const std::string& path, unsigned long long first_sample);
+	// Run a task on the segment thread, after the tasks queued before it
+	void Post(const std::function<void()>& task);
+	// Close a segment (close returns false on a write error) on the segment thread, then list its samples
+	void Retire(int segment, const std::function<bool()>& close, unsigned long long samples);
+
+private:
+	void Run();
+	void Update();
+
+	std::string manifest_file;
+	std::string stem;
+	std::string extension;
+	RecordingManifest manifest;
+	std::mutex mutex;                              // manifest
+	bool failed;
+
+	std::thread worker;
+	std::mutex task_mutex;
+	std::condition_variable task_signal;
+	std::deque<std::function<void()> > tasks;
+	bool stopping;
+};
+
+// Rotating recording in one of the DLL's own formats: each segment is a complete file of that format
+class SegmentedWriter : public RecordingWriter
+{
+public:
+	// Segments are encoded on threads threads where the format supports it (threads <= 0: all cores)
+	SegmentedWriter(int format, const NskSegmentOptions& segmentation, int threads = 0);
+	~SegmentedWriter();
+
+	// filename is the stream file the segment and manifest names are derived from
+	bool Open(const std::string& filename, const NskWriteBehindOptions& options);
+	bool Close();
+	bool IsOpen() const;
+
+	void Append(const PacketRecord* records, int n);
+
+	NskRecordingStats Stats() const;
+	NskWriteBehind WriteTelemetry() const;
+
+private:
+	RecordingWriter* OpenSegment(int index);
+	// Segment thread: open the next segment ahead of its rotation
+	void PrepareSegment(int index);
+	void Rotate();
+
+	int format;
+	unsigned long long sample_limit;
+	unsigned long long byte_limit;
+	int threads;
+	NskWriteBehindOptions options;
+	SegmentManifestWriter segments;
+
+	RecordingWriter* writer;                 // current segment
+	std::atomic<RecordingWriter*> prepared;  // next segment once it is open
+	std::atomic<bool> prepare_failed;        // the next segment could not be created
+	int segment;                             // manifest index of the current segment
+	unsigned long long samples;              // samples in the closed segments
+	unsigned long long segment_samples;      // samples in the current segment
+	NskRecordingStats closed_stats;
+	NskWriteBehind closed_telemetry;
+	mutable std::mutex mutex;                // writer swap and closed totals
+};
+
+// Playback of a manifest's segments as one recording: each segment starts at its listed first sample, so a segment
+// that is missing or shorter than listed leaves a hole of missing samples (skipped by reads and seeks) rather than
+// shifting the segments after it
+class SegmentedReader : public RecordingReader
+{
+public:
+	SegmentedReader();
+	~SegmentedReader();
+
+	bool Open(const std::string& filename);
+	void Close();
+	bool IsOpen() const;
+
+	unsigned long long Samples() const;
+	unsigned long long Position() const;
+	bool Seek(unsigned long long sample);
+	bool ReadNext(PacketRecord* record);
+
+	// Segments played back, and listed segments left out (unreadable or empty)
+	int Segments() const;
+	int MissingSegments() const;
+	// Samples in the holes between the segments played back
+	unsigned long long MissingSamples() const;
+
+private:
+	std::vector<RecordingReader*> readers;
+	std::vector<unsigned long long> first_samples;  // first sample of each segment, then the total
+	size_t current;
+	int missing;
+	unsigned long long missing_samples;
+};
@@ -0,0 +1,99 @@
+// SyncEdges.cpp : Sync-line edge events from the packet sync words
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define NSK_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "SyncEdges.h"
+
+// Append one event per masked line that differs between before and after
+static void AppendEdges(unsigned short before, unsigned short after, unsigned short mask, int sample, std::vector<NskSyncEvent>& events)
+{
+	unsigned int changed = (before ^ after) & mask;
+	for (short line = 0; changed != 0; line++, changed >>= 1)
+	{
+		if (changed & 1)
+		{
+			NskSyncEvent event = { sample, line, (short)((after >> line) & 1) };
+			events.push_back(event);
+		}
+	}
+}
+
+void FindSyncEdges(const unsigned short* words, int n, unsigned short previous, unsigned short mask, int offset, std::vector<NskSyncEvent>& events)
+{
+	if (n <= 0) return;
+
+	// First word against the previous block, then eight words at a time against their predecessors
+	AppendEdges(previous, words[0], mask, offset, events);
+	int i = 1;
+#ifdef NSK_SSE2
+	const __m128i line_mask = _mm_set1_epi16((short)mask);
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 8 <= n; i += 8)
+	{
+		__m128i current = _mm_loadu_si128((const __m128i*)(words + i));
+		__m128i before = _mm_loadu_si128((const __m128i*)(words + i - 1));
+		__m128i changed = _mm_and_si128(_mm_xor_si128(current, before), line_mask);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(changed, zero)) == 0xFFFF) continue;
+		for (int j = i; j < i + 8; j++)
+		{
+			AppendEdges(words[j - 1], words[j], mask, offset + j, events);
+		}
+	}
+#endif
+	for (; i < n; i++)
+	{
+		AppendEdges(words[i - 1], words[i], mask, offset + i, events);
+	}
+}
+
+SyncEdgeDetector::SyncEdgeDetector()
+	: line_mask(0xFFFF)
+{
+	Reset();
+}
+
+SyncEdgeDetector::~SyncEdgeDetector()
+{
+}
+
+void SyncEdgeDetector::Reset()
+{
+	block_events.clear();
+	last_word = 0;
+	has_last = false;
+}
+
+void SyncEdgeDetector::SetLineMask(unsigned short mask)
+{
+	line_mask = mask;
+}
+
+void SyncEdgeDetector::BeginBlock()
+{
+	block_events.clear();
+}
+
+void SyncEdgeDetector::Track(const PacketRecord* records, int n, int offset)
+{
+	// Gather the strided sync words into a contiguous chunk for the vector scan
+	unsigned short words[PACKET_BLOCK_SIZE];
+	for (int start = 0; start < n; start += PACKET_BLOCK_SIZE)
+	{
+		int count = n - start < PACKET_BLOCK_SIZE ? n - start : PACKET_BLOCK_SIZE;
+		for (int i = 0; i < count; i++)
+		{
+			words[i] = records[start + i].synchronization;
+		}
+		FindSyncEdges(words, count, has_last ? last_word : words[0], line_mask, offset + start, block_events);
+		last_word = words[count - 1];
+		has_last = true;
+	}
+}
+
+const std::vector<NskSyncEvent>& SyncEdgeDetector::BlockEvents() const
+{
+	return block_events;
+}
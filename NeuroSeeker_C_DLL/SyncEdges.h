@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include "PacketBlock.h"
+
+// Number of digital lines in the sync word
+const int SYNC_LINES = 16;
+
+// Level change of one sync line
+struct NskSyncEvent
+{
+	int sample;    // sample index (in the block) at which the line has its new level
+	short line;    // sync line (bit of the sync word)
+	short rising;  // 1 for a rising edge, 0 for a falling edge
+};
+
+// Find the lines (in mask) that change between consecutive sync words, in sample order; previous is the
+// word preceding words[0], events are appended with sample indices starting at offset
+void FindSyncEdges(const unsigned short* words, int n, unsigned short previous, unsigned short mask, int offset, std::vector<NskSyncEvent>& events);
+
+// Edge extraction on the sync word of every delivered packet, carried across blocks
+class SyncEdgeDetector
+{
+public:
+	SyncEdgeDetector();
+	~SyncEdgeDetector();
+
+	// Forget the previous sync word (new stream, the first packet never produces events)
+	void Reset();
+	// Lines on which edges are reported (default all)
+	void SetLineMask(unsigned short mask);
+
+	// Consumer: start a new block (clears the block event list)
+	void BeginBlock();
+	// Consumer: extract the edges of n records delivered at sample offset in the current block
+	void Track(const PacketRecord* records, int n, int offset);
+
+	const std::vector<NskSyncEvent>& BlockEvents() const;
+
+private:
+	std::vector<NskSyncEvent> block_events;
+	unsigned short line_mask;
+	unsigned short last_word;
+	bool has_last;
+};
@@ -0,0 +1,283 @@
+// WriteBehindFile.cpp : Recording file written from a bounded buffer queue by a dedicated thread
+
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "WriteBehindFile.h"
+
+static char* AllocateAligned(size_t size)
+{
+#ifdef _WIN32
+	return (char*)_aligned_malloc(size, WRITE_ALIGNMENT);
+#else
+	void* p = NULL;
+	return posix_memalign(&p, WRITE_ALIGNMENT, size) == 0 ? (char*)p : NULL;
+#endif
+}
+
+static void FreeAligned(char* p)
+{
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+NskWriteBehindOptions DefaultWriteBehindOptions()
+{
+	NskWriteBehindOptions options;
+	options.buffer_kb = DEFAULT_WRITE_BUFFER_KB;
+	options.queue_buffers = DEFAULT_WRITE_QUEUE_BUFFERS;
+	options.direct_io = 0;
+	options.sync_ms = 0;
+	return options;
+}
+
+WriteBehindFile::WriteBehindFile()
+	: file(NULL), buffer_bytes(0), current(NULL), file_size(0), stop_requested(false), queue_high_water(0),
+	bytes_written(0), stalls(0), stall_ns(0), max_stall_ns(0), syncs(0), write_errors(0)
+{
+	options = DefaultWriteBehindOptions();
+}
+
+WriteBehindFile::~WriteBehindFile()
+{
+	Close();
+}
+
+bool WriteBehindFile::Open(const std::string& filename, const NskWriteBehindOptions& _options)
+{
+	Close();
+	options = _options;
+	bool direct = options.direct_io != 0;
+#ifdef _WIN32
+	DWORD flags = direct ? FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH : FILE_FLAG_SEQUENTIAL_SCAN;
+	HANDLE handle = CreateFileA(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | flags, NULL);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+	file = handle;
+#else
+	int fd = -1;
+#ifdef O_DIRECT
+	if (direct) fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+#endif
+	// Without O_DIRECT support (platform or file system) the file is written through the cache
+	if (fd < 0)
+	{
+		options.direct_io = 0;
+		fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	}
+	if (fd < 0) return false;
+	file = (void*)(intptr_t)(fd + 1);
+#endif
+
+	buffer_bytes = (size_t)std::max(options.buffer_kb, 64) << 10;
+	buffer_bytes = (buffer_bytes + WRITE_ALIGNMENT - 1) / WRITE_ALIGNMENT * WRITE_ALIGNMENT;
+	buffers.resize(std::max(options.queue_buffers, 2));
+	free_buffers.clear();
+	full.clear();
+	for (size_t i = 0; i < buffers.size(); i++)
+	{
+		buffers[i].data = AllocateAligned(buffer_bytes);
+		buffers[i].size = 0;
+		if (i > 0) free_buffers.push_back(&buffers[i]);
+	}
+	current = &buffers[0];
+	file_size = 0;
+	stop_requested = false;
+	queue_high_water = 0;
+	bytes_written = 0;
+	stalls = 0;
+	stall_ns = 0;
+	max_stall_ns = 0;
+	syncs = 0;
+	write_errors = 0;
+	for (size_t i = 0; i < buffers.size(); i++)
+	{
+		if (buffers[i].data == NULL)
+		{
+			Close();
+			return false;
+		}
+	}
+	thread = std::thread(&WriteBehindFile::Run, this);
+	return true;
+}
+
+bool WriteBehindFile::Close()
+{
+	if (file == NULL) return true;
+	if (thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (current->size > 0)
+			{
+				full.push_back(current);
+				current = NULL;
+			}
+			stop_requested = true;
+		}
+		full_signal.notify_all();
+		thread.join();
+	}
+
+#ifdef _WIN32
+	// Direct I/O writes whole sectors: cut the padding of the last buffer
+	if (options.direct_io)
+	{
+		LARGE_INTEGER end;
+		end.QuadPart = (LONGLONG)file_size;
+		if (!SetFilePointerEx((HANDLE)file, end, NULL, FILE_BEGIN) || !SetEndOfFile((HANDLE)file)) write_errors++;
+	}
+	Sync();
+	CloseHandle((HANDLE)file);
+#else
+	if (options.direct_io && ftruncate((int)(intptr_t)file - 1, (off_t)file_size) != 0) write_errors++;
+	Sync();
+	close((int)(intptr_t)file - 1);
+#endif
+	file = NULL;
+
+	for (size_t i = 0; i < buffers.size(); i++) FreeAligned(buffers[i].data);
+	buffers.clear();
+	free_buffers.clear();
+	full.clear();
+	current = NULL;
+	return write_errors == 0;
+}
+
+bool WriteBehindFile::IsOpen() const
+{
+	return file != NULL;
+}
+
+void WriteBehindFile::Write(const void* data, size_t size)
+{
+	const char* p = (const char*)data;
+	file_size += size;
+	while (size > 0)
+	{
+		size_t n = std::min(size, buffer_bytes - current->size);
+		memcpy(current->data + current->size, p, n);
+		current->size += n;
+		p += n;
+		size -= n;
+		if (current->size == buffer_bytes) Submit();
+	}
+}
+
+NskWriteBehind WriteBehindFile::Telemetry() const
+{
+	NskWriteBehind telemetry;
+	std::lock_guard<std::mutex> lock(mutex);
+	telemetry.queue_buffers = buffers.size();
+	telemetry.queue_depth = full.size();
+	telemetry.queue_high_water = queue_high_water;
+	telemetry.bytes_written = bytes_written;
+	telemetry.stalls = stalls;
+	telemetry.stall_ns = stall_ns;
+	telemetry.max_stall_ns = max_stall_ns;
+	telemetry.syncs = syncs;
+	telemetry.write_errors = write_errors;
+	return telemetry;
+}
+
+void WriteBehindFile::Submit()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	full.push_back(current);
+	queue_high_water = std::max<unsigned long long>(queue_high_water, full.size());
+	full_signal.notify_one();
+	current = NULL;
+
+	// Only a full queue (the disk is behind by the whole queue) makes the producer wait
+	if (free_buffers.empty())
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		free_signal.wait(lock, [this] { return !free_buffers.empty(); });
+		unsigned long long waited = (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		stalls++;
+		stall_ns += waited;
+		if (waited > max_stall_ns) max_stall_ns = waited;
+	}
+	current = free_buffers.back();
+	free_buffers.pop_back();
+	current->size = 0;
+}
+
+void WriteBehindFile::Run()
+{
+	std::chrono::steady_clock::time_point last_sync = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		full_signal.wait(lock, [this] { return stop_requested || !full.empty(); });
+		if (full.empty()) break;
+		Buffer* buffer = full.front();
+		full.pop_front();
+		lock.unlock();
+
+		// Direct I/O only takes whole sectors: zero-pad the last (partial) buffer, Close cuts the file back
+		size_t size = buffer->size;
+		if (options.direct_io && size % WRITE_ALIGNMENT != 0)
+		{
+			size_t padded = (size + WRITE_ALIGNMENT - 1) / WRITE_ALIGNMENT * WRITE_ALIGNMENT;
+			memset(buffer->data + size, 0, padded - size);
+			size = padded;
+		}
+		if (WriteOut(buffer->data, size))
+			bytes_written += buffer->size;
+		else
+			write_errors++;
+		if (options.sync_ms > 0 && std::chrono::steady_clock::now() - last_sync >= std::chrono::milliseconds(options.sync_ms))
+		{
+			Sync();
+			last_sync = std::chrono::steady_clock::now();
+		}
+
+		lock.lock();
+		buffer->size = 0;
+		free_buffers.push_back(buffer);
+		free_signal.notify_one();
+	}
+}
+
+bool WriteBehindFile::WriteOut(const char* data, size_t size)
+{
+	while (size > 0)
+	{
+#ifdef _WIN32
+		DWORD n = 0;
+		if (!WriteFile((HANDLE)file, data, (DWORD)std::min<size_t>(size, 1 << 30), &n, NULL) || n == 0) return false;
+#else
+		ssize_t n = write((int)(intptr_t)file - 1, data, size);
+		if (n <= 0) return false;
+#endif
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+void WriteBehindFile::Sync()
+{
+#ifdef _WIN32
+	FlushFileBuffers((HANDLE)file);
+#else
+	fsync((int)(intptr_t)file - 1);
+#endif
+	syncs++;
+}
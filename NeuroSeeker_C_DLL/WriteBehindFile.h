@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Default write-behind queue: 32 buffers of 4 MB hold ~3 s of full rate raw recording
+const int DEFAULT_WRITE_BUFFER_KB = 4096;
+const int DEFAULT_WRITE_QUEUE_BUFFERS = 32;
+
+// Buffer and direct I/O write alignment (sector size of current disks)
+const unsigned int WRITE_ALIGNMENT = 4096;
+
+// Write-behind settings, as set by NSK_SetWriteBehind
+struct NskWriteBehindOptions
+{
+	int buffer_kb;       // size of one queued buffer (rounded up to WRITE_ALIGNMENT)
+	int queue_buffers;   // buffers between the producer and the disk
+	int direct_io;       // bypass the OS file cache (unbuffered writes of aligned buffers)
+	int sync_ms;         // flush the file to disk at this interval (0: only on close)
+};
+
+// Write-behind telemetry, as returned by NSK_GetWriteBehind
+struct NskWriteBehind
+{
+	unsigned long long queue_buffers;     // buffers in the queue
+	unsigned long long queue_depth;       // full buffers waiting for the disk
+	unsigned long long queue_high_water;  // largest queue_depth seen
+	unsigned long long bytes_written;
+	unsigned long long stalls;            // producer writes that waited for a free buffer
+	unsigned long long stall_ns;          // total time the producer waited
+	unsigned long long max_stall_ns;      // longest single wait
+	unsigned long long syncs;             // flushes to disk
+	unsigned long long write_errors;
+};
+
+// Default write-behind settings
+NskWriteBehindOptions DefaultWriteBehindOptions();
+
+// Sequential file written by a dedicated thread: the producer copies into large aligned buffers, full buffers
+// are queued to the writer thread, so a slow or stalled disk only delays the producer once the whole queue is full
+class WriteBehindFile
+{
+public:
+	WriteBehindFile();
+	~WriteBehindFile();
+
+	// Create (or truncate) the file and start the writer thread
+	bool Open(const std::string& filename, const NskWriteBehindOptions& options);
+	// Write the buffered data, stop the writer thread and close the file (false if any write failed)
+	bool Close();
+	bool IsOpen() const;
+
+	// Producer: append bytes to the file
+	void Write(const void* data, size_t size);
+
+	NskWriteBehind Telemetry() const;
+
+private:
+	struct Buffer
+	{
+		char* data;
+		size_t size;
+	};
+
+	void Submit();
+	void Run();
+	bool WriteOut(const char* data, size_t size);
+	void Sync();
+
+	void* file;                              // file handle (Win32) or descriptor (POSIX)
+	NskWriteBehindOptions options;
+	size_t buffer_bytes;
+	std::vector<Buffer> buffers;
+	Buffer* current;
+	unsigned long long file_size;            // bytes handed to the file (the tail of a direct I/O file is padded)
+
+	std::thread thread;
+	mutable std::mutex mutex;
+	std::condition_variable full_signal;     // writer: buffer queued (or stop)
+	std::condition_variable free_signal;     // producer: buffer written
+	std::deque<Buffer*> full;
+	std::vector<Buffer*> free_buffers;
+	bool stop_requested;
+
+	unsigned long long queue_high_water;
+	std::atomic<unsigned long long> bytes_written;
+	std::atomic<unsigned long long> stalls;
+	std::atomic<unsigned long long> stall_ns;
+	std::atomic<unsigned long long> max_stall_ns;
+	std::atomic<unsigned long long> syncs;
+	std::atomic<unsigned long long> write_errors;
+};
@@ -0,0 +1,399 @@
+// NskTools.cpp : Command line tools for NeuroSeeker (.nsk) recordings, built on the Nsk C DLL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "PacketBlock.h"
+#include "PacketCopier.h"
+#include "FileExport.h"
+#include "IntegrityScan.h"
+#include "RecordingFile.h"
+#include "RecordingPyramid.h"
+
+// Import relevant functions from Nsk C DLL
+extern "C"
+{
+	__declspec(dllimport) bool NSK_LearnPacketLayout(char *nsk_file, char *layout_file);
+	__declspec(dllimport) bool NSK_ValidatePacketLayout(char *layout_file, char *nsk_file, unsigned long long *packets, unsigned long long *mismatches);
+	__declspec(dllimport) int NSK_ChannelsInRows(int first_row, int last_row, int *channels);
+	__declspec(dllimport) bool NSK_ExportFile(char *nsk_file, char *out_file, char *sync_file, char *layout_file, int *channels, int n_channels, NskExportOptions *options, NskExportResult *result);
+	__declspec(dllimport) bool NSK_ConvertFile(char *nsk_file, char *out_file, char *layout_file, int format, int threads, NskExportResult *result);
+	__declspec(dllimport) bool NSK_ScanFile(char *nsk_file, char *report_file, char *layout_file, NskScanOptions *options, NskScanResult *result);
+	__declspec(dllimport) bool NSK_BuildPyramid(char *recording_file, char *layout_file, int threads, NskPyramidResult *result);
+}
+
+static void Usage()
+{
+	printf("Usage:\n");
+	printf("  NeuroSeeker_Tools learn <recording.nsk> <layout.txt>\n");
+	printf("      Learn the packet layout of the native decoder from the vendor decoder\n");
+	printf("  NeuroSeeker_Tools validate <layout.txt> <recording.nsk>\n");
+	printf("      Decode a recording with both decoders and count the packets on which they disagree\n");
+	printf("  NeuroSeeker_Tools export <recording.nsk> <output.bin> [options]\n");
+	printf("      Decode a recording on all cores into a flat binary\n");
+	printf("      --float             float32 samples (default int16)\n");
+	printf("      --channel-major     one row per channel (default one row per sample, interleaved)\n");
+	printf("      --channels <list>   channel subset, e.g. 0-119,240 (written in ascending order)\n");
+	printf("      --rows <first-last> channels of a depth range of electrode rows (0-359, 4 channels each)\n");
+	printf("      --scale <factor>    multiply the ADC codes before conversion (default 1)\n");
+	printf("      --sync <file>       also write the sync words (uint16 per sample)\n");
+	printf("      --layout <file>     use the native decoder with this packet layout (subsets of up to 360 channels\n");
+	printf("                          then decode only their own codes)\n");
+	printf("      --threads <n>       decoding threads (default all cores)\n");
+	printf("  NeuroSeeker_Tools compress <recording.nsk> <output.nskz> [options]\n");
+	printf("      Compress a recording losslessly (playable with NSK_Open_File)\n");
+	printf("      --layout <file>     use the native decoder with this packet layout\n");
+	printf("      --threads <n>       encoding threads (default all cores)\n");
+	printf("  NeuroSeeker_Tools pack <recording.nsk> <output.nskp> [options]\n");
+	printf("      Pack a recording into 10-bit codes, 1884 bytes per sample (playable with NSK_Open_File)\n");
+	printf("      (channel values must be the ADC codes: others are rounded and saturated, and counted)\n");
+	printf("      --layout <file>     use the native decoder with this packet layout\n");
+	printf("  NeuroSeeker_Tools scan <recording.nsk> [options]\n");
+	printf("      Check every packet of a recording or raw manifest (exit code 2 if any issue is found)\n");
+	printf("      --report <file>     write the totals and bad packet ranges to this file\n");
+	printf("      --counter-step <n>  expected packet counter increment (default 1)\n");
+	printf("      --sync-mask <hex>   sync lines in use, other bits are stray (default ffff)\n");
+	printf("      --min-pulse <n>     shortest valid sync pulse in samples, 0 to skip (default 2)\n");
+	printf("      --layout <file>     use the native decoder with this packet layout\n");
+	printf("      --threads <n>       scanning threads (default all cores)\n");
+	printf("  NeuroSeeker_Tools bench <recording.nsk> [options]\n");
+	printf("      Time the copy of packets into a channel-major block: per-channel accessors and strided stores\n");
+	printf("      (the original NSK_Read loop) against the block copy and tiled transpose of NSK_Read\n");
+	printf("      --block <n>         samples per block (default 500)\n");
+	printf("      --iterations <n>    blocks timed per method (default 200)\n");
+	printf("  NeuroSeeker_Tools pyramid <recording> [options]\n");
+	printf("      Build the min/max/mean overview pyramid <recording>.nskv of any recording or manifest\n");
+	printf("      --layout <file>     use the native decoder with this packet layout\n");
+	printf("      --threads <n>       scanning threads (default all cores)\n");
+}
+
+// Parse a channel list like "0-119,240,300-303"
+static bool ParseChannels(const char* text, std::vector<int>& channels)
+{
+	while (*text)
+	{
+		char* end;
+		long first = strtol(text, &end, 10);
+		if (end == text) return false;
+		long last = first;
+		if (*end == '-')
+		{
+			text = end + 1;
+			last = strtol(text, &end, 10);
+			if (end == text || last < first) return false;
+		}
+		for (long c = first; c <= last; c++) channels.push_back((int)c);
+		if (*end == ',') end++;
+		else if (*end != 0) return false;
+		text = end;
+	}
+	return !channels.empty();
+}
+
+// Parse an electrode row range like "100-115" into its channels
+static bool ParseRows(const char* text, std::vector<int>& channels)
+{
+	char* end;
+	long first = strtol(text, &end, 10);
+	if (end == text || *end != '-') return false;
+	text = end + 1;
+	long last = strtol(text, &end, 10);
+	if (end == text || *end != 0 || last < first) return false;
+	std::vector<int> rows(NSK_ChannelsInRows((int)first, (int)last, NULL));
+	if (rows.empty()) return false;
+	NSK_ChannelsInRows((int)first, (int)last, &rows[0]);
+	channels.insert(channels.end(), rows.begin(), rows.end());
+	return true;
+}
+
+static int Learn(int argc, char** argv)
+{
+	if (argc != 4)
+	{
+		Usage();
+		return 1;
+	}
+	return NSK_LearnPacketLayout(argv[2], argv[3]) ? 0 : 1;
+}
+
+static int Validate(int argc, char** argv)
+{
+	if (argc != 4)
+	{
+		Usage();
+		return 1;
+	}
+	unsigned long long packets = 0, mismatches = 0;
+	if (!NSK_ValidatePacketLayout(argv[2], argv[3], &packets, &mismatches))
+	{
+		printf("Validation failed\n");
+		return 1;
+	}
+	printf("%llu packets, %llu mismatches\n", packets, mismatches);
+	return mismatches == 0 ? 0 : 1;
+}
+
+static int Export(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		Usage();
+		return 1;
+	}
+	NskExportOptions options;
+	options.format = EXPORT_INT16;
+	options.layout = LAYOUT_SAMPLE_MAJOR;
+	options.scale = 1.0f;
+	options.threads = 0;
+	std::vector<int> channels;
+	char* sync_file = NULL;
+	char* layout_file = NULL;
+	for (int i = 4; i < argc; i++)
+	{
+		bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "--float") == 0) options.format = EXPORT_FLOAT32;
+		else if (strcmp(argv[i], "--channel-major") == 0) options.layout = LAYOUT_CHANNEL_MAJOR;
+		else if (strcmp(argv[i], "--channels") == 0 && has_value)
+		{
+			if (!ParseChannels(argv[++i], channels))
+			{
+				printf("Invalid channel list: %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--rows") == 0 && has_value)
+		{
+			if (!ParseRows(argv[++i], channels))
+			{
+				printf("Invalid row range: %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--scale") == 0 && has_value) options.scale = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--sync") == 0 && has_value) sync_file = argv[++i];
+		else if (strcmp(argv[i], "--layout") == 0 && has_value) layout_file = argv[++i];
+		else if (strcmp(argv[i], "--threads") == 0 && has_value) options.threads = atoi(argv[++i]);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	NskExportResult result;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (!NSK_ExportFile(argv[2], argv[3], sync_file, layout_file, channels.empty() ? NULL : &channels[0], (int)channels.size(), &options, &result)) return 1;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double megabytes = result.samples * (double)PACKET_CHAIN_BYTES / 1e6;
+	printf("%llu samples (%llu data errors) in %.1f s, %.0f MB/s of recording\n", result.samples, result.data_errors, seconds, megabytes / seconds);
+	return 0;
+}
+
+static int Convert(int argc, char** argv, int format)
+{
+	if (argc < 4)
+	{
+		Usage();
+		return 1;
+	}
+	char* layout_file = NULL;
+	int threads = 0;
+	for (int i = 4; i < argc; i++)
+	{
+		bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "--layout") == 0 && has_value) layout_file = argv[++i];
+		else if (strcmp(argv[i], "--threads") == 0 && has_value) threads = atoi(argv[++i]);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	NskExportResult result;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (!NSK_ConvertFile(argv[2], argv[3], layout_file, format, threads, &result)) return 1;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double megabytes = result.samples * (double)PACKET_CHAIN_BYTES / 1e6;
+	std::ifstream out(argv[3], std::ios::binary | std::ios::ate);
+	double ratio = megabytes * 1e6 / std::max(1.0, (double)out.tellg());
+	printf("%llu samples (%llu data errors) in %.1f s, %.0f MB/s of recording, %.2fx smaller\n", result.samples, result.data_errors, seconds, megabytes / seconds, ratio);
+	if (result.clipped) printf("%llu channel values clipped to 10-bit codes\n", result.clipped);
+	return 0;
+}
+
+static int Scan(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		Usage();
+		return 1;
+	}
+	NskScanOptions options;
+	options.counter_step = 1;
+	options.sync_mask = 0xFFFF;
+	options.min_sync_pulse = 2;
+	options.threads = 0;
+	char* report_file = NULL;
+	char* layout_file = NULL;
+	for (int i = 3; i < argc; i++)
+	{
+		bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "--report") == 0 && has_value) report_file = argv[++i];
+		else if (strcmp(argv[i], "--counter-step") == 0 && has_value) options.counter_step = (unsigned int)atoi(argv[++i]);
+		else if (strcmp(argv[i], "--sync-mask") == 0 && has_value) options.sync_mask = (unsigned int)strtoul(argv[++i], NULL, 16);
+		else if (strcmp(argv[i], "--min-pulse") == 0 && has_value) options.min_sync_pulse = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--layout") == 0 && has_value) layout_file = argv[++i];
+		else if (strcmp(argv[i], "--threads") == 0 && has_value) options.threads = atoi(argv[++i]);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	NskScanResult result;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (!NSK_ScanFile(argv[2], report_file, layout_file, &options, &result)) return 1;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double megabytes = result.packets * (double)PACKET_CHAIN_BYTES / 1e6;
+	printf("%llu packets in %.1f s, %.0f MB/s\n", result.packets, seconds, megabytes / seconds);
+	printf("%llu data errors, %llu gaps (%llu lost), %llu duplicates, %llu resets, %llu counter mismatches\n", result.data_errors,
+		result.gaps, result.lost, result.duplicates, result.resets, result.counter_mismatches);
+	printf("%llu sync glitches, %llu stray sync words, %llu truncated bytes, %llu missing segments, %llu bad ranges\n",
+		result.sync_glitches, result.sync_stray, result.truncated_bytes, result.missing_segments, result.ranges + result.ranges_dropped);
+	bool clean = result.data_errors == 0 && result.gaps == 0 && result.duplicates == 0 && result.resets == 0 && result.counter_mismatches == 0 &&
+		result.sync_glitches == 0 && result.sync_stray == 0 && result.truncated_bytes == 0 && result.missing_segments == 0;
+	return clean ? 0 : 2;
+}
+
+static int Pyramid(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		Usage();
+		return 1;
+	}
+	char* layout_file = NULL;
+	int threads = 0;
+	for (int i = 3; i < argc; i++)
+	{
+		bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "--layout") == 0 && has_value) layout_file = argv[++i];
+		else if (strcmp(argv[i], "--threads") == 0 && has_value) threads = atoi(argv[++i]);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	NskPyramidResult result;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (!NSK_BuildPyramid(argv[2], layout_file, threads, &result)) return 1;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%llu samples, %llu levels, %.1f MB in %.1f s\n", result.samples, result.levels, result.bytes / 1e6, seconds);
+	return 0;
+}
+
+static int Bench(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		Usage();
+		return 1;
+	}
+	int block_size = 500;
+	int iterations = 200;
+	for (int i = 3; i < argc; i++)
+	{
+		bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "--block") == 0 && has_value) block_size = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--iterations") == 0 && has_value) iterations = atoi(argv[++i]);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+	if (block_size <= 0 || iterations <= 0)
+	{
+		Usage();
+		return 1;
+	}
+
+	// A real packet of the recording stands in for readElectrodeData, whose time is not part of either method
+	std::ifstream in(argv[2], std::ios::binary);
+	std::vector<char> chain(PACKET_CHAIN_BYTES);
+	ElectrodePacket ep;
+	bool found = false;
+	while (!found && in.read(&chain[0], PACKET_CHAIN_BYTES))
+		found = ep.getElectrodePacketFromChain(&chain[0]) == READ_SUCCESS;
+	if (!found)
+	{
+		printf("No valid packet in %s\n", argv[2]);
+		return 1;
+	}
+
+	std::vector<float> before((size_t)NUMBER_OF_CHANNELS * block_size);
+	std::vector<float> after((size_t)NUMBER_OF_CHANNELS * block_size);
+	std::vector<PacketRecord> scratch(PACKET_BLOCK_SIZE);
+	PacketCopier copier;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int k = 0; k < iterations; k++)
+	{
+		for (int i = 0; i < block_size; i++)
+		{
+			for (unsigned int c = 0; c < NUMBER_OF_CHANNELS; c++)
+				before[c * block_size + i] = ep.getChannelData(c);
+		}
+	}
+	double before_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+	start = std::chrono::steady_clock::now();
+	for (int k = 0; k < iterations; k++)
+	{
+		for (int n = 0; n < block_size; n += PACKET_BLOCK_SIZE)
+		{
+			int m = std::min(PACKET_BLOCK_SIZE, block_size - n);
+			for (int i = 0; i < m; i++) copier.Copy(ep, &scratch[i]);
+			TransposeBlock(scratch[0].channelData, PACKET_RECORD_STRIDE, m, NUMBER_OF_CHANNELS, &after[n], block_size);
+		}
+	}
+	double after_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+	// Share of one core at the nominal sample rate, where a block arrives every block_size / 20 kHz
+	double block_ms = block_size * 1000.0 / NOMINAL_SAMPLE_RATE;
+	bool same = memcmp(&before[0], &after[0], before.size() * sizeof(float)) == 0;
+	printf("%d-sample blocks (%.1f ms of data), %d iterations\n", block_size, block_ms, iterations);
+	printf("  per-channel accessors: %.3f ms/block (%.1f%% of a core)\n", before_ms, 100.0 * before_ms / block_ms);
+	printf("  block transpose:       %.3f ms/block (%.1f%% of a core)\n", after_ms, 100.0 * after_ms / block_ms);
+	printf("  %.1fx faster, outputs %s\n", before_ms / after_ms, same ? "identical" : "DIFFER");
+	return same ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		Usage();
+		return 1;
+	}
+	if (strcmp(argv[1], "learn") == 0) return Learn(argc, argv);
+	if (strcmp(argv[1], "validate") == 0) return Validate(argc, argv);
+	if (strcmp(argv[1], "export") == 0) return Export(argc, argv);
+	if (strcmp(argv[1], "compress") == 0) return Convert(argc, argv, RECORDING_COMPRESSED);
+	if (strcmp(argv[1], "pack") == 0) return Convert(argc, argv, RECORDING_PACKED);
+	if (strcmp(argv[1], "scan") == 0) return Scan(argc, argv);
+	if (strcmp(argv[1], "pyramid") == 0) return Pyramid(argc, argv);
+	if (strcmp(argv[1], "bench") == 0) return Bench(argc, argv);
+	Usage();
+	return 1;
+}